@@ -1 +1,7247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "libhuff.h"
+#ifdef HUFF_THREADS
+#include <pthread.h>
+#endif
 
+/*
+ ============================================================================
+ HUFFMAN OTIMIZADO
+ Mesmo cabeçalho do test_huffman_complete (3 bits lixo + 13 bits árvore +
+ árvore em pré-ordem), mas sem o arquivo intermediário de '0'/'1': os códigos
+ são empacotados direto em bits, a leitura é feita em blocos e a
+ descompactação usa uma tabela de decodificação em vez de andar bit a bit.
+ ============================================================================
+*/
+
+#define TAMANHO_BUFFER (64 * 1024)     // Tamanho dos blocos de leitura/escrita
+#define TAMANHO_MAXIMO_CODIGO 16       // Maior código gerado pelo compressor
+#define BITS_TABELA 11                 // Bits consultados de uma vez na decodificação
+#define MAXIMO_NOS 511                 // 256 folhas + 255 nós internos
+#define NIVEL_PADRAO 6
+
+/*
+ ============================================================================
+ PARTE 1: CRIAÇÃO DA LISTA ENCADEADA DE FREQUÊNCIA E ORDENAÇÃO CRESCENTE
+ ============================================================================
+*/
+
+// Estrutura do nó da lista de frequência
+struct No {
+    unsigned char simbolo;        // Caractere/símbolo (0x00 a 0xFF)
+    int frequencia;              // Frequência do símbolo
+    struct No* proximo;          // Ponteiro para próximo nó na lista
+    struct No* esquerdo;         // Ponteiro esquerdo (para árvore binária)
+    struct No* direito;          // Ponteiro direito (para árvore binária)
+};
+
+// Configuração de cada nível de compressão (1 = mais rápido, 9 = melhor taxa)
+struct ConfigNivel {
+    int divisorAmostra;          // 0 = contagem exata; N = lê ~1/N do arquivo
+    int tamanhoPedaco;           // Granularidade da divisão adaptativa (0 = bloco fixo)
+    int passesMultiTabela;       // Refinamentos do modo com várias tabelas (0 = desligado)
+    int gruposContexto;          // Máximo de tabelas do modo de ordem 1 (0 = desligado)
+    int cadeiaLz;                // LZ77: candidatos examinados por posição
+    int comprimentoBomLz;        // LZ77: para de procurar ao achar um match deste tamanho
+    int preguicosoLz;            // LZ77: adia o match se o da posição seguinte for maior
+};
+
+static const struct ConfigNivel configuracoesNivel[10] = {
+    {0, 0, 0, 0, 0, 0, 0},                                                   // nível 0 não é usado
+    {64, 0, 0, 0, 4, 16, 0}, {16, 0, 0, 0, 8, 32, 0}, {4, 0, 0, 0, 16, 32, 0}, // níveis 1-3: histograma amostrado
+    {0, 64 * 1024, 0, 0, 16, 64, 1}, {0, 32 * 1024, 0, 0, 32, 128, 1},
+    {0, 16 * 1024, 0, 8, 128, 258, 1}, {0, 8 * 1024, 0, 16, 256, 258, 1},
+    {0, 4 * 1024, 3, 32, 1024, 258, 1}, {0, 4 * 1024, 4, 32, 4096, 258, 1}  // níveis 4-9: contagem exata
+};
+
+#define JANELA_AMOSTRA 4096              // Bytes lidos em cada ponto de amostragem
+#define AMOSTRA_MINIMA (64 * 1024)       // Abaixo disso a contagem é sempre exata
+
+// Reserva de nós da lista e da árvore. Com 256 símbolos a árvore (cheia) tem no
+// máximo MAXIMO_NOS nós, então quem monta uma árvore declara uma reserva na
+// pilha e nenhum nó passa por malloc/free.
+struct ReservaNos {
+    struct No nos[MAXIMO_NOS];
+    int usados;
+};
+
+// Função para criar um novo nó da lista de frequência (tirado da reserva)
+static struct No* criarNo(struct ReservaNos* reserva, unsigned char simbolo, int frequencia) {
+    struct No* novoNo = &reserva->nos[reserva->usados++];
+
+    // Inicializar os campos do nó
+    novoNo->simbolo = simbolo;
+    novoNo->frequencia = frequencia;
+    novoNo->proximo = NULL;
+    novoNo->esquerdo = NULL;
+    novoNo->direito = NULL;
+    return novoNo;
+}
+
+// Procedimento para reduzir contagens de 64 bits para o int da lista
+// (arquivos com mais de 2 GB estourariam o campo frequencia)
+static void normalizarFrequencias(const uint64_t contagem[256], int frequencias[256]) {
+    uint64_t maior = 0;
+    for (int i = 0; i < 256; i++) {
+        if (contagem[i] > maior) maior = contagem[i];
+    }
+
+    int deslocamento = 0;
+    while ((maior >> deslocamento) > (1u << 30)) {
+        deslocamento++;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        frequencias[i] = (int)(contagem[i] >> deslocamento);
+        // Símbolo presente nunca pode virar frequência zero
+        if (contagem[i] > 0 && frequencias[i] == 0) {
+            frequencias[i] = 1;
+        }
+    }
+}
+
+// Procedimento para somar os bytes de 'dados' em 'contagem' com quatro
+// histogramas intercalados: em sequências do mesmo byte cada incremento não
+// precisa esperar o anterior terminar, como aconteceria com um contador só.
+static void contarBytes(const unsigned char* dados, size_t n, uint64_t contagem[256]) {
+    uint32_t parciais[4][256];
+
+    while (n > 0) {
+        // Pedaços de até 1 GiB: nenhum contador de 32 bits estoura
+        size_t pedaco = n < ((size_t)1 << 30) ? n : ((size_t)1 << 30);
+        memset(parciais, 0, sizeof(parciais));
+
+        size_t i = 0;
+        for (; i + 4 <= pedaco; i += 4) {
+            parciais[0][dados[i]]++;
+            parciais[1][dados[i + 1]]++;
+            parciais[2][dados[i + 2]]++;
+            parciais[3][dados[i + 3]]++;
+        }
+        for (; i < pedaco; i++) {
+            parciais[0][dados[i]]++;
+        }
+
+        for (int s = 0; s < 256; s++) {
+            contagem[s] += (uint64_t)parciais[0][s] + parciais[1][s] + parciais[2][s] + parciais[3][s];
+        }
+        dados += pedaco;
+        n -= pedaco;
+    }
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Procedimento para contar frequências de QUALQUER arquivo binário (leitura em blocos)
+static void contarFrequenciasArquivo(FILE* arquivo, int frequencias[256]) {
+    uint64_t contagem[256] = {0};
+    unsigned char buffer[TAMANHO_BUFFER];
+    size_t lidos;
+
+    // Ler o arquivo em blocos até o final (incluindo bytes 0x00)
+    while ((lidos = fread(buffer, 1, sizeof(buffer), arquivo)) > 0) {
+        contarBytes(buffer, lidos, contagem);
+    }
+
+    normalizarFrequencias(contagem, frequencias);
+}
+
+// Procedimento para estimar as frequências lendo só algumas janelas do arquivo.
+// Todo símbolo recebe peso mínimo 1, então bytes que não caíram na amostra
+// continuam codificáveis (só ganham um código mais longo).
+static void amostrarFrequenciasArquivo(FILE* arquivo, long tamanhoArquivo, int divisor, int frequencias[256]) {
+    uint64_t contagem[256];
+    unsigned char buffer[JANELA_AMOSTRA];
+
+    // Peso mínimo para todos os 256 símbolos
+    for (int i = 0; i < 256; i++) {
+        contagem[i] = 1;
+    }
+
+    long bytesAmostra = tamanhoArquivo / divisor;
+    if (bytesAmostra < AMOSTRA_MINIMA) bytesAmostra = AMOSTRA_MINIMA;
+    long numJanelas = (bytesAmostra + JANELA_AMOSTRA - 1) / JANELA_AMOSTRA;
+    long passo = tamanhoArquivo / numJanelas;
+
+    // Janelas espalhadas igualmente pelo arquivo
+    for (long j = 0; j < numJanelas; j++) {
+        if (fseek(arquivo, j * passo, SEEK_SET) != 0) break;
+        size_t lidos = fread(buffer, 1, sizeof(buffer), arquivo);
+        for (size_t i = 0; i < lidos; i++) {
+            contagem[buffer[i]]++;
+        }
+    }
+
+    normalizarFrequencias(contagem, frequencias);
+}
+#endif
+
+// Função para inserir nó na lista mantendo a ordenação por frequência
+static struct No* inserirOrdenado(struct No* cabeca, struct No* novoNo) {
+    // Caso 1: Lista vazia ou novo nó deve ser a nova cabeça
+    if (cabeca == NULL || novoNo->frequencia < cabeca->frequencia) {
+        novoNo->proximo = cabeca;
+        return novoNo;
+    }
+
+    // Caso 2: Percorrer a lista para encontrar posição correta
+    struct No* atual = cabeca;
+    while (atual->proximo != NULL && atual->proximo->frequencia <= novoNo->frequencia) {
+        atual = atual->proximo;
+    }
+
+    // Inserir o novo nó na posição encontrada
+    novoNo->proximo = atual->proximo;
+    atual->proximo = novoNo;
+    return cabeca;
+}
+
+// Função para construir a lista de frequência a partir do array de frequências
+static struct No* construirListaFrequencia(const int frequencias[256], struct ReservaNos* reserva) {
+    struct No* cabeca = NULL;
+
+    // Percorrer todos os 256 valores possíveis de byte
+    for (int i = 0; i < 256; i++) {
+        // Verificar se o byte aparece pelo menos uma vez
+        if (frequencias[i] > 0) {
+            // Criar novo nó para o símbolo com sua frequência
+            struct No* novoNo = criarNo(reserva, (unsigned char)i, frequencias[i]);
+
+            // Inserir na lista mantendo ordenação por frequência
+            cabeca = inserirOrdenado(cabeca, novoNo);
+        }
+    }
+    return cabeca;
+}
+
+/*
+ ============================================================================
+ PARTE 2: CONSTRUÇÃO DA ÁRVORE DE HUFFMAN
+ ============================================================================
+*/
+
+// Função para remover o primeiro nó da lista
+static struct No* removerPrimeiroNo(struct No** cabeca) {
+    if (*cabeca == NULL) {
+        return NULL;
+    }
+
+    struct No* primeiro = *cabeca;      // Primeiro nó a ser removido
+    *cabeca = (*cabeca)->proximo;       // Atualiza cabeça para o próximo
+    primeiro->proximo = NULL;           // Isola o nó removido
+
+    return primeiro;
+}
+
+// Procedimento para construir a árvore de Huffman
+static struct No* construirArvoreHuffman(struct No* cabeca, struct ReservaNos* reserva) {
+    if (cabeca == NULL) {
+#ifndef HUFF_BIBLIOTECA
+        printf("Erro: Lista de frequência vazia.\n");
+#endif
+        return NULL;
+    }
+
+    // Continuar enquanto houver mais de 1 nó na lista
+    while (cabeca != NULL && cabeca->proximo != NULL) {
+
+        // Passo 1: Remover os dois primeiros nós da lista
+        struct No* primeiro = removerPrimeiroNo(&cabeca);
+        struct No* segundo = removerPrimeiroNo(&cabeca);
+
+        // Passo 2: Criar novo nó interno com '*' (nó da árvore)
+        struct No* novoNo = criarNo(reserva, '*', primeiro->frequencia + segundo->frequencia);
+
+        // Passo 3: Configurar os ponteiros esquerdo e direito
+        novoNo->esquerdo = primeiro;
+        novoNo->direito = segundo;
+
+        // Passo 4: Inserir o novo nó de volta na lista ordenadamente
+        cabeca = inserirOrdenado(cabeca, novoNo);
+    }
+
+    // Retornar a nova cabeça (que será a raiz da árvore)
+    return cabeca;
+}
+
+/*
+ ============================================================================
+ PARTE 3: DICIONÁRIO COMPACTO (CÓDIGOS CANÔNICOS DE TAMANHO LIMITADO)
+ ============================================================================
+*/
+
+// Entrada do dicionário compacto: bits do código alinhados à direita + tamanho
+struct CodigoHuffman {
+    uint32_t codigo;
+    uint8_t tamanho;
+};
+
+// Procedimento para medir a profundidade de cada folha (tamanho do código)
+static void calcularTamanhosCodigos(struct No* no, int profundidade, int tamanhos[256]) {
+    if (no == NULL) {
+        return;
+    }
+
+    // Folha: a profundidade é o tamanho do código
+    if (no->esquerdo == NULL && no->direito == NULL) {
+        tamanhos[no->simbolo] = profundidade;
+        return;
+    }
+
+    calcularTamanhosCodigos(no->esquerdo, profundidade + 1, tamanhos);
+    calcularTamanhosCodigos(no->direito, profundidade + 1, tamanhos);
+}
+
+// Procedimento para limitar os códigos a 'limite' bits mantendo a desigualdade
+// de Kraft (soma de 2^-tamanho == 1, ou seja, árvore cheia)
+static void limitarTamanhosCodigos(int tamanhos[256], const int frequencias[256], int limite) {
+    long long capacidade = 1LL << limite;
+    long long kraft = 0;
+
+    // Passo 1: cortar os códigos longos demais
+    for (int i = 0; i < 256; i++) {
+        if (tamanhos[i] > limite) tamanhos[i] = limite;
+        if (tamanhos[i] > 0) kraft += 1LL << (limite - tamanhos[i]);
+    }
+
+    // Passo 2: enquanto a árvore "transbordar", alongar o código mais longo
+    // que ainda está abaixo do limite (é o que custa menos)
+    while (kraft > capacidade) {
+        int escolhido = -1;
+        for (int i = 0; i < 256; i++) {
+            if (tamanhos[i] > 0 && tamanhos[i] < limite) {
+                if (escolhido < 0 || tamanhos[i] > tamanhos[escolhido] ||
+                    (tamanhos[i] == tamanhos[escolhido] && frequencias[i] < frequencias[escolhido])) {
+                    escolhido = i;
+                }
+            }
+        }
+        kraft -= 1LL << (limite - tamanhos[escolhido] - 1);
+        tamanhos[escolhido]++;
+    }
+
+    // Passo 3: devolver a sobra encurtando primeiro os símbolos mais frequentes
+    int ordem[256];
+    int n = 0;
+    for (int i = 0; i < 256; i++) {
+        if (tamanhos[i] > 0) ordem[n++] = i;
+    }
+    for (int i = 1; i < n; i++) {
+        int atual = ordem[i];
+        int j = i - 1;
+        while (j >= 0 && frequencias[ordem[j]] < frequencias[atual]) {
+            ordem[j + 1] = ordem[j];
+            j--;
+        }
+        ordem[j + 1] = atual;
+    }
+    for (int i = 0; i < n; i++) {
+        int s = ordem[i];
+        while (tamanhos[s] > 1 && kraft + (1LL << (limite - tamanhos[s])) <= capacidade) {
+            kraft += 1LL << (limite - tamanhos[s]);
+            tamanhos[s]--;
+        }
+    }
+
+    // Passo 4: fechar a árvore encurtando os códigos mais longos
+    while (kraft < capacidade) {
+        int escolhido = -1;
+        for (int i = 0; i < 256; i++) {
+            if (tamanhos[i] > 1 && (escolhido < 0 || tamanhos[i] > tamanhos[escolhido])) {
+                escolhido = i;
+            }
+        }
+        if (escolhido < 0) break;
+        kraft += 1LL << (limite - tamanhos[escolhido]);
+        tamanhos[escolhido]--;
+    }
+}
+
+// Procedimento para gerar códigos canônicos a partir dos tamanhos
+// (mesmo tamanho => ordem crescente de símbolo)
+static void gerarCodigosCanonicos(const int tamanhos[256], struct CodigoHuffman dicionario[256]) {
+    int quantidade[TAMANHO_MAXIMO_CODIGO + 1] = {0};
+    uint32_t proximo[TAMANHO_MAXIMO_CODIGO + 2];
+
+    for (int i = 0; i < 256; i++) {
+        quantidade[tamanhos[i]]++;
+    }
+    quantidade[0] = 0;
+
+    uint32_t codigo = 0;
+    for (int t = 1; t <= TAMANHO_MAXIMO_CODIGO; t++) {
+        codigo = (codigo + quantidade[t - 1]) << 1;
+        proximo[t] = codigo;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        dicionario[i].tamanho = (uint8_t)tamanhos[i];
+        dicionario[i].codigo = tamanhos[i] > 0 ? proximo[tamanhos[i]]++ : 0;
+    }
+}
+
+// Função para montar o dicionário compacto a partir das frequências.
+// Retorna o número de símbolos presentes.
+static int construirDicionario(const int frequencias[256], struct CodigoHuffman dicionario[256]) {
+    int tamanhos[256] = {0};
+    int presentes = 0;
+    int unico = 0;
+
+    for (int i = 0; i < 256; i++) {
+        if (frequencias[i] > 0) {
+            presentes++;
+            unico = i;
+        }
+    }
+
+    if (presentes == 0) {
+        memset(dicionario, 0, 256 * sizeof(struct CodigoHuffman));
+        return 0;
+    }
+
+    if (presentes == 1) {
+        // Árvore de uma folha não gera bits: criar uma folha irmã fictícia
+        tamanhos[unico] = 1;
+        tamanhos[(unico + 1) & 0xFF] = 1;
+    } else {
+        // PARTE 1 + PARTE 2: lista ordenada e árvore de Huffman
+        struct ReservaNos reserva;
+        reserva.usados = 0;
+        struct No* lista = construirListaFrequencia(frequencias, &reserva);
+        struct No* raiz = construirArvoreHuffman(lista, &reserva);
+        calcularTamanhosCodigos(raiz, 0, tamanhos);
+        limitarTamanhosCodigos(tamanhos, frequencias, TAMANHO_MAXIMO_CODIGO);
+    }
+
+    gerarCodigosCanonicos(tamanhos, dicionario);
+    return presentes;
+}
+
+// Função para reconstruir a árvore (struct No) a partir dos códigos canônicos,
+// usada para gravar o cabeçalho em pré-ordem
+static struct No* construirArvoreCanonica(const struct CodigoHuffman dicionario[256], struct ReservaNos* reserva) {
+    struct No* raiz = criarNo(reserva, '*', 0);
+
+    for (int s = 0; s < 256; s++) {
+        if (dicionario[s].tamanho == 0) continue;
+
+        struct No* atual = raiz;
+        for (int b = dicionario[s].tamanho - 1; b >= 0; b--) {
+            struct No** proximo = ((dicionario[s].codigo >> b) & 1) ? &atual->direito : &atual->esquerdo;
+            if (*proximo == NULL) {
+                *proximo = criarNo(reserva, '*', 0);
+            }
+            atual = *proximo;
+        }
+        atual->simbolo = (unsigned char)s;
+    }
+    return raiz;
+}
+
+/*
+ ============================================================================
+ PARTE 4: ESCRITA E LEITURA DE BITS
+ ============================================================================
+*/
+
+// Escritor de bits com acumulador de 64 bits (bit mais significativo primeiro).
+// Com 'arquivo' != NULL o buffer é descarregado no arquivo quando enche;
+// com NULL os bits ficam só na memória e o buffer precisa comportar tudo.
+struct EscritorBits {
+    FILE* arquivo;
+    unsigned char* buffer;
+    size_t capacidade;
+    size_t posicao;
+    uint64_t acumulador;
+    int bitsPendentes;
+};
+
+// Procedimento para mandar bytes a um arquivo. Na biblioteca (-DHUFF_BIBLIOTECA)
+// os escritores e as saídas de blocos nunca têm arquivo, e o objeto compilado
+// fica sem nenhuma referência ao stdio.
+static void gravarArquivo(FILE* arquivo, const void* dados, size_t tamanho) {
+#ifdef HUFF_BIBLIOTECA
+    (void)arquivo;
+    (void)dados;
+    (void)tamanho;
+#else
+    fwrite(dados, 1, tamanho, arquivo);
+#endif
+}
+
+static void iniciarEscritor(struct EscritorBits* escritor, unsigned char* buffer, size_t capacidade, FILE* arquivo) {
+    escritor->arquivo = arquivo;
+    escritor->buffer = buffer;
+    escritor->capacidade = capacidade;
+    escritor->posicao = 0;
+    escritor->acumulador = 0;
+    escritor->bitsPendentes = 0;
+}
+
+static inline void escreverBits(struct EscritorBits* escritor, uint32_t codigo, int tamanho) {
+    escritor->acumulador = (escritor->acumulador << tamanho) | codigo;
+    escritor->bitsPendentes += tamanho;
+
+    // Descarregar 32 bits de uma vez
+    if (escritor->bitsPendentes >= 32) {
+        escritor->bitsPendentes -= 32;
+        uint32_t palavra = (uint32_t)(escritor->acumulador >> escritor->bitsPendentes);
+        unsigned char* p = escritor->buffer + escritor->posicao;
+        p[0] = (unsigned char)(palavra >> 24);
+        p[1] = (unsigned char)(palavra >> 16);
+        p[2] = (unsigned char)(palavra >> 8);
+        p[3] = (unsigned char)palavra;
+        escritor->posicao += 4;
+
+        if (escritor->arquivo && escritor->posicao + 4 > escritor->capacidade) {
+            gravarArquivo(escritor->arquivo, escritor->buffer, escritor->posicao);
+            escritor->posicao = 0;
+        }
+    }
+}
+
+// Procedimento para codificar 'n' bytes com 'dicionario', quatro por vez. Os
+// códigos têm até TAMANHO_MAXIMO_CODIGO (16) bits, então cada par é unido numa
+// palavra de até 32 bits antes de entrar no acumulador: metade dos
+// deslocamentos e dos testes de descarga. O estado do escritor fica em
+// variáveis locais durante o laço; com os campos da struct, cada byte gravado
+// no buffer obrigaria o compilador a reler o acumulador da memória.
+static void codificarBytes(struct EscritorBits* escritor, const unsigned char* dados, size_t n,
+                           const struct CodigoHuffman dicionario[256]) {
+    uint64_t acumulador = escritor->acumulador;
+    int pendentes = escritor->bitsPendentes;
+    unsigned char* buffer = escritor->buffer;
+    size_t posicao = escritor->posicao;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const struct CodigoHuffman* a = &dicionario[dados[i]];
+        const struct CodigoHuffman* b = &dicionario[dados[i + 1]];
+        const struct CodigoHuffman* c = &dicionario[dados[i + 2]];
+        const struct CodigoHuffman* d = &dicionario[dados[i + 3]];
+        uint32_t pares[2] = {(a->codigo << b->tamanho) | b->codigo, (c->codigo << d->tamanho) | d->codigo};
+        int tamanhos[2] = {a->tamanho + b->tamanho, c->tamanho + d->tamanho};
+
+        for (int p = 0; p < 2; p++) {
+            acumulador = (acumulador << tamanhos[p]) | pares[p];
+            pendentes += tamanhos[p];
+
+            // Descarregar 32 bits de uma vez (como em escreverBits)
+            if (pendentes >= 32) {
+                pendentes -= 32;
+                uint32_t palavra = (uint32_t)(acumulador >> pendentes);
+                buffer[posicao] = (unsigned char)(palavra >> 24);
+                buffer[posicao + 1] = (unsigned char)(palavra >> 16);
+                buffer[posicao + 2] = (unsigned char)(palavra >> 8);
+                buffer[posicao + 3] = (unsigned char)palavra;
+                posicao += 4;
+
+                if (escritor->arquivo && posicao + 4 > escritor->capacidade) {
+                    gravarArquivo(escritor->arquivo, buffer, posicao);
+                    posicao = 0;
+                }
+            }
+        }
+    }
+
+    escritor->acumulador = acumulador;
+    escritor->bitsPendentes = pendentes;
+    escritor->posicao = posicao;
+
+    // Últimos 0 a 3 bytes
+    for (; i < n; i++) {
+        escreverBits(escritor, dicionario[dados[i]].codigo, dicionario[dados[i]].tamanho);
+    }
+}
+
+// Função para gravar os bits restantes. Retorna os bits de lixo do último byte.
+static int finalizarEscritor(struct EscritorBits* escritor) {
+    while (escritor->bitsPendentes >= 8) {
+        escritor->bitsPendentes -= 8;
+        escritor->buffer[escritor->posicao++] = (unsigned char)(escritor->acumulador >> escritor->bitsPendentes);
+    }
+
+    int lixo = 0;
+    if (escritor->bitsPendentes > 0) {
+        lixo = 8 - escritor->bitsPendentes;
+        escritor->buffer[escritor->posicao++] = (unsigned char)(escritor->acumulador << lixo);
+        escritor->bitsPendentes = 0;
+    }
+
+    if (escritor->arquivo) {
+        gravarArquivo(escritor->arquivo, escritor->buffer, escritor->posicao);
+        escritor->posicao = 0;
+    }
+    return lixo;
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Procedimento para completar o byte atual com zeros e mandar tudo ao arquivo;
+// usado no modo ao vivo para o leitor não ficar esperando os bits seguintes
+static void descarregarEscritor(struct EscritorBits* escritor) {
+    int sobra = escritor->bitsPendentes % 8;
+    if (sobra > 0) {
+        escreverBits(escritor, 0, 8 - sobra);
+    }
+    while (escritor->bitsPendentes >= 8) {
+        escritor->bitsPendentes -= 8;
+        escritor->buffer[escritor->posicao++] = (unsigned char)(escritor->acumulador >> escritor->bitsPendentes);
+    }
+    fwrite(escritor->buffer, 1, escritor->posicao, escritor->arquivo);
+    escritor->posicao = 0;
+    fflush(escritor->arquivo);
+}
+#endif
+
+// Leitor de bits sobre um bloco em memória (bit mais significativo primeiro)
+struct LeitorBits {
+    const unsigned char* dados;
+    size_t tamanho;
+    size_t posicao;
+    uint64_t buffer;             // Próximos bits alinhados à esquerda
+    int bits;                    // Quantos bits válidos há no buffer
+};
+
+static void iniciarLeitor(struct LeitorBits* leitor, const unsigned char* dados, size_t tamanho) {
+    leitor->dados = dados;
+    leitor->tamanho = tamanho;
+    leitor->posicao = 0;
+    leitor->buffer = 0;
+    leitor->bits = 0;
+}
+
+// Completar o buffer; depois do fim dos dados entram zeros
+static inline void recarregarBits(struct LeitorBits* leitor) {
+    while (leitor->bits <= 56) {
+        uint64_t byte = leitor->posicao < leitor->tamanho ? leitor->dados[leitor->posicao] : 0;
+        leitor->posicao++;
+        leitor->buffer |= byte << (56 - leitor->bits);
+        leitor->bits += 8;
+    }
+}
+
+// Função para ler 'tamanho' bits crus (até 32) do leitor
+static inline uint32_t lerBits(struct LeitorBits* leitor, int tamanho) {
+    if (tamanho == 0) return 0;
+    if (leitor->bits < tamanho) recarregarBits(leitor);
+
+    uint32_t valor = (uint32_t)(leitor->buffer >> (64 - tamanho));
+    leitor->buffer <<= tamanho;
+    leitor->bits -= tamanho;
+    return valor;
+}
+
+/*
+ ============================================================================
+ PARTE 5: ÁRVORE DO CABEÇALHO E TABELA DE DECODIFICAÇÃO
+ ============================================================================
+*/
+
+// Procedimento para escrever a árvore em pré-ordem na memória (com caractere de escape '\\')
+static void escreverArvorePreOrdem(struct No* raiz, unsigned char* destino, int* posicao) {
+    if (raiz == NULL) return;
+
+    // Folha com o mesmo valor do marcador de nó interno precisa de escape
+    if (raiz->esquerdo == NULL && raiz->direito == NULL &&
+        (raiz->simbolo == '*' || raiz->simbolo == '\\')) {
+        destino[(*posicao)++] = '\\';
+    }
+
+    // Escrever o símbolo do nó
+    destino[(*posicao)++] = raiz->simbolo;
+
+    // Recursão para subárvores
+    escreverArvorePreOrdem(raiz->esquerdo, destino, posicao);
+    escreverArvorePreOrdem(raiz->direito, destino, posicao);
+}
+
+// Função para gravar em pré-ordem a árvore canônica de um dicionário
+// ('destino' com 2 * MAXIMO_NOS bytes). Retorna o tamanho da árvore.
+static int escreverArvoreDicionario(const struct CodigoHuffman dicionario[256], unsigned char* destino) {
+    struct ReservaNos reserva;
+    reserva.usados = 0;
+    int tamanho = 0;
+    escreverArvorePreOrdem(construirArvoreCanonica(dicionario, &reserva), destino, &tamanho);
+    return tamanho;
+}
+
+// Árvore "plana" (vetores em vez de ponteiros) usada pelo descompactador
+struct ArvoreDecodificacao {
+    int16_t esquerdo[MAXIMO_NOS];
+    int16_t direito[MAXIMO_NOS];
+    unsigned char simbolo[MAXIMO_NOS];
+    int numNos;
+
+    // Entrada da tabela: folha = simbolo | tamanho << 8; código maior que
+    // BITS_TABELA = 0x8000 | nó alcançado depois de BITS_TABELA bits
+    uint16_t tabela[1 << BITS_TABELA];
+};
+
+// Função recursiva para ler a árvore em pré-ordem. Retorna o índice do nó ou -1.
+static int lerArvorePreOrdem(const unsigned char* dados, int tamanho, int* posicao,
+                             struct ArvoreDecodificacao* arvore) {
+    if (*posicao >= tamanho || arvore->numNos >= MAXIMO_NOS) {
+        return -1;
+    }
+
+    int indice = arvore->numNos++;
+    unsigned char byte = dados[(*posicao)++];
+    arvore->esquerdo[indice] = -1;
+    arvore->direito[indice] = -1;
+
+    if (byte == '*') {
+        // Nó interno: ler subárvore esquerda e direita
+        int esquerdo = lerArvorePreOrdem(dados, tamanho, posicao, arvore);
+        int direito = lerArvorePreOrdem(dados, tamanho, posicao, arvore);
+        if (esquerdo < 0 || direito < 0) return -1;
+        arvore->esquerdo[indice] = (int16_t)esquerdo;
+        arvore->direito[indice] = (int16_t)direito;
+        arvore->simbolo[indice] = '*';
+    } else {
+        // Folha (com escape, o próximo byte é o símbolo literal)
+        if (byte == '\\') {
+            if (*posicao >= tamanho) return -1;
+            byte = dados[(*posicao)++];
+        }
+        arvore->simbolo[indice] = byte;
+    }
+    return indice;
+}
+
+// Procedimento recursivo para preencher a tabela de decodificação
+static void preencherTabela(struct ArvoreDecodificacao* arvore, int no, int profundidade, uint32_t prefixo) {
+    int folha = arvore->esquerdo[no] < 0;
+
+    if (folha) {
+        // Todas as entradas que começam com este prefixo levam a esta folha
+        int livres = BITS_TABELA - profundidade;
+        uint32_t inicio = prefixo << livres;
+        uint16_t entrada = (uint16_t)(arvore->simbolo[no] | (profundidade << 8));
+        for (uint32_t i = 0; i < (1u << livres); i++) {
+            arvore->tabela[inicio + i] = entrada;
+        }
+        return;
+    }
+
+    if (profundidade == BITS_TABELA) {
+        // Código longo: continuar bit a bit a partir deste nó
+        arvore->tabela[prefixo] = (uint16_t)(0x8000 | no);
+        return;
+    }
+
+    preencherTabela(arvore, arvore->esquerdo[no], profundidade + 1, prefixo << 1);
+    preencherTabela(arvore, arvore->direito[no], profundidade + 1, (prefixo << 1) | 1);
+}
+
+// Função para montar a árvore plana + tabela a partir do cabeçalho em pré-ordem.
+// Uma árvore de uma folha só é aceita (no formato em blocos ela vale 0 bits).
+static int montarArvoreDecodificacao(const unsigned char* dados, int tamanho, struct ArvoreDecodificacao* arvore) {
+    int posicao = 0;
+    arvore->numNos = 0;
+
+    if (lerArvorePreOrdem(dados, tamanho, &posicao, arvore) != 0 || posicao != tamanho) {
+        return -1;
+    }
+
+    if (arvore->esquerdo[0] >= 0) {
+        preencherTabela(arvore, 0, 0, 0);
+    }
+    return 0;
+}
+
+// Função para montar a árvore plana + tabela de decodificação direto de um
+// dicionário (passando pela árvore em pré-ordem, como se viesse do cabeçalho)
+static int montarDecodificacaoDicionario(const struct CodigoHuffman dicionario[256],
+                                         struct ArvoreDecodificacao* arvore) {
+    unsigned char preOrdem[2 * MAXIMO_NOS];
+    int posicao = escreverArvoreDicionario(dicionario, preOrdem);
+    return montarArvoreDecodificacao(preOrdem, posicao, arvore);
+}
+
+// Função para decodificar um símbolo com a tabela (e, se o código for longo,
+// descendo o resto do caminho na árvore plana)
+static inline unsigned char decodificarUmSimbolo(const struct ArvoreDecodificacao* arvore,
+                                                 struct LeitorBits* leitor, long long* lidos) {
+    if (leitor->bits < 32) recarregarBits(leitor);
+
+    uint16_t entrada = arvore->tabela[leitor->buffer >> (64 - BITS_TABELA)];
+    if (!(entrada & 0x8000)) {
+        // Caso comum: código inteiro resolvido pela tabela
+        int tamanho = entrada >> 8;
+        leitor->buffer <<= tamanho;
+        leitor->bits -= tamanho;
+        *lidos += tamanho;
+        return (unsigned char)entrada;
+    }
+
+    // Código longo: terminar de descer na árvore
+    int no = entrada & 0x7FFF;
+    leitor->buffer <<= BITS_TABELA;
+    leitor->bits -= BITS_TABELA;
+    *lidos += BITS_TABELA;
+    while (arvore->esquerdo[no] >= 0) {
+        if (leitor->bits == 0) recarregarBits(leitor);
+        no = (leitor->buffer >> 63) ? arvore->direito[no] : arvore->esquerdo[no];
+        leitor->buffer <<= 1;
+        leitor->bits--;
+        (*lidos)++;
+    }
+    return arvore->simbolo[no];
+}
+
+// Função para decodificar 'totalBits' bits do leitor. Retorna símbolos gravados
+// em 'saida' (até 'capacidade') e atualiza 'bitsLidos'.
+static size_t decodificarSimbolos(const struct ArvoreDecodificacao* arvore, struct LeitorBits* leitor,
+                                  long long totalBits, long long* bitsLidos,
+                                  unsigned char* saida, size_t capacidade) {
+    size_t n = 0;
+    long long lidos = *bitsLidos;
+
+    while (n < capacidade && lidos < totalBits) {
+        saida[n++] = decodificarUmSimbolo(arvore, leitor, &lidos);
+    }
+
+    *bitsLidos = lidos;
+    return n;
+}
+
+/*
+ ============================================================================
+ PARTE 6: COMPACTAÇÃO NO FORMATO LEGADO (UM ÚNICO FLUXO DE BITS)
+ ============================================================================
+*/
+
+#ifndef HUFF_BIBLIOTECA
+// Função para obter o tamanho do arquivo (-1 se não for possível)
+static long tamanhoArquivo(FILE* arquivo) {
+    if (fseek(arquivo, 0, SEEK_END) != 0) return -1;
+    long tamanho = ftell(arquivo);
+    fseek(arquivo, 0, SEEK_SET);
+    return tamanho;
+}
+
+// Função para abrir um arquivo; "-" representa a entrada/saída padrão
+static FILE* abrirArquivo(const char* nome, const char* modo) {
+    if (strcmp(nome, "-") == 0) {
+        return modo[0] == 'r' ? stdin : stdout;
+    }
+    return fopen(nome, modo);
+}
+
+// Procedimento para fechar um arquivo aberto com abrirArquivo
+static void fecharArquivo(FILE* arquivo) {
+    if (arquivo == stdin || arquivo == stdout) {
+        fflush(arquivo);
+    } else {
+        fclose(arquivo);
+    }
+}
+
+#endif
+
+// Procedimento para montar os 2 bytes do cabeçalho (3 bits lixo + 13 bits árvore)
+static void montarCabecalho(unsigned char destino[2], int lixo, int tamanho_arvore) {
+    unsigned short cabecalho = (unsigned short)(((lixo & 0x07) << 13) | (tamanho_arvore & 0x1FFF));
+    destino[0] = (unsigned char)(cabecalho >> 8);
+    destino[1] = (unsigned char)(cabecalho & 0xFF);
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Função para montar a tabela do formato legado e gravar o cabeçalho provisório
+// (lixo 0) com a árvore. Níveis 1-3 montam a árvore com um histograma amostrado.
+// Retorna o tamanho da árvore; 0 = arquivo vazio, já gravado só com o cabeçalho.
+static int iniciarArquivoLegado(FILE* entrada, FILE* saida, int nivel, struct CodigoHuffman dicionario[256]) {
+    // PARTE 1: histograma exato ou amostrado, conforme o nível
+    int frequencias[256];
+    long tamanho = tamanhoArquivo(entrada);
+    int divisor = configuracoesNivel[nivel].divisorAmostra;
+
+    if (divisor > 0 && tamanho > AMOSTRA_MINIMA) {
+        amostrarFrequenciasArquivo(entrada, tamanho, divisor, frequencias);
+    } else {
+        contarFrequenciasArquivo(entrada, frequencias);
+    }
+
+    // Arquivo vazio: só o cabeçalho zerado
+    unsigned char cabecalho[2];
+    if (construirDicionario(frequencias, dicionario) == 0) {
+        montarCabecalho(cabecalho, 0, 0);
+        fwrite(cabecalho, 1, 2, saida);
+        return 0;
+    }
+
+    // PARTE 2 e 3: árvore canônica para o cabeçalho
+    unsigned char arvore[2 * MAXIMO_NOS];
+    int tamanho_arvore = escreverArvoreDicionario(dicionario, arvore);
+
+    // Cabeçalho provisório; os bits de lixo só são conhecidos no final
+    montarCabecalho(cabecalho, 0, tamanho_arvore);
+    fwrite(cabecalho, 1, 2, saida);
+    fwrite(arvore, 1, (size_t)tamanho_arvore, saida);
+    return tamanho_arvore;
+}
+
+// Função principal de compactação no formato legado: uma passada para o
+// histograma (ou a amostra) e outra para os bits
+static int compactarArquivoLegado(const char* nome_entrada, const char* nome_saida, int nivel) {
+    FILE* entrada = fopen(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = fopen(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fclose(entrada);
+        return 1;
+    }
+
+    struct CodigoHuffman dicionario[256];
+    int tamanho_arvore = iniciarArquivoLegado(entrada, saida, nivel, dicionario);
+    if (tamanho_arvore == 0) {
+        fclose(entrada);
+        fclose(saida);
+        return 0;
+    }
+
+    // PARTE 4: empacotar os códigos direto em bits
+    unsigned char* buffer = (unsigned char*)malloc(TAMANHO_BUFFER);
+    unsigned char* bufferSaida = (unsigned char*)malloc(TAMANHO_BUFFER);
+    if (!buffer || !bufferSaida) {
+        printf("Erro na alocação de memória.\n");
+        free(buffer);
+        free(bufferSaida);
+        fclose(entrada);
+        fclose(saida);
+        return 1;
+    }
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, bufferSaida, TAMANHO_BUFFER, saida);
+
+    fseek(entrada, 0, SEEK_SET);
+    size_t lidos;
+    while ((lidos = fread(buffer, 1, TAMANHO_BUFFER, entrada)) > 0) {
+        codificarBytes(&escritor, buffer, lidos, dicionario);
+    }
+
+    int lixo = finalizarEscritor(&escritor);
+
+    // Corrigir o cabeçalho com os bits de lixo reais
+    unsigned char cabecalho[2];
+    montarCabecalho(cabecalho, lixo, tamanho_arvore);
+    fseek(saida, 0, SEEK_SET);
+    fwrite(cabecalho, 1, 2, saida);
+
+    free(buffer);
+    free(bufferSaida);
+    fclose(entrada);
+    fclose(saida);
+    return 0;
+}
+
+/*
+ ============================================================================
+ PARTE 7: DESCOMPACTAÇÃO NO FORMATO LEGADO (ÁRVORE LIDA DO CABEÇALHO)
+ ============================================================================
+*/
+
+// Função para ler um arquivo inteiro para a memória
+static unsigned char* lerArquivoInteiro(FILE* arquivo, long* tamanho) {
+    *tamanho = tamanhoArquivo(arquivo);
+    if (*tamanho < 0) {
+        return NULL;
+    }
+
+    unsigned char* dados = (unsigned char*)malloc(*tamanho > 0 ? (size_t)*tamanho : 1);
+    if (dados && fread(dados, 1, (size_t)*tamanho, arquivo) != (size_t)*tamanho) {
+        free(dados);
+        dados = NULL;
+    }
+    return dados;
+}
+
+// Função para ler o cabeçalho e a árvore de um .huff legado já em memória.
+// Retorna 0 (árvore montada; 'inicio' e 'totalBits' delimitam os bits), 1 se
+// o arquivo original era vazio ou -1 se o cabeçalho for inválido.
+static int lerCabecalhoLegado(const unsigned char* dados, long tamanho, struct ArvoreDecodificacao* arvore,
+                              size_t* inicio, long long* totalBits) {
+    if (tamanho < 2) return -1;
+
+    // LER CABEÇALHO
+    unsigned short cabecalho = (unsigned short)((dados[0] << 8) | dados[1]);
+    int lixo = (cabecalho >> 13) & 0x07;
+    int tamanho_arvore = cabecalho & 0x1FFF;
+
+    // Arquivo original vazio
+    if (tamanho_arvore == 0 && tamanho == 2) {
+        return 1;
+    }
+
+    // RECONSTRUIR ÁRVORE A PARTIR DA PRÉ-ORDEM
+    if (2 + tamanho_arvore > tamanho || montarArvoreDecodificacao(dados + 2, tamanho_arvore, arvore) != 0 ||
+        arvore->esquerdo[0] < 0) {
+        return -1;
+    }
+
+    *inicio = 2 + (size_t)tamanho_arvore;
+    *totalBits = (long long)(tamanho - (long)*inicio) * 8 - lixo;
+    return 0;
+}
+
+// Função de descompactação do formato legado (arquivo inteiro em memória)
+static int descompactarArquivoLegado(FILE* entrada, FILE* saida) {
+    long tamanho;
+    unsigned char* dados = lerArquivoInteiro(entrada, &tamanho);
+    struct ArvoreDecodificacao* arvore = (struct ArvoreDecodificacao*)malloc(sizeof(struct ArvoreDecodificacao));
+    unsigned char* buffer = (unsigned char*)malloc(TAMANHO_BUFFER);
+    size_t inicio = 0;
+    long long totalBits = 0;
+    int cabecalho = dados && arvore && buffer ? lerCabecalhoLegado(dados, tamanho, arvore, &inicio, &totalBits) : -1;
+    if (cabecalho != 0) {
+        if (cabecalho < 0) printf("Erro: Cabeçalho inválido ou arquivo corrompido\n");
+        free(arvore);
+        free(buffer);
+        free(dados);
+        return cabecalho < 0 ? 1 : 0;
+    }
+
+    // DECODIFICAR DADOS
+    long long bitsLidos = 0;
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + inicio, (size_t)tamanho - inicio);
+
+    while (bitsLidos < totalBits) {
+        size_t n = decodificarSimbolos(arvore, &leitor, totalBits, &bitsLidos, buffer, TAMANHO_BUFFER);
+        fwrite(buffer, 1, n, saida);
+    }
+
+    int status = 0;
+    if (bitsLidos != totalBits) {
+        printf("Erro: Dados compactados truncados ou corrompidos\n");
+        status = 1;
+    }
+
+    free(arvore);
+    free(buffer);
+    free(dados);
+    return status;
+}
+#endif
+
+/*
+ ============================================================================
+ PARTE 8: FORMATO EM BLOCOS COM DIVISÃO ADAPTATIVA
+ ============================================================================
+ Estrutura do arquivo:
+   "HUFB" + versão (1 byte)
+   blocos: tipo (1 byte) + tamanho original (varint) + tamanho dos dados (varint) + dados
+   um bloco do tipo BLOCO_FIM encerra o arquivo
+ Os dados de um bloco Huffman têm o mesmo layout do .huff legado:
+ 3 bits lixo + 13 bits árvore + árvore em pré-ordem + bits.
+*/
+
+#define MAGICO_BLOCOS "HUFB"
+#define VERSAO_BLOCOS 1
+#define TAMANHO_JANELA (1024 * 1024)   // Dados analisados de uma vez pelo divisor de blocos
+#define CUSTO_FIXO_BLOCO 8             // Bytes aproximados de tipo + varints + cabeçalho Huffman
+#define PEDACO_MINIMO 4096             // Menor granularidade aceita em tamanhoPedaco
+#define TAMANHO_GRUPO 50               // Símbolos por seletor no modo com várias tabelas
+#define MAXIMO_TABELAS 6
+#define MINIMO_MULTI_TABELA (16 * 1024) // Blocos menores não pagam as árvores extras
+#define MAXIMO_GRUPOS_CONTEXTO 32      // Tabelas do modo de ordem 1 (contextos agrupados)
+#define MINIMO_ORDEM1 (16 * 1024)
+
+enum TipoBloco {
+    BLOCO_FIM = 0,
+    BLOCO_ARMAZENADO = 1,              // Bytes originais sem compressão
+    BLOCO_HUFFMAN = 2,                 // Árvore própria + bits
+    BLOCO_HUFFMAN_REPETIDO = 3,        // Bits com a tabela do último bloco Huffman
+    BLOCO_MULTI_TABELA = 4,            // Até 6 tabelas + seletor a cada 50 símbolos
+    BLOCO_ORDEM1 = 5,                  // Tabela escolhida pelo byte anterior
+    BLOCO_LZ77 = 6,                    // Só no formato LZ77: literais/comprimentos + distâncias
+    BLOCO_TANS = 7,                    // Contagens normalizadas + estados do tANS
+    BLOCO_COLUNAS = 8,                 // Tamanho do registro; os blocos seguintes são as colunas da janela
+    BLOCO_PRESET = 9                   // ID de uma tabela pré-definida + bits (sem árvore)
+};
+
+// Função para gravar um inteiro em 7 bits por byte (bit 7 = continua)
+static int escreverVarint(unsigned char* destino, uint64_t valor) {
+    int n = 0;
+    while (valor >= 0x80) {
+        destino[n++] = (unsigned char)(valor | 0x80);
+        valor >>= 7;
+    }
+    destino[n++] = (unsigned char)valor;
+    return n;
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Função para ler um varint do arquivo. Retorna 0 em caso de sucesso.
+static int lerVarintArquivo(FILE* arquivo, uint64_t* valor) {
+    *valor = 0;
+    for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+        int byte = fgetc(arquivo);
+        if (byte == EOF) return -1;
+        *valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80)) return 0;
+    }
+    return -1;
+}
+#endif
+
+// Função para ler um varint da memória. Retorna os bytes lidos (0 se inválido).
+static size_t lerVarint(const unsigned char* dados, size_t tamanho, uint64_t* valor) {
+    *valor = 0;
+    for (size_t i = 0; i < tamanho && i < 10; i++) {
+        *valor |= (uint64_t)(dados[i] & 0x7F) << (7 * i);
+        if (!(dados[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+// Arena de memória do compressor: uma área alocada uma vez e entregue em
+// pedaços, sem free individual. Quem reserva guarda arena->usado antes e o
+// restaura ao terminar, devolvendo de uma vez tudo o que as funções chamadas
+// pegaram.
+struct Arena {
+    unsigned char* memoria;
+    size_t capacidade;
+    size_t usado;
+};
+
+// Função para reservar 'tamanho' bytes (alinhados a 16) da arena.
+// Retorna NULL se não couber.
+static void* reservarArena(struct Arena* arena, size_t tamanho) {
+    size_t inicio = (arena->usado + 15) & ~(size_t)15;
+    if (inicio > arena->capacidade || tamanho > arena->capacidade - inicio) return NULL;
+    arena->usado = inicio + tamanho;
+    return arena->memoria + inicio;
+}
+
+// Procedimento para calcular o histograma de um bloco em memória; com divisor > 0
+// conta só faixas espaçadas do bloco e dá peso mínimo 1 a todos os símbolos
+static void histogramaBloco(const unsigned char* dados, size_t n, int divisor, int frequencias[256]) {
+    uint64_t contagem[256] = {0};
+
+    if (divisor > 0 && n / (size_t)divisor >= JANELA_AMOSTRA) {
+        size_t passo = 64 * (size_t)divisor;
+        for (int i = 0; i < 256; i++) {
+            contagem[i] = 1;
+        }
+        for (size_t inicio = 0; inicio < n; inicio += passo) {
+            size_t fim = inicio + 64 < n ? inicio + 64 : n;
+            for (size_t i = inicio; i < fim; i++) {
+                contagem[dados[i]]++;
+            }
+        }
+
+        // Amostra com um único byte (sequências, enchimento): com o peso mínimo
+        // o bloco custaria 1 bit por byte; a contagem exata confirma o caso de
+        // 0 bits previsto por estimarCustoBloco
+        int vistos = 0;
+        for (int i = 0; i < 256; i++) {
+            vistos += contagem[i] > 1;
+        }
+        if (vistos <= 1) {
+            memset(contagem, 0, sizeof(contagem));
+            contarBytes(dados, n, contagem);
+        }
+    } else {
+        contarBytes(dados, n, contagem);
+    }
+
+    normalizarFrequencias(contagem, frequencias);
+}
+
+// Função para codificar um bloco no layout do .huff legado: cabeçalho de 2 bytes,
+// árvore em pré-ordem ('tamanho_arvore' == 0 = tabela do bloco anterior) e bits.
+// Retorna os bytes gravados em 'destino' (capacidade mínima: 2 * n + 1024).
+static size_t codificarBlocoHuffman(const unsigned char* dados, size_t n, const struct CodigoHuffman dicionario[256],
+                                    const unsigned char* arvore, int tamanho_arvore, unsigned char* destino) {
+    if (tamanho_arvore > 0) {
+        memcpy(destino + 2, arvore, (size_t)tamanho_arvore);
+    }
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + 2 + tamanho_arvore, 2 * n + 8, NULL);
+    codificarBytes(&escritor, dados, n, dicionario);
+    int lixo = finalizarEscritor(&escritor);
+
+    montarCabecalho(destino, lixo, tamanho_arvore);
+    return 2 + (size_t)tamanho_arvore + escritor.posicao;
+}
+
+// Função para decodificar um bloco Huffman com 'tamanhoOriginal' bytes. Com
+// 'reutilizar' o bloco não traz árvore e usa a que já está em 'arvore'. Retorna 0 se ok.
+static int decodificarBlocoHuffman(const unsigned char* dados, size_t tamanho, unsigned char* saida,
+                                   size_t tamanhoOriginal, struct ArvoreDecodificacao* arvore, int reutilizar) {
+    if (tamanho < 2) return -1;
+
+    unsigned short cabecalho = (unsigned short)((dados[0] << 8) | dados[1]);
+    int lixo = (cabecalho >> 13) & 0x07;
+    int tamanho_arvore = cabecalho & 0x1FFF;
+
+    if (reutilizar) {
+        if (tamanho_arvore != 0) return -1;
+    } else if (2 + (size_t)tamanho_arvore > tamanho ||
+               montarArvoreDecodificacao(dados + 2, tamanho_arvore, arvore) != 0) {
+        return -1;
+    }
+
+    // Folha única: o bloco inteiro é o mesmo byte
+    if (arvore->esquerdo[0] < 0) {
+        memset(saida, arvore->simbolo[0], tamanhoOriginal);
+        return tamanho == 2 + (size_t)tamanho_arvore ? 0 : -1;
+    }
+
+    size_t inicio = 2 + (size_t)tamanho_arvore;
+    long long totalBits = (long long)(tamanho - inicio) * 8 - lixo;
+    long long bitsLidos = 0;
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + inicio, tamanho - inicio);
+
+    size_t n = decodificarSimbolos(arvore, &leitor, totalBits, &bitsLidos, saida, tamanhoOriginal);
+    return (n == tamanhoOriginal && bitsLidos == totalBits) ? 0 : -1;
+}
+
+// Função para calcular os bits de dados de um histograma com um dicionário
+// (-1 se algum símbolo presente não tiver código)
+static long long custoCodificacao(const int frequencias[256], const struct CodigoHuffman dicionario[256]) {
+    long long bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencias[i] > 0) {
+            if (dicionario[i].tamanho == 0) return -1;
+            bits += (long long)frequencias[i] * dicionario[i].tamanho;
+        }
+    }
+    return bits;
+}
+
+// Função para estimar o custo em bits de um bloco: entropia de ordem 0 (mínimo de
+// 1 bit por símbolo, como no Huffman) + árvore + cabeçalho, limitada ao bloco armazenado
+static double estimarCustoBloco(const uint32_t histograma[256], size_t total) {
+    if (total == 0) return 0;
+
+    int distintos = 0;
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (histograma[i] > 0) {
+            distintos++;
+            bits += histograma[i] * log2((double)total / histograma[i]);
+        }
+    }
+
+    if (distintos == 1) {
+        bits = 0;                                   // Folha única: 0 bits por símbolo
+    } else if (bits < (double)total) {
+        bits = (double)total;
+    }
+
+    double custo = bits + (2.0 * distintos - 1 + CUSTO_FIXO_BLOCO) * 8;
+    double armazenado = ((double)total + CUSTO_FIXO_BLOCO) * 8;
+    return custo < armazenado ? custo : armazenado;
+}
+
+// Segmento de blocos candidato durante a divisão adaptativa
+struct Segmento {
+    uint32_t histograma[256];
+    size_t tamanho;
+    double custo;
+    int proximo;                 // Índice do próximo segmento vivo (-1 = último)
+    int anterior;
+};
+
+// Função para calcular quanto se economiza unindo o segmento 'a' ao seguinte
+static double ganhoUniao(const struct Segmento* segmentos, int a) {
+    int b = segmentos[a].proximo;
+    if (b < 0) return -1;
+
+    uint32_t unido[256];
+    for (int i = 0; i < 256; i++) {
+        unido[i] = segmentos[a].histograma[i] + segmentos[b].histograma[i];
+    }
+    double custoUnido = estimarCustoBloco(unido, segmentos[a].tamanho + segmentos[b].tamanho);
+    return segmentos[a].custo + segmentos[b].custo - custoUnido;
+}
+
+// Função para escolher as fronteiras de bloco onde a distribuição muda.
+// Começa com um segmento por pedaço e une repetidamente o par vizinho de maior
+// ganho enquanto a união for mais barata que dois blocos separados (o custo da
+// árvore extra é o que impede blocos pequenos demais).
+// Retorna o número de blocos e preenche 'tamanhos'.
+static int dividirEmBlocos(const unsigned char* dados, size_t n, size_t pedaco, size_t tamanhos[],
+                           struct Arena* arena) {
+    size_t marca = arena->usado;
+    int numSegmentos = (int)((n + pedaco - 1) / pedaco);
+    struct Segmento* segmentos = (struct Segmento*)reservarArena(arena, (size_t)numSegmentos * sizeof(struct Segmento));
+    double* ganhos = (double*)reservarArena(arena, (size_t)numSegmentos * sizeof(double));
+    if (!segmentos || !ganhos) {
+        arena->usado = marca;
+        tamanhos[0] = n;
+        return 1;
+    }
+    memset(segmentos, 0, (size_t)numSegmentos * sizeof(struct Segmento));
+
+    // Histograma de cada pedaço
+    for (int s = 0; s < numSegmentos; s++) {
+        size_t inicio = (size_t)s * pedaco;
+        size_t fim = inicio + pedaco < n ? inicio + pedaco : n;
+        for (size_t i = inicio; i < fim; i++) {
+            segmentos[s].histograma[dados[i]]++;
+        }
+        segmentos[s].tamanho = fim - inicio;
+        segmentos[s].custo = estimarCustoBloco(segmentos[s].histograma, segmentos[s].tamanho);
+        segmentos[s].proximo = s + 1 < numSegmentos ? s + 1 : -1;
+        segmentos[s].anterior = s - 1;
+    }
+    for (int s = 0; s < numSegmentos; s++) {
+        ganhos[s] = ganhoUniao(segmentos, s);
+    }
+
+    // Unir o melhor par enquanto houver ganho
+    while (1) {
+        int melhor = -1;
+        for (int s = 0; s >= 0; s = segmentos[s].proximo) {
+            if (ganhos[s] > 0 && (melhor < 0 || ganhos[s] > ganhos[melhor])) {
+                melhor = s;
+            }
+        }
+        if (melhor < 0) break;
+
+        int b = segmentos[melhor].proximo;
+        for (int i = 0; i < 256; i++) {
+            segmentos[melhor].histograma[i] += segmentos[b].histograma[i];
+        }
+        segmentos[melhor].tamanho += segmentos[b].tamanho;
+        segmentos[melhor].custo = estimarCustoBloco(segmentos[melhor].histograma, segmentos[melhor].tamanho);
+        segmentos[melhor].proximo = segmentos[b].proximo;
+        if (segmentos[b].proximo >= 0) {
+            segmentos[segmentos[b].proximo].anterior = melhor;
+        }
+
+        // Só os ganhos vizinhos ao par unido mudam
+        ganhos[melhor] = ganhoUniao(segmentos, melhor);
+        if (segmentos[melhor].anterior >= 0) {
+            ganhos[segmentos[melhor].anterior] = ganhoUniao(segmentos, segmentos[melhor].anterior);
+        }
+    }
+
+    int numBlocos = 0;
+    for (int s = 0; s >= 0; s = segmentos[s].proximo) {
+        tamanhos[numBlocos++] = segmentos[s].tamanho;
+    }
+
+    arena->usado = marca;
+    return numBlocos;
+}
+
+// Destino dos blocos gravados: um arquivo ou um buffer na memória (biblioteca)
+struct SaidaBlocos {
+    FILE* arquivo;                     // NULL = gravar em 'memoria'
+    unsigned char* memoria;
+    size_t capacidade;
+    size_t usado;
+    int estourou;                      // A memória acabou antes dos dados
+};
+
+// Procedimento para gravar bytes no destino. Na memória, o que não couber
+// marca 'estourou' e é descartado.
+static void gravarSaida(struct SaidaBlocos* saida, const void* dados, size_t tamanho) {
+    if (saida->arquivo) {
+        gravarArquivo(saida->arquivo, dados, tamanho);
+        return;
+    }
+    if (saida->estourou || tamanho > saida->capacidade - saida->usado) {
+        saida->estourou = 1;
+        return;
+    }
+    if (tamanho > 0) memcpy(saida->memoria + saida->usado, dados, tamanho);
+    saida->usado += tamanho;
+}
+
+// Procedimento para gravar um bloco (cabeçalho + dados) no destino
+static void gravarBloco(struct SaidaBlocos* saida, int tipo, size_t tamanhoOriginal, const unsigned char* dados,
+                        size_t tamanho) {
+    unsigned char cabecalho[1 + 2 * 10];
+    int n = 0;
+    cabecalho[n++] = (unsigned char)tipo;
+    n += escreverVarint(cabecalho + n, tamanhoOriginal);
+    n += escreverVarint(cabecalho + n, tamanho);
+    gravarSaida(saida, cabecalho, (size_t)n);
+    gravarSaida(saida, dados, tamanho);
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Procedimento para gravar um bloco (cabeçalho + dados) no arquivo
+static void escreverBloco(FILE* saida, int tipo, size_t tamanhoOriginal, const unsigned char* dados, size_t tamanho) {
+    struct SaidaBlocos destino = {saida, NULL, 0, 0, 0};
+    gravarBloco(&destino, tipo, tamanhoOriginal, dados, tamanho);
+}
+#endif
+
+// Procedimento para codificar os seletores com move-to-front + unário (como o
+// bzip2): a posição 'p' da tabela na lista vira 'p' bits 1 seguidos de um 0.
+// Com escritor NULL só conta os bits. Retorna o total de bits.
+static long long codificarSeletores(const unsigned char* seletores, int numGrupos, int numTabelas,
+                                    struct EscritorBits* escritor) {
+    unsigned char lista[MAXIMO_TABELAS];
+    long long bits = 0;
+
+    for (int t = 0; t < numTabelas; t++) {
+        lista[t] = (unsigned char)t;
+    }
+
+    for (int g = 0; g < numGrupos; g++) {
+        int posicao = 0;
+        while (lista[posicao] != seletores[g]) {
+            posicao++;
+        }
+        // Levar a tabela para a frente da lista
+        for (int i = posicao; i > 0; i--) {
+            lista[i] = lista[i - 1];
+        }
+        lista[0] = seletores[g];
+
+        if (escritor) {
+            escreverBits(escritor, ((1u << posicao) - 1) << 1, posicao + 1);
+        }
+        bits += posicao + 1;
+    }
+    return bits;
+}
+
+// Plano do modo com várias tabelas: K dicionários + a tabela escolhida para cada
+// grupo de TAMANHO_GRUPO símbolos
+struct PlanoMultiTabela {
+    int numTabelas;
+    struct CodigoHuffman dicionarios[MAXIMO_TABELAS][256];
+    unsigned char arvores[MAXIMO_TABELAS][2 * MAXIMO_NOS];
+    int tamanhosArvore[MAXIMO_TABELAS];
+    int numGrupos;
+    unsigned char seletores[TAMANHO_JANELA / TAMANHO_GRUPO + 1];
+};
+
+// Função para escolher as tabelas e os seletores de um bloco. As tabelas começam
+// com o histograma de K faixas contíguas do bloco; a cada passe cada grupo escolhe
+// a tabela mais barata e as tabelas são remontadas (lista + árvore de Huffman) só
+// com os grupos que as escolheram. Retorna o tamanho em bytes que o bloco terá,
+// ou 0 se no fim sobrar menos de duas tabelas.
+static size_t planejarMultiTabela(const unsigned char* dados, size_t n, int passes, struct PlanoMultiTabela* plano) {
+    int frequencias[MAXIMO_TABELAS][256];
+    int presente[256] = {0};
+    int numTabelas = n < 64 * 1024 ? 2 : n < 192 * 1024 ? 3 : n < 384 * 1024 ? 4 : n < 768 * 1024 ? 5 : 6;
+    int numGrupos = (int)((n + TAMANHO_GRUPO - 1) / TAMANHO_GRUPO);
+
+    for (size_t i = 0; i < n; i++) {
+        presente[dados[i]] = 1;
+    }
+
+    // Tabelas iniciais: uma por faixa do bloco, com peso 1 em todo símbolo do
+    // bloco para que qualquer grupo possa ser medido com qualquer tabela
+    for (int t = 0; t < numTabelas; t++) {
+        size_t inicio = n * (size_t)t / (size_t)numTabelas;
+        size_t fim = n * (size_t)(t + 1) / (size_t)numTabelas;
+        for (int s = 0; s < 256; s++) {
+            frequencias[t][s] = presente[s];
+        }
+        for (size_t i = inicio; i < fim; i++) {
+            frequencias[t][dados[i]]++;
+        }
+        construirDicionario(frequencias[t], plano->dicionarios[t]);
+    }
+
+    int usada[MAXIMO_TABELAS];
+    for (int p = 0; p < passes; p++) {
+        memset(frequencias, 0, sizeof(frequencias));
+        memset(usada, 0, sizeof(usada));
+
+        for (int g = 0; g < numGrupos; g++) {
+            size_t inicio = (size_t)g * TAMANHO_GRUPO;
+            size_t fim = inicio + TAMANHO_GRUPO < n ? inicio + TAMANHO_GRUPO : n;
+
+            // Custo do grupo em cada tabela (símbolo sem código conta como muito caro)
+            int melhor = 0;
+            long custoMelhor = -1;
+            for (int t = 0; t < numTabelas; t++) {
+                const struct CodigoHuffman* dicionario = plano->dicionarios[t];
+                long custo = 0;
+                for (size_t i = inicio; i < fim; i++) {
+                    int tamanho = dicionario[dados[i]].tamanho;
+                    custo += tamanho > 0 ? tamanho : 2 * TAMANHO_MAXIMO_CODIGO;
+                }
+                if (custoMelhor < 0 || custo < custoMelhor) {
+                    custoMelhor = custo;
+                    melhor = t;
+                }
+            }
+
+            plano->seletores[g] = (unsigned char)melhor;
+            usada[melhor] = 1;
+            for (size_t i = inicio; i < fim; i++) {
+                frequencias[melhor][dados[i]]++;
+            }
+        }
+
+        // Remontar cada tabela só com os grupos que a escolheram
+        for (int t = 0; t < numTabelas; t++) {
+            if (usada[t]) {
+                construirDicionario(frequencias[t], plano->dicionarios[t]);
+            }
+        }
+    }
+
+    // Descartar tabelas que nenhum grupo escolheu no último passe
+    int novoIndice[MAXIMO_TABELAS];
+    int numUsadas = 0;
+    for (int t = 0; t < numTabelas; t++) {
+        novoIndice[t] = -1;
+        if (usada[t]) {
+            novoIndice[t] = numUsadas;
+            if (numUsadas != t) {
+                memcpy(plano->dicionarios[numUsadas], plano->dicionarios[t], sizeof(plano->dicionarios[t]));
+                memcpy(frequencias[numUsadas], frequencias[t], sizeof(frequencias[t]));
+            }
+            numUsadas++;
+        }
+    }
+    if (passes == 0 || numUsadas < 2) {
+        return 0;
+    }
+    for (int g = 0; g < numGrupos; g++) {
+        plano->seletores[g] = (unsigned char)novoIndice[plano->seletores[g]];
+    }
+
+    plano->numTabelas = numUsadas;
+    plano->numGrupos = numGrupos;
+
+    // Tamanho final: K + lixo + árvores + seletores + dados
+    size_t bytes = 2;
+    long long bits = codificarSeletores(plano->seletores, numGrupos, numUsadas, NULL);
+    for (int t = 0; t < numUsadas; t++) {
+        plano->tamanhosArvore[t] = escreverArvoreDicionario(plano->dicionarios[t], plano->arvores[t]);
+        bytes += 2 + (size_t)plano->tamanhosArvore[t];
+        bits += custoCodificacao(frequencias[t], plano->dicionarios[t]);
+    }
+    return bytes + (size_t)((bits + 7) / 8);
+}
+
+// Função para gravar um bloco com várias tabelas:
+//   K (1 byte) + lixo (1 byte) + K x (tamanho da árvore em 2 bytes + árvore)
+//   + bits dos seletores + bits dos símbolos, grupo a grupo
+static size_t codificarBlocoMultiTabela(const unsigned char* dados, size_t n, const struct PlanoMultiTabela* plano,
+                                        unsigned char* destino) {
+    size_t posicao = 2;
+    destino[0] = (unsigned char)plano->numTabelas;
+
+    for (int t = 0; t < plano->numTabelas; t++) {
+        montarCabecalho(destino + posicao, 0, plano->tamanhosArvore[t]);
+        memcpy(destino + posicao + 2, plano->arvores[t], (size_t)plano->tamanhosArvore[t]);
+        posicao += 2 + (size_t)plano->tamanhosArvore[t];
+    }
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + posicao, 2 * n + 1024, NULL);
+    codificarSeletores(plano->seletores, plano->numGrupos, plano->numTabelas, &escritor);
+
+    for (int g = 0; g < plano->numGrupos; g++) {
+        const struct CodigoHuffman* dicionario = plano->dicionarios[plano->seletores[g]];
+        size_t inicio = (size_t)g * TAMANHO_GRUPO;
+        size_t fim = inicio + TAMANHO_GRUPO < n ? inicio + TAMANHO_GRUPO : n;
+        codificarBytes(&escritor, dados + inicio, fim - inicio, dicionario);
+    }
+
+    destino[1] = (unsigned char)finalizarEscritor(&escritor);
+    return posicao + escritor.posicao;
+}
+
+// Função para decodificar um bloco com várias tabelas ('arvores' precisa ter
+// MAXIMO_TABELAS posições e 'seletores' um byte por grupo). Retorna 0 se ok.
+static int decodificarBlocoMultiTabela(const unsigned char* dados, size_t tamanho, unsigned char* saida,
+                                       size_t tamanhoOriginal, struct ArvoreDecodificacao* arvores,
+                                       unsigned char* seletores) {
+    if (tamanho < 2) return -1;
+
+    int numTabelas = dados[0];
+    int lixo = dados[1];
+    if (numTabelas < 2 || numTabelas > MAXIMO_TABELAS || lixo > 7) return -1;
+
+    // Árvores de cada tabela
+    size_t posicao = 2;
+    for (int t = 0; t < numTabelas; t++) {
+        if (posicao + 2 > tamanho) return -1;
+        int tamanho_arvore = ((dados[posicao] << 8) | dados[posicao + 1]) & 0x1FFF;
+        posicao += 2;
+        if (posicao + (size_t)tamanho_arvore > tamanho ||
+            montarArvoreDecodificacao(dados + posicao, tamanho_arvore, &arvores[t]) != 0 ||
+            arvores[t].esquerdo[0] < 0) {
+            return -1;
+        }
+        posicao += (size_t)tamanho_arvore;
+    }
+
+    long long totalBits = (long long)(tamanho - posicao) * 8 - lixo;
+    long long bitsLidos = 0;
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + posicao, tamanho - posicao);
+
+    // Seletores: desfazer o unário e o move-to-front
+    int numGrupos = (int)((tamanhoOriginal + TAMANHO_GRUPO - 1) / TAMANHO_GRUPO);
+    unsigned char lista[MAXIMO_TABELAS];
+    for (int t = 0; t < numTabelas; t++) {
+        lista[t] = (unsigned char)t;
+    }
+    for (int g = 0; g < numGrupos; g++) {
+        int posicaoLista = 0;
+        while (1) {
+            if (leitor.bits == 0) recarregarBits(&leitor);
+            int bit = (int)(leitor.buffer >> 63);
+            leitor.buffer <<= 1;
+            leitor.bits--;
+            bitsLidos++;
+            if (!bit) break;
+            if (++posicaoLista >= numTabelas) return -1;
+        }
+        unsigned char tabela = lista[posicaoLista];
+        for (int i = posicaoLista; i > 0; i--) {
+            lista[i] = lista[i - 1];
+        }
+        lista[0] = tabela;
+        seletores[g] = tabela;
+    }
+
+    // Símbolos, grupo a grupo, cada um com a sua tabela
+    size_t escritos = 0;
+    for (int g = 0; g < numGrupos && bitsLidos <= totalBits; g++) {
+        size_t quantos = tamanhoOriginal - escritos < TAMANHO_GRUPO ? tamanhoOriginal - escritos : TAMANHO_GRUPO;
+        escritos += decodificarSimbolos(&arvores[seletores[g]], &leitor, totalBits, &bitsLidos,
+                                        saida + escritos, quantos);
+    }
+
+    return (escritos == tamanhoOriginal && bitsLidos == totalBits) ? 0 : -1;
+}
+
+// Plano do modo de ordem 1: cada contexto (byte anterior) aponta para um grupo
+// e cada grupo tem a sua tabela
+struct PlanoOrdem1 {
+    int numGrupos;
+    unsigned char mapa[256];
+    struct CodigoHuffman dicionarios[MAXIMO_GRUPOS_CONTEXTO][256];
+    unsigned char arvores[MAXIMO_GRUPOS_CONTEXTO][2 * MAXIMO_NOS];
+    int tamanhosArvore[MAXIMO_GRUPOS_CONTEXTO];
+};
+
+// Procedimento para agrupar os contextos em até 'maximo' grupos (k-médias com a
+// entropia cruzada como distância). Os grupos começam nos contextos mais
+// frequentes; cada contexto vai para o grupo onde seus símbolos custam menos.
+// Retorna quantos grupos sobraram.
+static int agruparContextos(const uint32_t (*contagem)[256], const uint32_t totalContexto[256], int maximo,
+                            unsigned char mapa[256], struct Arena* arena) {
+    size_t marca = arena->usado;
+    double (*custoSimbolo)[256] = (double (*)[256])reservarArena(arena, MAXIMO_GRUPOS_CONTEXTO * sizeof(*custoSimbolo));
+    uint32_t (*somaGrupo)[256] = (uint32_t (*)[256])reservarArena(arena, MAXIMO_GRUPOS_CONTEXTO * sizeof(*somaGrupo));
+    int ordem[256];
+    int numGrupos = 0;
+
+    // Contextos em ordem decrescente de uso
+    for (int c = 0; c < 256; c++) {
+        ordem[c] = c;
+    }
+    for (int i = 1; i < 256; i++) {
+        int atual = ordem[i];
+        int j = i - 1;
+        while (j >= 0 && totalContexto[ordem[j]] < totalContexto[atual]) {
+            ordem[j + 1] = ordem[j];
+            j--;
+        }
+        ordem[j + 1] = atual;
+    }
+
+    memset(mapa, 0, 256);
+    for (int i = 0; i < 256 && numGrupos < maximo && totalContexto[ordem[i]] > 0; i++) {
+        mapa[ordem[i]] = (unsigned char)numGrupos++;
+    }
+    if (!custoSimbolo || !somaGrupo || numGrupos <= 1) {
+        arena->usado = marca;
+        return numGrupos > 0 ? 1 : 0;
+    }
+
+    for (int iteracao = 0; iteracao < 4; iteracao++) {
+        // Distribuição de cada grupo a partir dos contextos atribuídos
+        memset(somaGrupo, 0, MAXIMO_GRUPOS_CONTEXTO * sizeof(*somaGrupo));
+        if (iteracao == 0) {
+            // Primeira rodada: só as sementes
+            for (int i = 0; i < numGrupos; i++) {
+                memcpy(somaGrupo[i], contagem[ordem[i]], sizeof(somaGrupo[i]));
+            }
+        } else {
+            for (int c = 0; c < 256; c++) {
+                for (int s = 0; s < 256; s++) {
+                    somaGrupo[mapa[c]][s] += contagem[c][s];
+                }
+            }
+        }
+
+        // Custo em bits de cada símbolo em cada grupo (com suavização para
+        // símbolos que o grupo ainda não viu)
+        for (int g = 0; g < numGrupos; g++) {
+            double total = 0;
+            for (int s = 0; s < 256; s++) {
+                total += somaGrupo[g][s];
+            }
+            for (int s = 0; s < 256; s++) {
+                custoSimbolo[g][s] = log2((total + 25.6) / (somaGrupo[g][s] + 0.1));
+            }
+        }
+
+        // Cada contexto vai para o grupo mais barato
+        for (int c = 0; c < 256; c++) {
+            if (totalContexto[c] == 0) continue;
+            double melhorCusto = -1;
+            for (int g = 0; g < numGrupos; g++) {
+                double custo = 0;
+                for (int s = 0; s < 256; s++) {
+                    if (contagem[c][s]) custo += contagem[c][s] * custoSimbolo[g][s];
+                }
+                if (melhorCusto < 0 || custo < melhorCusto) {
+                    melhorCusto = custo;
+                    mapa[c] = (unsigned char)g;
+                }
+            }
+        }
+    }
+
+    // Renumerar descartando grupos vazios
+    int novoIndice[MAXIMO_GRUPOS_CONTEXTO];
+    int usados = 0;
+    for (int g = 0; g < numGrupos; g++) {
+        novoIndice[g] = -1;
+    }
+    for (int c = 0; c < 256; c++) {
+        if (totalContexto[c] > 0 && novoIndice[mapa[c]] < 0) {
+            novoIndice[mapa[c]] = usados++;
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        mapa[c] = totalContexto[c] > 0 ? (unsigned char)novoIndice[mapa[c]] : 0;
+    }
+
+    arena->usado = marca;
+    return usados;
+}
+
+// Função para montar o melhor plano de ordem 1 com até 'maximo' grupos: testa
+// 2, 4, 8... grupos e fica com o menor tamanho exato (mapa + árvores + bits).
+// Retorna esse tamanho em bytes (0 se não foi possível).
+static size_t planejarOrdem1(const unsigned char* dados, size_t n, int maximo, struct PlanoOrdem1* plano,
+                             struct Arena* arena) {
+    size_t marca = arena->usado;
+    uint32_t (*contagem)[256] = (uint32_t (*)[256])reservarArena(arena, 256 * sizeof(*contagem));
+    struct PlanoOrdem1* tentativa = (struct PlanoOrdem1*)reservarArena(arena, sizeof(struct PlanoOrdem1));
+    uint32_t totalContexto[256] = {0};
+    size_t melhor = 0;
+
+    if (!contagem || !tentativa) {
+        arena->usado = marca;
+        return 0;
+    }
+    memset(contagem, 0, 256 * sizeof(*contagem));
+
+    // Contagem por contexto; o primeiro byte do bloco usa o contexto 0
+    unsigned char anterior = 0;
+    for (size_t i = 0; i < n; i++) {
+        contagem[anterior][dados[i]]++;
+        totalContexto[anterior]++;
+        anterior = dados[i];
+    }
+
+    for (int grupos = 2; grupos <= maximo; grupos *= 2) {
+        tentativa->numGrupos = agruparContextos((const uint32_t (*)[256])contagem, totalContexto, grupos, tentativa->mapa,
+                                                 arena);
+        if (tentativa->numGrupos < 2) break;
+
+        // Histograma de cada grupo -> lista -> árvore -> dicionário
+        size_t bytes = 2 + 256;
+        long long bits = 0;
+        for (int g = 0; g < tentativa->numGrupos; g++) {
+            int frequencias[256] = {0};
+            for (int c = 0; c < 256; c++) {
+                if (tentativa->mapa[c] == g && totalContexto[c] > 0) {
+                    for (int s = 0; s < 256; s++) {
+                        frequencias[s] += (int)contagem[c][s];
+                    }
+                }
+            }
+            construirDicionario(frequencias, tentativa->dicionarios[g]);
+            bits += custoCodificacao(frequencias, tentativa->dicionarios[g]);
+
+            tentativa->tamanhosArvore[g] = escreverArvoreDicionario(tentativa->dicionarios[g], tentativa->arvores[g]);
+            bytes += 2 + (size_t)tentativa->tamanhosArvore[g];
+        }
+        bytes += (size_t)((bits + 7) / 8);
+
+        if (melhor == 0 || bytes < melhor) {
+            melhor = bytes;
+            memcpy(plano, tentativa, sizeof(struct PlanoOrdem1));
+        }
+        if (tentativa->numGrupos < grupos) break;    // Não há mais contextos para separar
+    }
+
+    arena->usado = marca;
+    return melhor;
+}
+
+// Função para gravar um bloco de ordem 1:
+//   número de grupos (1 byte) + lixo (1 byte) + mapa contexto -> grupo (256 bytes)
+//   + grupos x (tamanho da árvore em 2 bytes + árvore) + bits
+static size_t codificarBlocoOrdem1(const unsigned char* dados, size_t n, const struct PlanoOrdem1* plano,
+                                   unsigned char* destino) {
+    size_t posicao = 2 + 256;
+    destino[0] = (unsigned char)plano->numGrupos;
+    memcpy(destino + 2, plano->mapa, 256);
+
+    for (int g = 0; g < plano->numGrupos; g++) {
+        montarCabecalho(destino + posicao, 0, plano->tamanhosArvore[g]);
+        memcpy(destino + posicao + 2, plano->arvores[g], (size_t)plano->tamanhosArvore[g]);
+        posicao += 2 + (size_t)plano->tamanhosArvore[g];
+    }
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + posicao, 2 * n + 1024, NULL);
+
+    unsigned char anterior = 0;
+    for (size_t i = 0; i < n; i++) {
+        const struct CodigoHuffman* c = &plano->dicionarios[plano->mapa[anterior]][dados[i]];
+        escreverBits(&escritor, c->codigo, c->tamanho);
+        anterior = dados[i];
+    }
+
+    destino[1] = (unsigned char)finalizarEscritor(&escritor);
+    return posicao + escritor.posicao;
+}
+
+// Função para decodificar um bloco de ordem 1: a tabela de cada símbolo é a do
+// grupo do último byte decodificado ('arvores' precisa ter MAXIMO_GRUPOS_CONTEXTO
+// posições). Retorna 0 se ok.
+static int decodificarBlocoOrdem1(const unsigned char* dados, size_t tamanho, unsigned char* saida,
+                                  size_t tamanhoOriginal, struct ArvoreDecodificacao* arvores) {
+    if (tamanho < 2 + 256) return -1;
+
+    int numGrupos = dados[0];
+    int lixo = dados[1];
+    const unsigned char* mapa = dados + 2;
+    if (numGrupos < 1 || numGrupos > MAXIMO_GRUPOS_CONTEXTO || lixo > 7) return -1;
+    for (int c = 0; c < 256; c++) {
+        if (mapa[c] >= numGrupos) return -1;
+    }
+
+    size_t posicao = 2 + 256;
+    for (int g = 0; g < numGrupos; g++) {
+        if (posicao + 2 > tamanho) return -1;
+        int tamanho_arvore = ((dados[posicao] << 8) | dados[posicao + 1]) & 0x1FFF;
+        posicao += 2;
+        if (posicao + (size_t)tamanho_arvore > tamanho ||
+            montarArvoreDecodificacao(dados + posicao, tamanho_arvore, &arvores[g]) != 0 ||
+            arvores[g].esquerdo[0] < 0) {
+            return -1;
+        }
+        posicao += (size_t)tamanho_arvore;
+    }
+
+    long long totalBits = (long long)(tamanho - posicao) * 8 - lixo;
+    long long bitsLidos = 0;
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + posicao, tamanho - posicao);
+
+    unsigned char anterior = 0;
+    size_t i = 0;
+    for (; i < tamanhoOriginal && bitsLidos < totalBits; i++) {
+        anterior = decodificarUmSimbolo(&arvores[mapa[anterior]], &leitor, &bitsLidos);
+        saida[i] = anterior;
+    }
+
+    return (i == tamanhoOriginal && bitsLidos == totalBits) ? 0 : -1;
+}
+
+// Parâmetros do tANS (ANS com tabela, como o FSE): 2^LOG_TABELA_TANS estados
+#define LOG_TABELA_TANS 12
+#define TAMANHO_TABELA_TANS (1 << LOG_TABELA_TANS)
+#define NIVEL_MINIMO_TANS 4            // Precisa do histograma exato do bloco
+
+// Função para achar a posição do bit mais alto (v >= 1)
+static int bitMaisAlto(uint32_t v) {
+    int posicao = 0;
+    while (v >>= 1) posicao++;
+    return posicao;
+}
+
+// Procedimento para normalizar o histograma para somar TAMANHO_TABELA_TANS, com
+// pelo menos 1 para cada símbolo presente. A diferença do arredondamento fica
+// com os símbolos mais frequentes, onde o ajuste custa menos.
+static void normalizarParaTans(const int frequencias[256], uint16_t normalizadas[256]) {
+    long long soma = 0;
+    for (int s = 0; s < 256; s++) soma += frequencias[s];
+
+    int total = 0;
+    int maior = 0;
+    for (int s = 0; s < 256; s++) {
+        normalizadas[s] = 0;
+        if (frequencias[s] == 0) continue;
+
+        long long valor = ((long long)frequencias[s] * TAMANHO_TABELA_TANS + soma / 2) / soma;
+        normalizadas[s] = (uint16_t)(valor < 1 ? 1 : valor);
+        total += normalizadas[s];
+        if (normalizadas[s] > normalizadas[maior]) maior = s;
+    }
+    if (total == 0) return;
+
+    if (total < TAMANHO_TABELA_TANS) {
+        normalizadas[maior] = (uint16_t)(normalizadas[maior] + TAMANHO_TABELA_TANS - total);
+    }
+    while (total > TAMANHO_TABELA_TANS) {
+        maior = 0;
+        for (int s = 1; s < 256; s++) {
+            if (normalizadas[s] > normalizadas[maior]) maior = s;
+        }
+        normalizadas[maior]--;
+        total--;
+    }
+}
+
+// Procedimento para espalhar os símbolos pela tabela de estados (mesmo passo
+// ímpar do FSE, que visita todas as posições)
+static void espalharSimbolosTans(const uint16_t normalizadas[256], uint8_t espalhados[TAMANHO_TABELA_TANS]) {
+    int passo = (TAMANHO_TABELA_TANS >> 1) + (TAMANHO_TABELA_TANS >> 3) + 3;
+    int posicao = 0;
+    for (int s = 0; s < 256; s++) {
+        for (int i = 0; i < normalizadas[s]; i++) {
+            espalhados[posicao] = (unsigned char)s;
+            posicao = (posicao + passo) & (TAMANHO_TABELA_TANS - 1);
+        }
+    }
+}
+
+// Função para gravar as contagens normalizadas: varint(presentes) e, para cada
+// símbolo presente, varint(distância ao anterior) + varint(contagem - 1)
+static size_t escreverCabecalhoTans(const uint16_t normalizadas[256], unsigned char* destino) {
+    int presentes = 0;
+    for (int s = 0; s < 256; s++) {
+        if (normalizadas[s] > 0) presentes++;
+    }
+
+    size_t n = (size_t)escreverVarint(destino, (uint64_t)presentes);
+    int anterior = -1;
+    for (int s = 0; s < 256; s++) {
+        if (normalizadas[s] > 0) {
+            n += (size_t)escreverVarint(destino + n, (uint64_t)(s - anterior - 1));
+            n += (size_t)escreverVarint(destino + n, (uint64_t)(normalizadas[s] - 1));
+            anterior = s;
+        }
+    }
+    return n;
+}
+
+// Função inversa de escreverCabecalhoTans. Retorna os bytes lidos (0 se inválido).
+static size_t lerCabecalhoTans(const unsigned char* dados, size_t tamanho, uint16_t normalizadas[256]) {
+    uint64_t presentes, distancia, contagem;
+    size_t n = lerVarint(dados, tamanho, &presentes);
+    if (n == 0 || presentes == 0 || presentes > 256) return 0;
+
+    memset(normalizadas, 0, 256 * sizeof(uint16_t));
+    int simbolo = -1;
+    int total = 0;
+    for (uint64_t i = 0; i < presentes; i++) {
+        size_t a = lerVarint(dados + n, tamanho - n, &distancia);
+        size_t b = a ? lerVarint(dados + n + a, tamanho - n - a, &contagem) : 0;
+        if (b == 0 || distancia > 255 || simbolo + (int)distancia + 1 > 255 || contagem >= TAMANHO_TABELA_TANS) {
+            return 0;
+        }
+        n += a + b;
+        simbolo += (int)distancia + 1;
+        normalizadas[simbolo] = (uint16_t)(contagem + 1);
+        total += normalizadas[simbolo];
+    }
+    return total == TAMANHO_TABELA_TANS ? n : 0;
+}
+
+// Tabela de codificação: os estados vão de TAMANHO_TABELA_TANS a 2 * TAMANHO_TABELA_TANS - 1
+struct TabelaCodificacaoTans {
+    uint16_t estados[TAMANHO_TABELA_TANS];   // Próximo estado por (símbolo, posto)
+    int32_t deltaBits[256];                  // (estado + deltaBits) >> 16 = bits emitidos
+    int32_t deltaEstado[256];                // Deslocamento do símbolo em 'estados'
+};
+
+static void montarCodificacaoTans(const uint16_t normalizadas[256], struct TabelaCodificacaoTans* tabela) {
+    uint8_t espalhados[TAMANHO_TABELA_TANS];
+    int proximo[256];
+    int acumulado = 0;
+
+    espalharSimbolosTans(normalizadas, espalhados);
+    for (int s = 0; s < 256; s++) {
+        proximo[s] = acumulado;
+        tabela->deltaEstado[s] = acumulado - normalizadas[s];
+        tabela->deltaBits[s] = 0;
+        if (normalizadas[s] > 0) {
+            int maximoBits = LOG_TABELA_TANS - (normalizadas[s] > 1 ? bitMaisAlto(normalizadas[s] - 1u) : 0);
+            tabela->deltaBits[s] = (maximoBits << 16) - (normalizadas[s] << maximoBits);
+        }
+        acumulado += normalizadas[s];
+    }
+    for (int u = 0; u < TAMANHO_TABELA_TANS; u++) {
+        tabela->estados[proximo[espalhados[u]]++] = (uint16_t)(TAMANHO_TABELA_TANS + u);
+    }
+}
+
+// Tabela de decodificação, indexada por estado - TAMANHO_TABELA_TANS
+struct TabelaDecodificacaoTans {
+    uint8_t simbolo[TAMANHO_TABELA_TANS];
+    uint8_t bits[TAMANHO_TABELA_TANS];
+    uint16_t base[TAMANHO_TABELA_TANS];      // Próximo estado = base + bits lidos
+};
+
+static void montarDecodificacaoTans(const uint16_t normalizadas[256], struct TabelaDecodificacaoTans* tabela) {
+    uint8_t espalhados[TAMANHO_TABELA_TANS];
+    uint32_t proximo[256];
+
+    espalharSimbolosTans(normalizadas, espalhados);
+    for (int s = 0; s < 256; s++) {
+        proximo[s] = normalizadas[s];
+    }
+    for (int u = 0; u < TAMANHO_TABELA_TANS; u++) {
+        int s = espalhados[u];
+        uint32_t x = proximo[s]++;
+        int bits = LOG_TABELA_TANS - bitMaisAlto(x);
+        tabela->simbolo[u] = (uint8_t)s;
+        tabela->bits[u] = (uint8_t)bits;
+        tabela->base[u] = (uint16_t)(x << bits);
+    }
+}
+
+// Função para estimar os bits de um bloco tANS (cabeçalho incluso) a partir do histograma
+static double estimarBitsTans(const int frequencias[256], double escala) {
+    uint16_t normalizadas[256];
+    unsigned char cabecalho[256 * 6 + 10];
+    normalizarParaTans(frequencias, normalizadas);
+
+    double bits = 0;
+    for (int s = 0; s < 256; s++) {
+        if (frequencias[s] > 0) {
+            bits += frequencias[s] * (LOG_TABELA_TANS - log2((double)normalizadas[s]));
+        }
+    }
+    return bits * escala + LOG_TABELA_TANS + 8.0 * escreverCabecalhoTans(normalizadas, cabecalho);
+}
+
+// Função para codificar um bloco com tANS: contagens normalizadas + estado final +
+// bits. O ANS é "último a entrar, primeiro a sair": os símbolos são codificados
+// de trás para frente e os bits gravados na ordem em que o decodificador os lê.
+// Todo byte do bloco precisa ter frequência > 0. Retorna os bytes gravados (0 = falha).
+static size_t codificarBlocoTans(const unsigned char* dados, size_t n, const int frequencias[256],
+                                 unsigned char* destino, struct Arena* arena) {
+    uint16_t normalizadas[256];
+    normalizarParaTans(frequencias, normalizadas);
+
+    size_t marca = arena->usado;
+    struct TabelaCodificacaoTans* tabela =
+        (struct TabelaCodificacaoTans*)reservarArena(arena, sizeof(struct TabelaCodificacaoTans));
+    uint16_t* valores = (uint16_t*)reservarArena(arena, n * sizeof(uint16_t));
+    uint8_t* quantidades = (uint8_t*)reservarArena(arena, n);
+    if (!tabela || !valores || !quantidades) {
+        arena->usado = marca;
+        return 0;
+    }
+    montarCodificacaoTans(normalizadas, tabela);
+
+    uint32_t estado = TAMANHO_TABELA_TANS;
+    for (size_t i = n; i-- > 0;) {
+        int s = dados[i];
+        int bits = (int)((estado + (uint32_t)tabela->deltaBits[s]) >> 16);
+        valores[i] = (uint16_t)(estado & ((1u << bits) - 1));
+        quantidades[i] = (uint8_t)bits;
+        estado = tabela->estados[(estado >> bits) + tabela->deltaEstado[s]];
+    }
+
+    size_t tamanho = escreverCabecalhoTans(normalizadas, destino);
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + tamanho, 2 * n + 8, NULL);
+    escreverBits(&escritor, estado - TAMANHO_TABELA_TANS, LOG_TABELA_TANS);
+    for (size_t i = 0; i < n; i++) {
+        escreverBits(&escritor, valores[i], quantidades[i]);
+    }
+    finalizarEscritor(&escritor);
+
+    arena->usado = marca;
+    return tamanho + escritor.posicao;
+}
+
+// Função para decodificar um bloco tANS. O decodificador precisa consumir os
+// bits do bloco até o último byte (o resto dele são zeros) e terminar no estado
+// inicial do codificador. Retorna 0 se ok.
+static int decodificarBlocoTans(const unsigned char* dados, size_t tamanho, unsigned char* saida,
+                                size_t tamanhoOriginal) {
+    uint16_t normalizadas[256];
+    size_t inicio = lerCabecalhoTans(dados, tamanho, normalizadas);
+    if (inicio == 0) return -1;
+
+    struct TabelaDecodificacaoTans tabela;
+    montarDecodificacaoTans(normalizadas, &tabela);
+
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + inicio, tamanho - inicio);
+    long long totalBits = (long long)(tamanho - inicio) * 8;
+    long long bitsLidos = LOG_TABELA_TANS;
+    uint32_t estado = TAMANHO_TABELA_TANS + lerBits(&leitor, LOG_TABELA_TANS);
+    for (size_t i = 0; i < tamanhoOriginal && bitsLidos <= totalBits; i++) {
+        uint32_t u = estado - TAMANHO_TABELA_TANS;
+        saida[i] = tabela.simbolo[u];
+        estado = tabela.base[u] + lerBits(&leitor, tabela.bits[u]);
+        bitsLidos += tabela.bits[u];
+    }
+
+    int lixo = (int)(totalBits - bitsLidos);
+    if (lixo < 0 || lixo > 7 || lerBits(&leitor, lixo) != 0) return -1;
+    return estado == TAMANHO_TABELA_TANS ? 0 : -1;
+}
+
+// Estágios reversíveis aplicados antes do histograma, marcados nos bits altos
+// do tipo do bloco e aplicados na ordem filtro, RLE, BWT, MTF. Com algum
+// estágio, os dados do bloco começam com varint(tamanho transformado), seguido
+// do varint(índice primário) se houver BWT e do descritor do filtro (1 byte)
+// se houver filtro; o tamanho original continua no cabeçalho.
+#define ESTAGIO_RLE 0x80               // Sequências de 4+ bytes iguais viram 4 bytes + varint
+#define ESTAGIO_MTF 0x40               // Move-to-front: cada byte vira a sua posição na lista
+#define ESTAGIO_BWT 0x20               // Transformada de Burrows-Wheeler (sempre seguida do MTF)
+#define ESTAGIO_FILTRO 0x10            // Filtro para dados numéricos (delta, planos de bytes)
+#define MASCARA_TIPO 0x0F
+#define NIVEL_MINIMO_MTF 4
+#define NIVEL_MINIMO_BWT 7
+#define MINIMO_BWT 4096                // Blocos menores não compensam a BWT
+
+// Filtros numéricos. O descritor guarda o tipo nos 3 bits altos e o passo
+// (tamanho do elemento, 1 a 16 bytes) nos 5 baixos.
+#define FILTRO_DELTA 1                 // Cada byte menos o byte 'passo' posições antes
+#define FILTRO_PLANOS 2                // Byte j de cada elemento vai para o plano j (como no blosc)
+#define FILTRO_PLANOS_DELTA 3          // Delta com o passo e depois planos
+#define PASSO_MAXIMO_FILTRO 16
+#define DESCRITOR_FILTRO(tipo, passo) (((tipo) << 5) | (passo))
+#define TIPO_FILTRO(descritor) ((descritor) >> 5)
+#define PASSO_FILTRO(descritor) ((descritor) & 0x1F)
+#define FILTRO_AUTOMATICO -1           // Escolhido por bloco a partir de uma amostra
+#define NIVEL_MINIMO_FILTRO 4
+#define GANHO_MINIMO_FILTRO 0.90       // O filtro precisa reduzir o custo da amostra em 10%
+#define JANELAS_AMOSTRA_FILTRO 8
+#define TAMANHO_JANELA_FILTRO 2048
+#define MAXIMO_REGISTRO 256            // Maior registro aceito na separação em colunas
+#define GANHO_MINIMO_ESTAGIO 0.97      // O estágio precisa reduzir o custo estimado em 3%
+
+// Função para aplicar o RLE: depois de 4 bytes iguais vem um varint com quantos
+// outros iguais foram omitidos. Retorna o tamanho da saída (no pior caso 5/4 de n).
+static size_t aplicarRle(const unsigned char* dados, size_t n, unsigned char* saida) {
+    size_t m = 0;
+    size_t i = 0;
+    while (i < n) {
+        unsigned char byte = dados[i];
+        size_t repeticoes = 1;
+        while (i + repeticoes < n && dados[i + repeticoes] == byte) repeticoes++;
+        i += repeticoes;
+
+        if (repeticoes < 4) {
+            while (repeticoes-- > 0) saida[m++] = byte;
+        } else {
+            memset(saida + m, byte, 4);
+            m += 4;
+            m += (size_t)escreverVarint(saida + m, repeticoes - 4);
+        }
+    }
+    return m;
+}
+
+// Função inversa do RLE. Retorna o tamanho da saída (-1 se passar de 'capacidade'
+// ou se os dados terminarem no meio de um varint).
+static long long desfazerRle(const unsigned char* dados, size_t m, unsigned char* saida, size_t capacidade) {
+    size_t n = 0;
+    int anterior = -1;
+    int iguais = 0;
+    size_t i = 0;
+    while (i < m) {
+        unsigned char byte = dados[i++];
+        if (n >= capacidade) return -1;
+        saida[n++] = byte;
+        iguais = byte == anterior ? iguais + 1 : 1;
+        anterior = byte;
+
+        if (iguais == 4) {
+            uint64_t repeticoes;
+            size_t lidos = lerVarint(dados + i, m - i, &repeticoes);
+            if (lidos == 0 || repeticoes > capacidade - n) return -1;
+            i += lidos;
+            memset(saida + n, byte, (size_t)repeticoes);
+            n += (size_t)repeticoes;
+            anterior = -1;
+            iguais = 0;
+        }
+    }
+    return (long long)n;
+}
+
+// Procedimento para aplicar o move-to-front (lista inicial 0..255)
+static void aplicarMtf(const unsigned char* dados, size_t n, unsigned char* saida) {
+    unsigned char lista[256];
+    for (int i = 0; i < 256; i++) lista[i] = (unsigned char)i;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned char byte = dados[i];
+        int posicao = 0;
+        while (lista[posicao] != byte) posicao++;
+        memmove(lista + 1, lista, (size_t)posicao);
+        lista[0] = byte;
+        saida[i] = (unsigned char)posicao;
+    }
+}
+
+// Procedimento inverso do move-to-front (pode ser feito no próprio buffer)
+static void desfazerMtf(unsigned char* dados, size_t n) {
+    unsigned char lista[256];
+    for (int i = 0; i < 256; i++) lista[i] = (unsigned char)i;
+
+    for (size_t i = 0; i < n; i++) {
+        int posicao = dados[i];
+        unsigned char byte = lista[posicao];
+        memmove(lista + 1, lista, (size_t)posicao);
+        lista[0] = byte;
+        dados[i] = byte;
+    }
+}
+
+// Procedimento de indução do SA-IS: a partir das posições LMS (na ordem dada),
+// posiciona os sufixos L (da esquerda para a direita) e S (da direita para a esquerda)
+static void induzirSufixos(const int32_t* s, int32_t n, int32_t maximo, const unsigned char* tipoS,
+                           const int32_t* somaL, const int32_t* somaS, const int32_t* lms, int32_t m,
+                           int32_t* sa, int32_t* balde) {
+    for (int32_t i = 0; i < n; i++) sa[i] = -1;
+
+    memcpy(balde, somaS, (size_t)(maximo + 1) * sizeof(int32_t));
+    for (int32_t i = 0; i < m; i++) {
+        int32_t d = lms[i];
+        if (d != n) sa[balde[s[d]]++] = d;
+    }
+
+    memcpy(balde, somaL, (size_t)(maximo + 1) * sizeof(int32_t));
+    sa[balde[s[n - 1]]++] = n - 1;
+    for (int32_t i = 0; i < n; i++) {
+        int32_t v = sa[i];
+        if (v >= 1 && !tipoS[v - 1]) sa[balde[s[v - 1]]++] = v - 1;
+    }
+
+    memcpy(balde, somaL, (size_t)(maximo + 1) * sizeof(int32_t));
+    for (int32_t i = n - 1; i >= 0; i--) {
+        int32_t v = sa[i];
+        if (v >= 1 && tipoS[v - 1]) sa[--balde[s[v - 1] + 1]] = v - 1;
+    }
+}
+
+// Função com a primeira etapa do SA-IS: classifica os sufixos em L e S, monta
+// os baldes, acha as posições LMS e faz a primeira indução. Retorna quantas
+// posições LMS existem.
+static int32_t prepararSais(const int32_t* s, int32_t n, int32_t maximo, int32_t* sa, unsigned char* tipoS,
+                            int32_t* somaL, int32_t* somaS, int32_t* balde, int32_t* mapaLms, int32_t* lms) {
+    // Tipo de cada sufixo: S se for menor que o seguinte, L se for maior
+    tipoS[n - 1] = 0;
+    for (int32_t i = n - 2; i >= 0; i--) {
+        tipoS[i] = s[i] == s[i + 1] ? tipoS[i + 1] : s[i] < s[i + 1];
+    }
+
+    // Início dos baldes L e S de cada símbolo
+    for (int32_t i = 0; i < n; i++) {
+        if (!tipoS[i]) somaS[s[i]]++;
+        else somaL[s[i] + 1]++;
+    }
+    for (int32_t i = 0; i <= maximo; i++) {
+        somaS[i] += somaL[i];
+        if (i < maximo) somaL[i + 1] += somaS[i];
+    }
+
+    // Posições LMS (S precedido de L)
+    int32_t m = 0;
+    for (int32_t i = 0; i <= n; i++) mapaLms[i] = -1;
+    for (int32_t i = 1; i < n; i++) {
+        if (!tipoS[i - 1] && tipoS[i]) {
+            mapaLms[i] = m;
+            lms[m++] = i;
+        }
+    }
+
+    induzirSufixos(s, n, maximo, tipoS, somaL, somaS, lms, m, sa, balde);
+    return m;
+}
+
+// Função para dar nomes às substrings LMS, na ordem da primeira indução:
+// substrings iguais recebem o mesmo nome. Retorna o maior nome usado.
+static int32_t nomearSubstringsLms(const int32_t* s, int32_t n, const int32_t* sa, const int32_t* mapaLms,
+                                   const int32_t* lms, int32_t m, int32_t* ordenados, int32_t* reduzido) {
+    int32_t k = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (mapaLms[sa[i]] != -1) ordenados[k++] = sa[i];
+    }
+
+    int32_t nome = 0;
+    reduzido[mapaLms[ordenados[0]]] = 0;
+    for (int32_t i = 1; i < m; i++) {
+        int32_t l = ordenados[i - 1], r = ordenados[i];
+        int32_t fimL = mapaLms[l] + 1 < m ? lms[mapaLms[l] + 1] : n;
+        int32_t fimR = mapaLms[r] + 1 < m ? lms[mapaLms[r] + 1] : n;
+        int iguais = 1;
+        if (fimL - l != fimR - r) {
+            iguais = 0;
+        } else {
+            while (l < fimL && s[l] == s[r]) {
+                l++;
+                r++;
+            }
+            if (l == n || s[l] != s[r]) iguais = 0;
+        }
+        if (!iguais) nome++;
+        reduzido[mapaLms[ordenados[i]]] = nome;
+    }
+    return nome;
+}
+
+// Função do SA-IS (Nong, Zhang e Chan), em tempo linear: ordena os sufixos de
+// s[0, n), com símbolos em [0, maximo], e grava as posições em 'sa'. A ordem
+// das posições LMS vem do problema reduzido, resolvido recursivamente.
+// Retorna 0 ou -1 se faltar memória na arena.
+static int construirSufixos(const int32_t* s, int32_t n, int32_t maximo, int32_t* sa, struct Arena* arena) {
+    if (n == 0) return 0;
+    if (n == 1) {
+        sa[0] = 0;
+        return 0;
+    }
+    if (n == 2) {
+        sa[0] = s[0] < s[1] ? 0 : 1;
+        sa[1] = 1 - sa[0];
+        return 0;
+    }
+
+    size_t marca = arena->usado;
+    unsigned char* tipoS = (unsigned char*)reservarArena(arena, (size_t)n);
+    int32_t* somaL = (int32_t*)reservarArena(arena, ((size_t)maximo + 2) * sizeof(int32_t));
+    int32_t* somaS = (int32_t*)reservarArena(arena, ((size_t)maximo + 2) * sizeof(int32_t));
+    int32_t* balde = (int32_t*)reservarArena(arena, ((size_t)maximo + 2) * sizeof(int32_t));
+    int32_t* mapaLms = (int32_t*)reservarArena(arena, ((size_t)n + 1) * sizeof(int32_t));
+    int32_t* lms = (int32_t*)reservarArena(arena, ((size_t)n / 2 + 1) * sizeof(int32_t));
+    int32_t* ordenados = (int32_t*)reservarArena(arena, ((size_t)n / 2 + 1) * sizeof(int32_t));
+
+    int status = -1;
+    if (tipoS && somaL && somaS && balde && mapaLms && lms && ordenados) {
+        memset(somaL, 0, ((size_t)maximo + 2) * sizeof(int32_t));
+        memset(somaS, 0, ((size_t)maximo + 2) * sizeof(int32_t));
+        int32_t m = prepararSais(s, n, maximo, sa, tipoS, somaL, somaS, balde, mapaLms, lms);
+        if (m == 0) {
+            status = 0;
+        } else {
+            int32_t* reduzido = (int32_t*)reservarArena(arena, (size_t)m * sizeof(int32_t));
+            int32_t* saReduzido = (int32_t*)reservarArena(arena, (size_t)m * sizeof(int32_t));
+            if (reduzido && saReduzido) {
+                int32_t nome = nomearSubstringsLms(s, n, sa, mapaLms, lms, m, ordenados, reduzido);
+                status = construirSufixos(reduzido, m, nome, saReduzido, arena);
+            }
+            if (status == 0) {
+                for (int32_t i = 0; i < m; i++) ordenados[i] = lms[saReduzido[i]];
+                induzirSufixos(s, n, maximo, tipoS, somaL, somaS, ordenados, m, sa, balde);
+            }
+        }
+    }
+
+    arena->usado = marca;
+    return status;
+}
+
+// Função para aplicar a BWT. A linha do sentinela (o menor sufixo, vazio) não
+// entra na saída: 'saida' recebe n bytes e a função retorna a posição dela
+// (o índice primário, de 1 a n), ou 0 se faltar memória na arena.
+static size_t aplicarBwt(const unsigned char* dados, size_t n, unsigned char* saida, struct Arena* arena) {
+    size_t marca = arena->usado;
+    int32_t* s = (int32_t*)reservarArena(arena, n * sizeof(int32_t));
+    int32_t* sa = (int32_t*)reservarArena(arena, n * sizeof(int32_t));
+    if (!s || !sa || n == 0) {
+        arena->usado = marca;
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++) s[i] = dados[i];
+    if (construirSufixos(s, (int32_t)n, 255, sa, arena) != 0) {
+        arena->usado = marca;
+        return 0;
+    }
+
+    // A rotação que começa no sentinela termina no último byte
+    size_t primario = 0;
+    size_t k = 0;
+    saida[k++] = dados[n - 1];
+    for (size_t i = 0; i < n; i++) {
+        if (sa[i] == 0) {
+            primario = i + 1;
+        } else {
+            saida[k++] = dados[sa[i] - 1];
+        }
+    }
+
+    arena->usado = marca;
+    return primario;
+}
+
+// Função inversa da BWT. Cada entrada de 'vetor' (n + 1 posições) guarda a
+// próxima linha nos 24 bits altos e o byte a emitir nos 8 baixos, então cada
+// passo é um único acesso aleatório à memória (como no bzip2).
+// Retorna 0 se ok ou -1 se o índice primário for inválido.
+static int desfazerBwt(const unsigned char* dados, size_t n, size_t primario, unsigned char* saida, uint32_t* vetor) {
+    if (primario == 0 || primario > n || n >= (1u << 24)) return -1;
+
+    // Início de cada byte na primeira coluna (o sentinela ocupa a linha 0)
+    uint32_t inicio[256] = {0};
+    for (size_t i = 0; i < n; i++) inicio[dados[i]]++;
+    uint32_t soma = 1;
+    for (int c = 0; c < 256; c++) {
+        uint32_t quantidade = inicio[c];
+        inicio[c] = soma;
+        soma += quantidade;
+    }
+
+    // Última coluna = dados com o sentinela inserido na linha 'primario'
+    vetor[0] = (uint32_t)primario << 8;
+    for (size_t linha = 0; linha <= n; linha++) {
+        if (linha == primario) continue;
+        unsigned char c = dados[linha < primario ? linha : linha - 1];
+        vetor[inicio[c]++] = ((uint32_t)linha << 8) | c;
+    }
+
+    uint32_t linha = (uint32_t)primario;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t entrada = vetor[linha];
+        saida[i] = (unsigned char)entrada;
+        linha = entrada >> 8;
+    }
+    return 0;
+}
+
+// Procedimento para aplicar um filtro numérico (descritor com tipo e passo)
+static void aplicarFiltro(const unsigned char* dados, size_t n, int descritor, unsigned char* saida) {
+    int tipo = TIPO_FILTRO(descritor);
+    size_t passo = (size_t)PASSO_FILTRO(descritor);
+
+    if (tipo == FILTRO_DELTA) {
+        for (size_t i = 0; i < n; i++) {
+            saida[i] = (unsigned char)(i < passo ? dados[i] : dados[i] - dados[i - passo]);
+        }
+        return;
+    }
+
+    // Planos (com delta antes, se for o caso); a sobra final fica como está
+    size_t elementos = n / passo;
+    for (size_t j = 0; j < passo; j++) {
+        for (size_t e = 0; e < elementos; e++) {
+            size_t i = e * passo + j;
+            unsigned char byte = dados[i];
+            if (tipo == FILTRO_PLANOS_DELTA && e > 0) byte = (unsigned char)(byte - dados[i - passo]);
+            saida[j * elementos + e] = byte;
+        }
+    }
+    memcpy(saida + elementos * passo, dados + elementos * passo, n - elementos * passo);
+}
+
+// Procedimento inverso do filtro numérico
+static void desfazerFiltro(const unsigned char* dados, size_t n, int descritor, unsigned char* saida) {
+    int tipo = TIPO_FILTRO(descritor);
+    size_t passo = (size_t)PASSO_FILTRO(descritor);
+
+    if (tipo == FILTRO_DELTA) {
+        for (size_t i = 0; i < n; i++) {
+            saida[i] = (unsigned char)(i < passo ? dados[i] : dados[i] + saida[i - passo]);
+        }
+        return;
+    }
+
+    size_t elementos = n / passo;
+    for (size_t j = 0; j < passo; j++) {
+        for (size_t e = 0; e < elementos; e++) {
+            size_t i = e * passo + j;
+            unsigned char byte = dados[j * elementos + e];
+            if (tipo == FILTRO_PLANOS_DELTA && e > 0) byte = (unsigned char)(byte + saida[i - passo]);
+            saida[i] = byte;
+        }
+    }
+    memcpy(saida + elementos * passo, dados + elementos * passo, n - elementos * passo);
+}
+
+// Função para validar um descritor de filtro lido do arquivo
+static int filtroValido(int descritor) {
+    int tipo = TIPO_FILTRO(descritor);
+    int passo = PASSO_FILTRO(descritor);
+    return tipo >= FILTRO_DELTA && tipo <= FILTRO_PLANOS_DELTA && passo >= 1 && passo <= PASSO_MAXIMO_FILTRO &&
+           (tipo == FILTRO_DELTA || passo >= 2);
+}
+
+// Função para escolher automaticamente o filtro de um bloco a partir de uma
+// amostra (algumas janelas espalhadas pelo bloco). Para cada passo, os
+// histogramas por posição dentro do elemento dão o custo dos planos (cada
+// plano com a sua estatística) sem precisar montá-los. Retorna o descritor
+// (0 = sem filtro).
+static int detectarFiltro(const unsigned char* dados, size_t n) {
+    static const int passos[] = {1, 2, 4, 8};
+    int numPassos = (int)(sizeof(passos) / sizeof(passos[0]));
+
+    // Janelas alinhadas ao maior passo
+    size_t tamanhoJanela = TAMANHO_JANELA_FILTRO;
+    int numJanelas = JANELAS_AMOSTRA_FILTRO;
+    if (n < (size_t)numJanelas * tamanhoJanela) {
+        numJanelas = 1;
+        tamanhoJanela = n;
+    }
+    if (tamanhoJanela < 64) return 0;
+
+    uint32_t histogramas[2][8][256];
+    uint32_t total[256];
+    double semFiltro = -1;
+    double melhor = 0;
+    int escolhido = 0;
+
+    for (int p = 0; p < numPassos; p++) {
+        int passo = passos[p];
+        memset(histogramas[0], 0, (size_t)passo * sizeof(histogramas[0][0]));
+        memset(histogramas[1], 0, (size_t)passo * sizeof(histogramas[1][0]));
+        for (int w = 0; w < numJanelas; w++) {
+            size_t inicio = numJanelas == 1 ? 0 : (n - tamanhoJanela) / (size_t)(numJanelas - 1) * (size_t)w;
+            inicio -= inicio % 8;
+            const unsigned char* janela = dados + inicio;
+            for (size_t i = (size_t)passo; i < tamanhoJanela; i++) {
+                int plano = (int)(i % (size_t)passo);
+                histogramas[0][plano][janela[i]]++;
+                histogramas[1][plano][(unsigned char)(janela[i] - janela[i - (size_t)passo])]++;
+            }
+        }
+
+        // custos[0]: planos; custos[1]: delta com o passo (planos do delta se passo > 1)
+        for (int d = 0; d < 2; d++) {
+            double planos = 0;
+            size_t amostra = 0;
+            memset(total, 0, sizeof(total));
+            for (int plano = 0; plano < passo; plano++) {
+                size_t noPlano = 0;
+                for (int c = 0; c < 256; c++) {
+                    noPlano += histogramas[d][plano][c];
+                    total[c] += histogramas[d][plano][c];
+                }
+                planos += estimarCustoBloco(histogramas[d][plano], noPlano);
+                amostra += noPlano;
+            }
+            double misturado = estimarCustoBloco(total, amostra);
+
+            if (p == 0 && d == 0) {
+                semFiltro = misturado;
+                melhor = semFiltro * GANHO_MINIMO_FILTRO;
+            } else if (d == 1 && misturado < melhor) {
+                melhor = misturado;
+                escolhido = DESCRITOR_FILTRO(FILTRO_DELTA, passo);
+            }
+            if (passo > 1 && planos < melhor) {
+                melhor = planos;
+                escolhido = DESCRITOR_FILTRO(d == 0 ? FILTRO_PLANOS : FILTRO_PLANOS_DELTA, passo);
+            }
+        }
+    }
+    return escolhido;
+}
+
+// Procedimento para separar registros de 'registro' bytes em colunas: a coluna
+// j (byte j de cada registro) vem inteira antes da coluna j + 1. Com um último
+// registro incompleto, as primeiras colunas ficam com um byte a mais.
+static void separarColunas(const unsigned char* dados, size_t n, size_t registro, unsigned char* colunas) {
+    size_t k = 0;
+    for (size_t j = 0; j < registro; j++) {
+        for (size_t i = j; i < n; i += registro) colunas[k++] = dados[i];
+    }
+}
+
+// Procedimento inverso de separarColunas
+static void juntarColunas(const unsigned char* colunas, size_t n, size_t registro, unsigned char* dados) {
+    size_t k = 0;
+    for (size_t j = 0; j < registro; j++) {
+        for (size_t i = j; i < n; i += registro) dados[i] = colunas[k++];
+    }
+}
+
+// Bloco original por trás de um bloco transformado
+struct EstagiosBloco {
+    int estagios;                          // ESTAGIO_FILTRO | ESTAGIO_RLE | ESTAGIO_BWT | ESTAGIO_MTF (0 = nenhum)
+    size_t primario;                       // Índice primário da BWT
+    int filtro;                            // Descritor do filtro
+    const unsigned char* original;
+    size_t tamanhoOriginal;
+};
+
+// Procedimento para gravar um bloco cujos 'n' bytes podem ser a versão
+// transformada do original. Bloco armazenado sempre guarda o original.
+static void escreverBlocoComEstagios(struct SaidaBlocos* saida, int tipo, const struct EstagiosBloco* estagios,
+                                     size_t n, const unsigned char* dados, size_t tamanho) {
+    if (!estagios || estagios->estagios == 0) {
+        gravarBloco(saida, tipo, n, dados, tamanho);
+        return;
+    }
+    if (tipo == BLOCO_ARMAZENADO) {
+        gravarBloco(saida, BLOCO_ARMAZENADO, estagios->tamanhoOriginal, estagios->original,
+                    estagios->tamanhoOriginal);
+        return;
+    }
+
+    unsigned char transformado[2 * 10 + 1];
+    int t = escreverVarint(transformado, n);
+    if (estagios->estagios & ESTAGIO_BWT) {
+        t += escreverVarint(transformado + t, estagios->primario);
+    }
+    if (estagios->estagios & ESTAGIO_FILTRO) {
+        transformado[t++] = (unsigned char)estagios->filtro;
+    }
+    unsigned char cabecalho[1 + 2 * 10];
+    int c = 0;
+    cabecalho[c++] = (unsigned char)(tipo | estagios->estagios);
+    c += escreverVarint(cabecalho + c, estagios->tamanhoOriginal);
+    c += escreverVarint(cabecalho + c, tamanho + (size_t)t);
+    gravarSaida(saida, cabecalho, (size_t)c);
+    gravarSaida(saida, transformado, (size_t)t);
+    gravarSaida(saida, dados, tamanho);
+}
+
+// Última tabela enviada, que o bloco seguinte pode reaproveitar
+struct TabelaAnterior {
+    struct CodigoHuffman dicionario[256];
+    int valida;
+};
+
+// Tabela pré-definida (huff_preset em libhuff.h): treinada uma vez num corpus de
+// exemplo e carregada pelos dois lados antes de qualquer mensagem. O bloco leva
+// só o ID dela, então mensagens pequenas não pagam a árvore no cabeçalho.
+struct huff_preset {
+    uint32_t id;
+    uint8_t tamanhos[256];
+    struct CodigoHuffman dicionario[256];
+    struct ArvoreDecodificacao arvore;
+};
+
+// Função para montar uma tabela pré-definida a partir das contagens de um corpus.
+// Todo byte ganha peso mínimo 1 (como no modo semiadaptativo), então continua
+// codificável mesmo sem ter aparecido nas amostras. Retorna 0 ou -1.
+static int montarPreset(struct huff_preset* preset, const uint64_t contagem[256], uint32_t id) {
+    uint64_t suavizada[256];
+    int frequencias[256];
+
+    for (int i = 0; i < 256; i++) {
+        suavizada[i] = contagem[i] + 1;
+    }
+    normalizarFrequencias(suavizada, frequencias);
+    construirDicionario(frequencias, preset->dicionario);
+
+    preset->id = id;
+    for (int i = 0; i < 256; i++) {
+        preset->tamanhos[i] = preset->dicionario[i].tamanho;
+    }
+    return montarDecodificacaoDicionario(preset->dicionario, &preset->arvore);
+}
+
+// Função para montar uma tabela pré-definida a partir dos tamanhos gravados.
+// Retorna -1 se eles não formarem um código completo (soma de Kraft = 1).
+static int montarPresetTamanhos(struct huff_preset* preset, const uint8_t tamanhos[256], uint32_t id) {
+    int inteiros[256];
+    uint32_t kraft = 0;
+    int presentes = 0;
+    for (int i = 0; i < 256; i++) {
+        if (tamanhos[i] > TAMANHO_MAXIMO_CODIGO) return -1;
+        if (tamanhos[i] > 0) {
+            kraft += 1u << (TAMANHO_MAXIMO_CODIGO - tamanhos[i]);
+            presentes++;
+        }
+        inteiros[i] = tamanhos[i];
+    }
+    if (presentes < 2 || kraft != 1u << TAMANHO_MAXIMO_CODIGO) return -1;
+
+    preset->id = id;
+    memcpy(preset->tamanhos, tamanhos, 256);
+    gerarCodigosCanonicos(inteiros, preset->dicionario);
+    return montarDecodificacaoDicionario(preset->dicionario, &preset->arvore);
+}
+
+// Função para codificar um bloco com uma tabela pré-definida: ID (varint),
+// bits de lixo (1 byte) e bits. Retorna os bytes gravados em 'destino'
+// (capacidade mínima: 2 * n + 24).
+static size_t codificarBlocoPreset(const unsigned char* dados, size_t n, const struct huff_preset* preset,
+                                   unsigned char* destino) {
+    size_t cabecalho = (size_t)escreverVarint(destino, preset->id);
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + cabecalho + 1, 2 * n + 8, NULL);
+    codificarBytes(&escritor, dados, n, preset->dicionario);
+    destino[cabecalho] = (unsigned char)finalizarEscritor(&escritor);
+    return cabecalho + 1 + escritor.posicao;
+}
+
+// Função para decodificar um bloco BLOCO_PRESET com a tabela de mesmo ID entre
+// as 'numPresets' carregadas. Retorna 0 ou -1 (ID desconhecido ou bloco inválido).
+static int decodificarBlocoPreset(const unsigned char* dados, size_t tamanho, unsigned char* saida,
+                                  size_t tamanhoOriginal, const struct huff_preset* const* presets, int numPresets) {
+    uint64_t id;
+    size_t inicio = lerVarint(dados, tamanho, &id);
+    if (inicio == 0 || inicio >= tamanho || dados[inicio] > 7) return -1;
+
+    const struct huff_preset* preset = NULL;
+    for (int i = 0; i < numPresets && !preset; i++) {
+        if (presets[i]->id == id) preset = presets[i];
+    }
+    if (!preset) return -1;
+
+    int lixo = dados[inicio++];
+    long long totalBits = (long long)(tamanho - inicio) * 8 - lixo;
+    long long bitsLidos = 0;
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + inicio, tamanho - inicio);
+
+    size_t n = decodificarSimbolos(&preset->arvore, &leitor, totalBits, &bitsLidos, saida, tamanhoOriginal);
+    return (n == tamanhoOriginal && bitsLidos == totalBits) ? 0 : -1;
+}
+
+// Cache de tabelas (-C): as últimas tabelas montadas pelo compressor, guardadas
+// num arquivo entre uma execução e outra e procuradas pela assinatura do
+// histograma (a faixa de probabilidade de cada byte). Um bloco com assinatura
+// próxima usa a tabela do cache num BLOCO_PRESET cujo ID é o hash dos tamanhos
+// dos códigos: nada de árvore no arquivo nem de árvore nova para montar.
+#define MAXIMO_CACHE 32
+#define FAIXAS_ASSINATURA 12           // Faixas de probabilidade, de 1/2048 até 1
+#define DISTANCIA_CACHE 16             // Soma das diferenças de faixa aceita como "mesma estatística"
+#define LIMIAR_CACHE 0.02              // Perda máxima sobre a entropia para usar a tabela do cache direto
+#define MINIMO_CACHE PEDACO_MINIMO     // Blocos menores não criam entradas novas
+
+struct EntradaCache {
+    uint8_t assinatura[256];
+    uint64_t uso;                      // Relógio do último uso (a menor sai primeiro)
+    struct huff_preset preset;
+};
+
+struct CacheTabelas {
+    struct EntradaCache entradas[MAXIMO_CACHE];
+    int numEntradas;
+    uint64_t relogio;
+    uint64_t inicioExecucao;           // Relógio ao carregar: entradas com uso maior estão nesta execução
+    int alterado;                      // Entrou tabela nova desde a leitura do arquivo
+};
+
+// Função para calcular o ID de uma tabela do cache (FNV-1a dos tamanhos)
+static uint32_t hashTamanhos(const uint8_t tamanhos[256]) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 256; i++) {
+        hash = (hash ^ tamanhos[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Procedimento para calcular a assinatura de um histograma: a faixa de
+// probabilidade de cada byte (potências de 2 a partir de 1/2048; abaixo disso
+// conta como ausente, pois as tabelas do cache dão código a todos os bytes)
+static void assinaturaHistograma(const int frequencias[256], size_t n, uint8_t assinatura[256]) {
+    for (int i = 0; i < 256; i++) {
+        uint64_t escala = n > 0 ? ((uint64_t)frequencias[i] << (FAIXAS_ASSINATURA - 1)) / n : 0;
+        assinatura[i] = (uint8_t)(escala > 0 ? 1 + bitMaisAlto((uint32_t)escala) : 0);
+    }
+}
+
+// Função para procurar a entrada de assinatura mais próxima (soma das
+// diferenças de faixa até DISTANCIA_CACHE). Retorna o índice ou -1.
+static int procurarCache(const struct CacheTabelas* cache, const uint8_t assinatura[256]) {
+    int melhor = -1;
+    int menorDistancia = DISTANCIA_CACHE + 1;
+    for (int e = 0; e < cache->numEntradas; e++) {
+        const uint8_t* outra = cache->entradas[e].assinatura;
+        int distancia = 0;
+        for (int i = 0; i < 256 && distancia < menorDistancia; i++) {
+            distancia += assinatura[i] > outra[i] ? assinatura[i] - outra[i] : outra[i] - assinatura[i];
+        }
+        if (distancia < menorDistancia) {
+            menorDistancia = distancia;
+            melhor = e;
+        }
+    }
+    return melhor;
+}
+
+// Procedimento para guardar no cache a tabela do histograma (com peso mínimo 1
+// para todos os bytes), no lugar da entrada usada há mais tempo se estiver cheio.
+// Entradas usadas ou criadas nesta execução não saem, pois algum bloco já
+// gravado pode apontar para elas; sem outra para tirar, a tabela não entra.
+static void inserirCache(struct CacheTabelas* cache, const uint8_t assinatura[256], const int frequencias[256]) {
+    int indice = cache->numEntradas;
+    if (indice == MAXIMO_CACHE) {
+        indice = -1;
+        for (int i = 0; i < MAXIMO_CACHE; i++) {
+            if (cache->entradas[i].uso <= cache->inicioExecucao &&
+                (indice < 0 || cache->entradas[i].uso < cache->entradas[indice].uso)) {
+                indice = i;
+            }
+        }
+        if (indice < 0) return;
+    }
+
+    uint64_t contagem[256];
+    struct huff_preset nova;
+    for (int i = 0; i < 256; i++) contagem[i] = (uint64_t)frequencias[i];
+    if (montarPreset(&nova, contagem, 0) != 0) return;
+    nova.id = hashTamanhos(nova.tamanhos);
+
+    struct EntradaCache* entrada = &cache->entradas[indice];
+    entrada->preset = nova;
+    memcpy(entrada->assinatura, assinatura, 256);
+    entrada->uso = ++cache->relogio;
+    if (indice == cache->numEntradas) cache->numEntradas++;
+    cache->alterado = 1;
+}
+
+// Função para calcular a entropia de ordem 0 de um histograma, em bits
+static double entropiaHistograma(const int frequencias[256], size_t n) {
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencias[i] > 0) bits += frequencias[i] * log2((double)n / frequencias[i]);
+    }
+    return bits;
+}
+
+// Procedimento para compactar um bloco, caindo para armazenado quando não compensa.
+// Reaproveita a tabela do bloco anterior quando os bits a mais custam menos que
+// gravar a árvore nova.
+// 'estagios' (ou NULL) indica que 'dados' é a versão transformada do bloco original.
+// Os planos dos modos avançados ficam na arena só enquanto o bloco é gravado.
+// Com 'preset' (ou NULL), a tabela pré-definida concorre como mais uma opção.
+static void compactarBloco(const unsigned char* dados, size_t n, int nivel, unsigned char* destino,
+                           struct SaidaBlocos* saida, struct TabelaAnterior* anterior,
+                           const struct EstagiosBloco* estagios, struct Arena* arena,
+                           const struct huff_preset* preset) {
+    // Acima deste tamanho compensa mais armazenar o bloco original
+    size_t limite = estagios && estagios->estagios ? estagios->tamanhoOriginal : n;
+
+    int frequencias[256];
+    histogramaBloco(dados, n, configuracoesNivel[nivel].divisorAmostra, frequencias);
+
+    int presentes = 0;
+    int unico = 0;
+    long long soma = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencias[i] > 0) {
+            presentes++;
+            unico = i;
+            soma += frequencias[i];
+        }
+    }
+
+    // Bloco de um símbolo só: árvore de uma folha e nenhum bit de dados
+    unsigned char arvore[2 * MAXIMO_NOS];
+    int tamanho_arvore = 0;
+    if (presentes == 1) {
+        struct ReservaNos reserva;
+        reserva.usados = 0;
+        escreverArvorePreOrdem(criarNo(&reserva, (unsigned char)unico, 1), arvore, &tamanho_arvore);
+        size_t tamanho = codificarBlocoHuffman(dados, 0, NULL, arvore, tamanho_arvore, destino);
+        if (tamanho >= limite) {
+            escreverBlocoComEstagios(saida, BLOCO_ARMAZENADO, estagios, n, dados, n);
+        } else {
+            escreverBlocoComEstagios(saida, BLOCO_HUFFMAN, estagios, n, destino, tamanho);
+            anterior->valida = 0;
+        }
+        return;
+    }
+
+    struct CodigoHuffman novo[256];
+    construirDicionario(frequencias, novo);
+    tamanho_arvore = escreverArvoreDicionario(novo, arvore);
+
+    // Comparar em bits reais (o histograma pode ser só uma amostra do bloco)
+    double escala = (double)n / (double)soma;
+    long long bitsNovo = custoCodificacao(frequencias, novo);
+    long long bitsAnterior = anterior->valida ? custoCodificacao(frequencias, anterior->dicionario) : -1;
+    int reutilizar = bitsAnterior >= 0 &&
+                     bitsAnterior * escala <= bitsNovo * escala + 8.0 * tamanho_arvore;
+
+    // Modos avançados (níveis altos): cada um só é usado se ficar menor que a
+    // melhor opção encontrada até aqui
+    size_t tamanho;
+    double melhorBits = reutilizar ? bitsAnterior * escala + 16 : bitsNovo * escala + 8.0 * (2 + tamanho_arvore);
+    size_t marca = arena->usado;
+    struct PlanoMultiTabela* planoMulti = NULL;
+    struct PlanoOrdem1* planoOrdem1 = NULL;
+
+    // Tabela pré-definida: só os bits e o ID, sem árvore
+    int usarPreset = 0;
+    if (preset) {
+        unsigned char id[10];
+        long long bitsPreset = custoCodificacao(frequencias, preset->dicionario);
+        double bits = bitsPreset * escala + 8.0 * (1 + escreverVarint(id, preset->id));
+        if (bitsPreset >= 0 && bits < melhorBits) {
+            melhorBits = bits;
+            usarPreset = 1;
+        }
+    }
+
+    // O tANS substitui o Huffman de tabela única quando a estimativa dele é menor
+    int usarTans = 0;
+    if (nivel >= NIVEL_MINIMO_TANS) {
+        double bits = estimarBitsTans(frequencias, escala);
+        if (bits < melhorBits) {
+            melhorBits = bits;
+            usarTans = 1;
+        }
+    }
+
+    int passes = configuracoesNivel[nivel].passesMultiTabela;
+    if (passes > 0 && n >= MINIMO_MULTI_TABELA) {
+        planoMulti = (struct PlanoMultiTabela*)reservarArena(arena, sizeof(struct PlanoMultiTabela));
+        size_t previsto = planoMulti ? planejarMultiTabela(dados, n, passes, planoMulti) : 0;
+        if (previsto > 0 && previsto * 8.0 < melhorBits) {
+            melhorBits = previsto * 8.0;
+        } else {
+            planoMulti = NULL;
+        }
+    }
+
+    int grupos = configuracoesNivel[nivel].gruposContexto;
+    if (grupos > 0 && n >= MINIMO_ORDEM1) {
+        planoOrdem1 = (struct PlanoOrdem1*)reservarArena(arena, sizeof(struct PlanoOrdem1));
+        size_t previsto = planoOrdem1 ? planejarOrdem1(dados, n, grupos, planoOrdem1, arena) : 0;
+        if (previsto > 0 && previsto * 8.0 < melhorBits) {
+            melhorBits = previsto * 8.0;
+            planoMulti = NULL;
+        } else {
+            planoOrdem1 = NULL;
+        }
+    }
+
+    if (planoMulti || planoOrdem1) {
+        int tipo = planoMulti ? BLOCO_MULTI_TABELA : BLOCO_ORDEM1;
+        if (planoMulti) {
+            tamanho = codificarBlocoMultiTabela(dados, n, planoMulti, destino);
+        } else {
+            tamanho = codificarBlocoOrdem1(dados, n, planoOrdem1, destino);
+        }
+        arena->usado = marca;
+
+        if (tamanho < limite) {
+            escreverBlocoComEstagios(saida, tipo, estagios, n, destino, tamanho);
+        } else {
+            escreverBlocoComEstagios(saida, BLOCO_ARMAZENADO, estagios, n, dados, n);
+        }
+        return;
+    }
+
+    arena->usado = marca;
+    if (usarTans) {
+        tamanho = codificarBlocoTans(dados, n, frequencias, destino, arena);
+        if (tamanho > 0 && tamanho < limite) {
+            escreverBlocoComEstagios(saida, BLOCO_TANS, estagios, n, destino, tamanho);
+        } else {
+            escreverBlocoComEstagios(saida, BLOCO_ARMAZENADO, estagios, n, dados, n);
+        }
+        return;
+    }
+
+    // O bloco com tabela pré-definida não muda a tabela reaproveitável
+    if (usarPreset) {
+        tamanho = codificarBlocoPreset(dados, n, preset, destino);
+        if (tamanho < limite) {
+            escreverBlocoComEstagios(saida, BLOCO_PRESET, estagios, n, destino, tamanho);
+        } else {
+            escreverBlocoComEstagios(saida, BLOCO_ARMAZENADO, estagios, n, dados, n);
+        }
+        return;
+    }
+
+    if (reutilizar) {
+        tamanho = codificarBlocoHuffman(dados, n, anterior->dicionario, NULL, 0, destino);
+    } else {
+        tamanho = codificarBlocoHuffman(dados, n, novo, arvore, tamanho_arvore, destino);
+    }
+
+    if (tamanho >= limite) {
+        escreverBlocoComEstagios(saida, BLOCO_ARMAZENADO, estagios, n, dados, n);
+    } else if (reutilizar) {
+        escreverBlocoComEstagios(saida, BLOCO_HUFFMAN_REPETIDO, estagios, n, destino, tamanho);
+    } else {
+        escreverBlocoComEstagios(saida, BLOCO_HUFFMAN, estagios, n, destino, tamanho);
+        memcpy(anterior->dicionario, novo, sizeof(novo));
+        anterior->valida = 1;
+    }
+}
+
+// Função para escolher os estágios (filtro, RLE, BWT, MTF) de um bloco pelo
+// custo de ordem 0 estimado. 'filtro' é um descritor, 0 ou FILTRO_AUTOMATICO.
+// Deixa em 'estagios' a escolha e em *atual / *tamanhoAtual os dados já
+// transformados (dentro de 'trabalho', que precisa de 4 * (n + n / 4 + 16)
+// bytes; a BWT usa a arena). Retorna o custo estimado em bits.
+static double escolherEstagios(const unsigned char* dados, size_t n, int nivel, int filtro, unsigned char* trabalho,
+                               struct Arena* arena, struct EstagiosBloco* estagios, const unsigned char** atual,
+                               size_t* tamanhoAtual) {
+    estagios->estagios = 0;
+    estagios->primario = 0;
+    estagios->filtro = 0;
+    estagios->original = dados;
+    estagios->tamanhoOriginal = n;
+
+    // O filtro vem primeiro: os outros estágios trabalham sobre os dados filtrados
+    if (filtro == FILTRO_AUTOMATICO) {
+        filtro = nivel >= NIVEL_MINIMO_FILTRO ? detectarFiltro(dados, n) : 0;
+    }
+    if (filtro != 0) {
+        unsigned char* filtrado = trabalho + 3 * (n + n / 4 + 16);
+        aplicarFiltro(dados, n, filtro, filtrado);
+        estagios->estagios = ESTAGIO_FILTRO;
+        estagios->filtro = filtro;
+        dados = filtrado;
+    }
+
+    uint32_t histograma[256] = {0};
+    for (size_t i = 0; i < n; i++) histograma[dados[i]]++;
+    double melhor = estimarCustoBloco(histograma, n);
+
+    *atual = dados;
+    *tamanhoAtual = n;
+
+    // RLE só é tentado quando boa parte dos bytes repete o anterior
+    size_t repetidos = 0;
+    for (size_t i = 1; i < n; i++) repetidos += dados[i] == dados[i - 1];
+
+    unsigned char* rle = trabalho;
+    if (repetidos > n / 8) {
+        size_t m = aplicarRle(dados, n, rle);
+        if (m <= n) {
+            memset(histograma, 0, sizeof(histograma));
+            for (size_t i = 0; i < m; i++) histograma[rle[i]]++;
+            double custo = estimarCustoBloco(histograma, m);
+            if (custo < melhor * GANHO_MINIMO_ESTAGIO) {
+                melhor = custo;
+                estagios->estagios |= ESTAGIO_RLE;
+                *atual = rle;
+                *tamanhoAtual = m;
+            }
+        }
+    }
+    if (nivel < NIVEL_MINIMO_MTF) return melhor;
+
+    // MTF sozinho
+    unsigned char* mtf = trabalho + n + n / 4 + 16;
+    aplicarMtf(*atual, *tamanhoAtual, mtf);
+    memset(histograma, 0, sizeof(histograma));
+    for (size_t i = 0; i < *tamanhoAtual; i++) histograma[mtf[i]]++;
+    double custoMtf = estimarCustoBloco(histograma, *tamanhoAtual);
+
+    // BWT seguida de MTF (o MTF pode ser feito no próprio buffer)
+    unsigned char* bwt = trabalho + 2 * (n + n / 4 + 16);
+    size_t primario = 0;
+    double custoBwt = custoMtf;
+    if (nivel >= NIVEL_MINIMO_BWT && *tamanhoAtual >= MINIMO_BWT) {
+        primario = aplicarBwt(*atual, *tamanhoAtual, bwt, arena);
+    }
+    if (primario != 0) {
+        aplicarMtf(bwt, *tamanhoAtual, bwt);
+        memset(histograma, 0, sizeof(histograma));
+        for (size_t i = 0; i < *tamanhoAtual; i++) histograma[bwt[i]]++;
+        custoBwt = estimarCustoBloco(histograma, *tamanhoAtual);
+    }
+
+    if (primario != 0 && custoBwt < custoMtf && custoBwt < melhor * GANHO_MINIMO_ESTAGIO) {
+        estagios->estagios |= ESTAGIO_BWT | ESTAGIO_MTF;
+        estagios->primario = primario;
+        *atual = bwt;
+        melhor = custoBwt;
+    } else if (custoMtf < melhor * GANHO_MINIMO_ESTAGIO) {
+        estagios->estagios |= ESTAGIO_MTF;
+        *atual = mtf;
+        melhor = custoMtf;
+    }
+    return melhor;
+}
+
+// Procedimento para escolher os estágios do bloco e compactá-lo já transformado.
+// A tabela pré-definida foi treinada com dados originais: se ela sozinha custa
+// menos que os estágios, o bloco vai sem transformação.
+// Com 'cache' (ou NULL), uma tabela do cache com assinatura próxima é usada
+// direto quando perde pouco para a entropia de ordem 0 (só nos níveis sem os
+// modos de ordem 1 e várias tabelas, que podem ficar bem abaixo dela); senão
+// ela concorre como tabela pré-definida.
+// Blocos sem tabela no cache deixam a deles para os próximos.
+static void compactarBlocoComEstagios(const unsigned char* dados, size_t n, int nivel, int filtro,
+                                      unsigned char* destino, struct SaidaBlocos* saida,
+                                      struct TabelaAnterior* anterior, unsigned char* trabalho, struct Arena* arena,
+                                      const struct huff_preset* preset, struct CacheTabelas* cache) {
+    if (cache) {
+        int frequencias[256];
+        uint8_t assinatura[256];
+        histogramaBloco(dados, n, 0, frequencias);
+        assinaturaHistograma(frequencias, n, assinatura);
+        int indice = procurarCache(cache, assinatura);
+        if (indice < 0) {
+            if (n >= MINIMO_CACHE) inserirCache(cache, assinatura, frequencias);
+        } else {
+            struct EntradaCache* entrada = &cache->entradas[indice];
+            entrada->uso = ++cache->relogio;
+            preset = &entrada->preset;
+
+            long long bits = custoCodificacao(frequencias, preset->dicionario);
+            const struct ConfigNivel* config = &configuracoesNivel[nivel];
+            if (config->gruposContexto == 0 && config->passesMultiTabela == 0 && bits >= 0 &&
+                bits <= entropiaHistograma(frequencias, n) * (1 + LIMIAR_CACHE)) {
+                size_t tamanho = codificarBlocoPreset(dados, n, preset, destino);
+                if (tamanho < n) {
+                    gravarBloco(saida, BLOCO_PRESET, n, destino, tamanho);
+                    return;
+                }
+            }
+        }
+    }
+
+    struct EstagiosBloco estagios;
+    const unsigned char* atual;
+    size_t tamanhoAtual;
+    double custo = escolherEstagios(dados, n, nivel, filtro, trabalho, arena, &estagios, &atual, &tamanhoAtual);
+    if (preset && estagios.estagios) {
+        int frequencias[256];
+        histogramaBloco(dados, n, 0, frequencias);
+        long long bitsPreset = custoCodificacao(frequencias, preset->dicionario);
+        if (bitsPreset >= 0 && bitsPreset <= custo) {
+            compactarBloco(dados, n, nivel, destino, saida, anterior, NULL, arena, preset);
+            return;
+        }
+    }
+    compactarBloco(atual, tamanhoAtual, nivel, destino, saida, anterior, &estagios, arena, preset);
+}
+
+// Função para decidir, nos níveis com BWT, se a janela inteira fica num bloco
+// só: a divisão olha a estatística de ordem 0 e cortaria os contextos longos
+// que a BWT aproveita. Compara o custo estimado da janela inteira com a soma
+// dos blocos divididos, cada um com os seus melhores estágios.
+static int preferirJanelaInteira(const unsigned char* janela, size_t n, const size_t tamanhos[], int numBlocos,
+                                 int nivel, int filtro, unsigned char* trabalho, struct Arena* arena) {
+    if (numBlocos < 2 || n < MINIMO_BWT) return 0;
+
+    struct EstagiosBloco estagios;
+    const unsigned char* atual;
+    size_t tamanhoAtual;
+    double divididos = 0;
+    size_t deslocamento = 0;
+    for (int b = 0; b < numBlocos; b++) {
+        divididos += escolherEstagios(janela + deslocamento, tamanhos[b], nivel, filtro, trabalho, arena,
+                                      &estagios, &atual, &tamanhoAtual);
+        deslocamento += tamanhos[b];
+    }
+
+    double inteira = escolherEstagios(janela, n, nivel, filtro, trabalho, arena, &estagios, &atual, &tamanhoAtual);
+    return (estagios.estagios & ESTAGIO_BWT) && inteira < divididos;
+}
+
+// Grupo fixo de threads que executa uma tarefa para cada índice de 0 a
+// total - 1, com a thread que chamou trabalhando junto. As threads só existem
+// quando o programa é compilado com -DHUFF_THREADS (e -pthread); sem isso o
+// grupo tem só a thread que chamou e os índices rodam em sequência, com o
+// mesmo resultado.
+#define MAXIMO_THREADS 64
+
+struct GrupoThreads {
+    int numThreads;                    // Inclui a thread que chama executarParalelo
+    void (*tarefa)(void* contexto, size_t indice, int thread);
+    void* contexto;
+    size_t proximo;                    // Próximo índice a ser pego
+    size_t total;
+    size_t concluidos;
+#ifdef HUFF_THREADS
+    pthread_t* threads;
+    pthread_mutex_t trava;
+    pthread_cond_t inicio;             // Nova rodada ou encerramento
+    pthread_cond_t fim;                // O último índice da rodada terminou
+    unsigned long rodada;
+    int iniciadas;
+    int encerrar;
+#endif
+};
+
+#ifdef HUFF_THREADS
+// Procedimento para pegar e executar índices da rodada até acabarem. Chamado
+// com a trava, que fica livre enquanto a tarefa roda.
+static void executarIndices(struct GrupoThreads* grupo, int thread) {
+    while (grupo->proximo < grupo->total) {
+        size_t indice = grupo->proximo++;
+        pthread_mutex_unlock(&grupo->trava);
+        grupo->tarefa(grupo->contexto, indice, thread);
+        pthread_mutex_lock(&grupo->trava);
+        if (++grupo->concluidos == grupo->total) pthread_cond_broadcast(&grupo->fim);
+    }
+}
+
+// Laço de cada thread do grupo: espera uma rodada nova e trabalha nela
+static void* executarThreadGrupo(void* argumento) {
+    struct GrupoThreads* grupo = (struct GrupoThreads*)argumento;
+    pthread_mutex_lock(&grupo->trava);
+    int thread = grupo->iniciadas++;
+    unsigned long vista = 0;
+    while (1) {
+        while (!grupo->encerrar && grupo->rodada == vista) {
+            pthread_cond_wait(&grupo->inicio, &grupo->trava);
+        }
+        if (grupo->encerrar) break;
+        vista = grupo->rodada;
+        executarIndices(grupo, thread);
+    }
+    pthread_mutex_unlock(&grupo->trava);
+    return NULL;
+}
+#endif
+
+// Função para criar um grupo com até 'numThreads' threads (a que chama
+// conta como uma). Retorna NULL se faltar memória.
+static struct GrupoThreads* criarGrupoThreads(int numThreads) {
+    struct GrupoThreads* grupo = (struct GrupoThreads*)malloc(sizeof(struct GrupoThreads));
+    if (!grupo) return NULL;
+    grupo->numThreads = 1;
+    grupo->total = 0;
+#ifdef HUFF_THREADS
+    grupo->threads = numThreads > 1 ? (pthread_t*)malloc((size_t)(numThreads - 1) * sizeof(pthread_t)) : NULL;
+    pthread_mutex_init(&grupo->trava, NULL);
+    pthread_cond_init(&grupo->inicio, NULL);
+    pthread_cond_init(&grupo->fim, NULL);
+    grupo->rodada = 0;
+    grupo->iniciadas = 1;
+    grupo->encerrar = 0;
+
+    // Se alguma thread não puder ser criada, o grupo fica com as que já existem
+    while (grupo->threads && grupo->numThreads < numThreads &&
+           pthread_create(&grupo->threads[grupo->numThreads - 1], NULL, executarThreadGrupo, grupo) == 0) {
+        grupo->numThreads++;
+    }
+#else
+    (void)numThreads;
+#endif
+    return grupo;
+}
+
+// Procedimento para encerrar as threads e liberar o grupo
+static void liberarGrupoThreads(struct GrupoThreads* grupo) {
+    if (!grupo) return;
+#ifdef HUFF_THREADS
+    pthread_mutex_lock(&grupo->trava);
+    grupo->encerrar = 1;
+    pthread_cond_broadcast(&grupo->inicio);
+    pthread_mutex_unlock(&grupo->trava);
+    for (int t = 0; t < grupo->numThreads - 1; t++) {
+        pthread_join(grupo->threads[t], NULL);
+    }
+    pthread_mutex_destroy(&grupo->trava);
+    pthread_cond_destroy(&grupo->inicio);
+    pthread_cond_destroy(&grupo->fim);
+    free(grupo->threads);
+#endif
+    free(grupo);
+}
+
+// Procedimento para executar tarefa(contexto, i, thread) para i de 0 a
+// total - 1, dividindo os índices entre as threads do grupo. 'thread' vai de
+// 0 (a que chamou) a numThreads - 1. Retorna quando todos terminarem.
+static void executarParalelo(struct GrupoThreads* grupo, size_t total, void (*tarefa)(void*, size_t, int),
+                             void* contexto) {
+#ifdef HUFF_THREADS
+    if (grupo->numThreads > 1 && total > 1) {
+        pthread_mutex_lock(&grupo->trava);
+        grupo->tarefa = tarefa;
+        grupo->contexto = contexto;
+        grupo->proximo = 0;
+        grupo->total = total;
+        grupo->concluidos = 0;
+        grupo->rodada++;
+        pthread_cond_broadcast(&grupo->inicio);
+
+        executarIndices(grupo, 0);
+        while (grupo->concluidos < grupo->total) {
+            pthread_cond_wait(&grupo->fim, &grupo->trava);
+        }
+        pthread_mutex_unlock(&grupo->trava);
+        return;
+    }
+#else
+    (void)grupo;
+#endif
+    for (size_t i = 0; i < total; i++) {
+        tarefa(contexto, i, 0);
+    }
+}
+
+// Áreas de trabalho do compressor em blocos, dimensionadas para janelas de até
+// 'tamanhoJanela' bytes e reaproveitadas de uma janela para a outra. Toda a
+// memória temporária dos blocos (divisão, planos, tANS, SA-IS) sai da arena.
+struct AreasCompressao {
+    size_t tamanhoJanela;
+    int nivel;                         // Maior nível para o qual a arena foi dimensionada
+    unsigned char* destino;
+    size_t* tamanhos;
+    unsigned char* trabalho;
+    unsigned char* colunas;            // Só com separação em colunas
+    struct Arena arena;
+    struct TabelaAnterior anterior;
+    const struct huff_preset* preset;  // Tabela pré-definida oferecida aos blocos (ou NULL)
+    struct CacheTabelas* cache;        // Cache de tabelas (-C) ou NULL
+    struct GrupoThreads* grupo;        // Threads para os blocos de cada janela (ou NULL)
+    struct AreasCompressao* areasThreads;   // Áreas das threads 1 em diante
+    struct SaidaBlocos* saidasGrupos;  // Saída na memória de cada grupo de blocos
+};
+
+// Função para calcular a arena necessária para blocos de até 'n' bytes no
+// nível 'nivel': a divisão em blocos, os planos dos modos avançados com o tANS
+// e a BWT (vetores de sufixos de todos os níveis da recursão do SA-IS, cada um
+// com no máximo metade do anterior) nunca estão reservados ao mesmo tempo.
+static size_t tamanhoArenaCompressao(size_t n, int nivel) {
+    const struct ConfigNivel* config = &configuracoesNivel[nivel];
+    size_t divisao = (n / PEDACO_MINIMO + 1) * (sizeof(struct Segmento) + sizeof(double)) + 64;
+
+    size_t blocos = 0;
+    if (config->passesMultiTabela > 0 && n >= MINIMO_MULTI_TABELA) {
+        blocos += sizeof(struct PlanoMultiTabela) + 16;
+    }
+    if (config->gruposContexto > 0 && n >= MINIMO_ORDEM1) {
+        blocos += 2 * sizeof(struct PlanoOrdem1) + 256 * 256 * sizeof(uint32_t) +
+                  MAXIMO_GRUPOS_CONTEXTO * 256 * (sizeof(double) + sizeof(uint32_t)) + 5 * 16;
+    }
+    if (nivel >= NIVEL_MINIMO_TANS) {
+        blocos += sizeof(struct TabelaCodificacaoTans) + 3 * n + 3 * 16;
+    }
+
+    size_t bwt = 0;
+    if (nivel >= NIVEL_MINIMO_BWT && n >= MINIMO_BWT) {
+        bwt = 46 * n + 16 * 1024;
+    }
+
+    size_t maior = divisao > blocos ? divisao : blocos;
+    return maior > bwt ? maior : bwt;
+}
+
+// Função para alocar as áreas de trabalho para janelas de até 'tamanhoJanela'
+// bytes em níveis até 'nivel'. Retorna 0 ou -1 se faltar memória.
+static int alocarAreasCompressao(struct AreasCompressao* areas, size_t tamanhoJanela, int registro, int nivel) {
+    areas->tamanhoJanela = tamanhoJanela;
+    areas->nivel = nivel;
+    areas->destino = (unsigned char*)malloc(2 * tamanhoJanela + 1024);
+    areas->tamanhos = (size_t*)malloc((tamanhoJanela / PEDACO_MINIMO + 1) * sizeof(size_t));
+    areas->trabalho = (unsigned char*)malloc(4 * (tamanhoJanela + tamanhoJanela / 4 + 16));
+    areas->colunas = registro > 0 ? (unsigned char*)malloc(tamanhoJanela) : NULL;
+    areas->arena.capacidade = tamanhoArenaCompressao(tamanhoJanela, nivel);
+    areas->arena.memoria = (unsigned char*)malloc(areas->arena.capacidade);
+    areas->arena.usado = 0;
+    areas->anterior.valida = 0;
+    areas->preset = NULL;
+    areas->cache = NULL;
+    areas->grupo = NULL;
+    areas->areasThreads = NULL;
+    areas->saidasGrupos = NULL;
+    if (!areas->destino || !areas->tamanhos || !areas->trabalho || (registro > 0 && !areas->colunas) ||
+        !areas->arena.memoria) {
+        free(areas->destino);
+        free(areas->tamanhos);
+        free(areas->trabalho);
+        free(areas->colunas);
+        free(areas->arena.memoria);
+        return -1;
+    }
+    return 0;
+}
+
+// Procedimento para liberar as áreas de trabalho
+static void liberarAreasCompressao(struct AreasCompressao* areas) {
+    free(areas->destino);
+    free(areas->tamanhos);
+    free(areas->trabalho);
+    free(areas->colunas);
+    free(areas->arena.memoria);
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Função para preparar 'numThreads' threads para os blocos das janelas: o grupo,
+// as áreas de cada thread além da primeira e uma saída na memória por grupo de
+// blocos. Retorna 0 ou -1 se faltar memória.
+static int alocarThreadsCompressao(struct AreasCompressao* areas, int numThreads) {
+    areas->grupo = criarGrupoThreads(numThreads);
+    if (!areas->grupo) return -1;
+
+    int threads = areas->grupo->numThreads;
+    size_t capacidade = areas->tamanhoJanela + 64 * (areas->tamanhoJanela / PEDACO_MINIMO + 1);
+    areas->areasThreads = (struct AreasCompressao*)malloc((size_t)threads * sizeof(struct AreasCompressao));
+    areas->saidasGrupos = (struct SaidaBlocos*)calloc((size_t)threads, sizeof(struct SaidaBlocos));
+    int prontas = 0;
+    int ok = areas->areasThreads && areas->saidasGrupos;
+    while (ok && prontas < threads - 1) {
+        ok = alocarAreasCompressao(&areas->areasThreads[prontas], areas->tamanhoJanela, 0, areas->nivel) == 0;
+        if (ok) areas->areasThreads[prontas++].preset = areas->preset;
+    }
+    for (int g = 0; ok && g < threads; g++) {
+        areas->saidasGrupos[g].capacidade = capacidade;
+        ok = (areas->saidasGrupos[g].memoria = (unsigned char*)malloc(capacidade)) != NULL;
+    }
+
+    if (!ok) {
+        for (int t = 0; t < prontas; t++) liberarAreasCompressao(&areas->areasThreads[t]);
+        for (int g = 0; areas->saidasGrupos && g < threads; g++) free(areas->saidasGrupos[g].memoria);
+        free(areas->areasThreads);
+        free(areas->saidasGrupos);
+        liberarGrupoThreads(areas->grupo);
+        areas->grupo = NULL;
+        areas->areasThreads = NULL;
+        areas->saidasGrupos = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Procedimento para liberar as threads preparadas por alocarThreadsCompressao
+static void liberarThreadsCompressao(struct AreasCompressao* areas) {
+    if (!areas->grupo) return;
+    for (int t = 0; t < areas->grupo->numThreads - 1; t++) liberarAreasCompressao(&areas->areasThreads[t]);
+    for (int g = 0; g < areas->grupo->numThreads; g++) free(areas->saidasGrupos[g].memoria);
+    free(areas->areasThreads);
+    free(areas->saidasGrupos);
+    liberarGrupoThreads(areas->grupo);
+    areas->grupo = NULL;
+}
+#endif
+
+// Blocos (ou colunas) de uma janela divididos entre as threads: cada tarefa
+// compacta um grupo de blocos consecutivos com as áreas da sua thread e grava
+// na saída do grupo, juntadas depois na ordem. Cada grupo começa sem tabela
+// para reaproveitar, então o descompactador, que vê os blocos em sequência,
+// nunca recebe um bloco repetido que aponte para a tabela de outro grupo.
+struct JanelaParalela {
+    const unsigned char* dados;        // Blocos em sequência (janela ou colunas)
+    const size_t* tamanhos;
+    size_t primeiros[MAXIMO_THREADS + 1];   // Primeiro bloco de cada grupo
+    int nivel;
+    int filtro;
+    struct AreasCompressao* areas;
+};
+
+// Procedimento (tarefa do grupo de threads) para compactar um grupo de blocos
+static void compactarGrupoBlocos(void* contexto, size_t grupo, int thread) {
+    struct JanelaParalela* j = (struct JanelaParalela*)contexto;
+    struct AreasCompressao* areas = thread == 0 ? j->areas : &j->areas->areasThreads[thread - 1];
+    struct SaidaBlocos* saida = &j->areas->saidasGrupos[grupo];
+    saida->usado = 0;
+    saida->estourou = 0;
+    areas->anterior.valida = 0;
+
+    size_t deslocamento = 0;
+    for (size_t b = 0; b < j->primeiros[grupo]; b++) deslocamento += j->tamanhos[b];
+    for (size_t b = j->primeiros[grupo]; b < j->primeiros[grupo + 1]; b++) {
+        compactarBlocoComEstagios(j->dados + deslocamento, j->tamanhos[b], j->nivel, j->filtro, areas->destino,
+                                  saida, &areas->anterior, areas->trabalho, &areas->arena, areas->preset, NULL);
+        deslocamento += j->tamanhos[b];
+    }
+}
+
+// Procedimento para compactar os 'numBlocos' blocos consecutivos de 'dados'
+// em sequência, na thread que chama
+static void compactarBlocosSequencia(const unsigned char* dados, const size_t tamanhos[], int numBlocos, int nivel,
+                                     int filtro, struct AreasCompressao* areas, struct SaidaBlocos* saida) {
+    size_t deslocamento = 0;
+    for (int b = 0; b < numBlocos; b++) {
+        compactarBlocoComEstagios(dados + deslocamento, tamanhos[b], nivel, filtro, areas->destino, saida,
+                                  &areas->anterior, areas->trabalho, &areas->arena, areas->preset, areas->cache);
+        deslocamento += tamanhos[b];
+    }
+}
+
+// Procedimento para compactar os 'numBlocos' blocos consecutivos de 'dados'.
+// Com threads (e sem cache, que depende da ordem dos blocos) os blocos são
+// repartidos em grupos de tamanho parecido, um por thread. Se a saída de
+// algum grupo estourar, a janela é compactada de novo em sequência.
+static void compactarBlocosJanela(const unsigned char* dados, const size_t tamanhos[], int numBlocos, int nivel,
+                                  int filtro, struct AreasCompressao* areas, struct SaidaBlocos* saida) {
+    int threads = areas->grupo ? areas->grupo->numThreads : 1;
+    if (threads < 2 || numBlocos < 2 || areas->cache) {
+        compactarBlocosSequencia(dados, tamanhos, numBlocos, nivel, filtro, areas, saida);
+        return;
+    }
+
+    struct JanelaParalela j;
+    j.dados = dados;
+    j.tamanhos = tamanhos;
+    j.nivel = nivel;
+    j.filtro = filtro;
+    j.areas = areas;
+
+    size_t total = 0;
+    for (int b = 0; b < numBlocos; b++) total += tamanhos[b];
+    int grupos = numBlocos < threads ? numBlocos : threads;
+    size_t acumulado = 0;
+    int numGrupos = 1;
+    j.primeiros[0] = 0;
+    for (int b = 0; b + 1 < numBlocos && numGrupos < grupos; b++) {
+        acumulado += tamanhos[b];
+        if (acumulado * (size_t)grupos >= total * (size_t)numGrupos) j.primeiros[numGrupos++] = (size_t)b + 1;
+    }
+    j.primeiros[numGrupos] = (size_t)numBlocos;
+
+    executarParalelo(areas->grupo, (size_t)numGrupos, compactarGrupoBlocos, &j);
+    int estourou = 0;
+    for (int g = 0; g < numGrupos; g++) estourou |= areas->saidasGrupos[g].estourou;
+    areas->anterior.valida = 0;
+    if (estourou) {
+        compactarBlocosSequencia(dados, tamanhos, numBlocos, nivel, filtro, areas, saida);
+        return;
+    }
+    for (int g = 0; g < numGrupos; g++) {
+        gravarSaida(saida, areas->saidasGrupos[g].memoria, areas->saidasGrupos[g].usado);
+    }
+}
+
+// Procedimento para gravar uma janela de registros de tamanho fixo como colunas:
+// um bloco BLOCO_COLUNAS com o tamanho do registro e depois um bloco comum por
+// coluna, cada um com a sua tabela e os seus estágios.
+static void compactarJanelaColunas(const unsigned char* janela, size_t n, size_t registro, int nivel, int filtro,
+                                   struct AreasCompressao* areas, struct SaidaBlocos* saida) {
+    unsigned char cabecalho[10];
+    int c = escreverVarint(cabecalho, registro);
+    gravarBloco(saida, BLOCO_COLUNAS, n, cabecalho, (size_t)c);
+
+    separarColunas(janela, n, registro, areas->colunas);
+    int numColunas = 0;
+    for (size_t j = 0; j < registro && j < n; j++) {
+        areas->tamanhos[numColunas++] = (n - j + registro - 1) / registro;
+    }
+    compactarBlocosJanela(areas->colunas, areas->tamanhos, numColunas, nivel, filtro, areas, saida);
+}
+
+// Procedimento para compactar uma janela: divisão em blocos (ou colunas, com
+// 'registro' > 0), escolha dos estágios e gravação de cada bloco
+static void compactarJanela(const unsigned char* janela, size_t n, int nivel, int filtro, int registro,
+                            struct AreasCompressao* areas, struct SaidaBlocos* saida) {
+    if (registro > 0) {
+        compactarJanelaColunas(janela, n, (size_t)registro, nivel, filtro, areas, saida);
+        return;
+    }
+
+    size_t pedaco = configuracoesNivel[nivel].tamanhoPedaco;
+    size_t* tamanhos = areas->tamanhos;
+    int numBlocos = 1;
+    tamanhos[0] = n;
+    if (pedaco > 0) {
+        numBlocos = dividirEmBlocos(janela, n, pedaco, tamanhos, &areas->arena);
+    }
+    if (nivel >= NIVEL_MINIMO_BWT && preferirJanelaInteira(janela, n, tamanhos, numBlocos, nivel, filtro,
+                                                           areas->trabalho, &areas->arena)) {
+        numBlocos = 1;
+        tamanhos[0] = n;
+    }
+
+    compactarBlocosJanela(janela, tamanhos, numBlocos, nivel, filtro, areas, saida);
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Função principal de compactação no formato em blocos. Com 'registro' > 0,
+// cada janela (um número inteiro de registros) é gravada em colunas; com
+// 'preset' e 'cache' (ou NULL), os blocos podem usar a tabela pré-definida e
+// as tabelas do cache. Com 'numThreads' > 1 os blocos de cada janela são
+// divididos entre as threads.
+static int compactarArquivoBlocos(const char* nome_entrada, const char* nome_saida, int nivel, int filtro, int registro,
+                                  const struct huff_preset* preset, struct CacheTabelas* cache, int numThreads) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    unsigned char* janela = (unsigned char*)malloc(TAMANHO_JANELA);
+    struct AreasCompressao areas;
+    if (!janela || alocarAreasCompressao(&areas, TAMANHO_JANELA, registro, nivel) != 0) {
+        printf("Erro na alocação de memória.\n");
+        free(janela);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    areas.preset = preset;
+    areas.cache = cache;
+    if (numThreads > 1 && alocarThreadsCompressao(&areas, numThreads) != 0) {
+        printf("Erro na alocação de memória.\n");
+        free(janela);
+        liberarAreasCompressao(&areas);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    fwrite(MAGICO_BLOCOS, 1, 4, saida);
+    fputc(VERSAO_BLOCOS, saida);
+
+    struct SaidaBlocos destino = {saida, NULL, 0, 0, 0};
+
+    size_t tamanhoLeitura = registro > 0 ? TAMANHO_JANELA - TAMANHO_JANELA % (size_t)registro : TAMANHO_JANELA;
+    size_t lidos;
+    while ((lidos = fread(janela, 1, tamanhoLeitura, entrada)) > 0) {
+        compactarJanela(janela, lidos, nivel, filtro, registro, &areas, &destino);
+    }
+
+    fputc(BLOCO_FIM, saida);
+
+    free(janela);
+    liberarThreadsCompressao(&areas);
+    liberarAreasCompressao(&areas);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return 0;
+}
+#endif
+
+// Estado do descompactador em blocos: buffers para blocos de até 'tamanhoMaximo'
+// bytes, a última tabela Huffman e a janela em colunas sendo montada
+struct EstadoDescompressao {
+    size_t tamanhoMaximo;
+    unsigned char* bloco;
+    unsigned char* original;
+    uint32_t* vetorBwt;
+    unsigned char* colunas;
+    struct ArvoreDecodificacao* arvore;
+    struct ArvoreDecodificacao* arvoresMulti;
+    unsigned char* seletores;    // Um por grupo de TAMANHO_GRUPO símbolos (várias tabelas)
+    const struct huff_preset* const* presets;   // Tabelas pré-definidas carregadas (BLOCO_PRESET)
+    int numPresets;
+    int temTabela;               // Já houve um bloco Huffman cuja árvore pode ser reaproveitada
+    size_t janelaColunas;        // Bytes da janela em colunas ainda sendo montada (0 = nenhuma)
+    size_t registro;
+    size_t acumulado;
+};
+
+// Função para alocar o estado do descompactador. Retorna 0 ou -1 se faltar memória.
+static int alocarEstadoDescompressao(struct EstadoDescompressao* estado, size_t tamanhoMaximo) {
+    estado->tamanhoMaximo = tamanhoMaximo;
+    estado->bloco = (unsigned char*)malloc(tamanhoMaximo + 1);
+    estado->original = (unsigned char*)malloc(tamanhoMaximo + 1);
+    estado->vetorBwt = (uint32_t*)malloc((tamanhoMaximo + 1) * sizeof(uint32_t));
+    estado->colunas = (unsigned char*)malloc(tamanhoMaximo + 1);
+    estado->arvore = (struct ArvoreDecodificacao*)malloc(sizeof(struct ArvoreDecodificacao));
+    estado->arvoresMulti =
+        (struct ArvoreDecodificacao*)malloc(MAXIMO_GRUPOS_CONTEXTO * sizeof(struct ArvoreDecodificacao));
+    estado->seletores = (unsigned char*)malloc(tamanhoMaximo / TAMANHO_GRUPO + 1);
+    estado->presets = NULL;
+    estado->numPresets = 0;
+    estado->temTabela = 0;
+    estado->janelaColunas = 0;
+    estado->registro = 0;
+    estado->acumulado = 0;
+    if (!estado->bloco || !estado->original || !estado->vetorBwt || !estado->colunas || !estado->arvore ||
+        !estado->arvoresMulti || !estado->seletores) {
+        free(estado->bloco);
+        free(estado->original);
+        free(estado->vetorBwt);
+        free(estado->colunas);
+        free(estado->arvore);
+        free(estado->arvoresMulti);
+        free(estado->seletores);
+        return -1;
+    }
+    return 0;
+}
+
+// Procedimento para liberar o estado do descompactador
+static void liberarEstadoDescompressao(struct EstadoDescompressao* estado) {
+    free(estado->bloco);
+    free(estado->original);
+    free(estado->vetorBwt);
+    free(estado->colunas);
+    free(estado->arvore);
+    free(estado->arvoresMulti);
+    free(estado->seletores);
+}
+
+// Função para decodificar um bloco já lido (tipo, tamanho original e dados).
+// Deixa em *resultado / *tamanhoResultado os bytes prontos para a saída (nenhum
+// enquanto uma janela em colunas está sendo montada).
+// Retorna 0 ou -1 se o bloco for inválido.
+static int decodificarBlocoFormato(struct EstadoDescompressao* estado, int tipo, size_t tamanhoOriginal,
+                                   const unsigned char* dados, size_t tamanho, const unsigned char** resultado,
+                                   size_t* tamanhoResultado) {
+    *resultado = NULL;
+    *tamanhoResultado = 0;
+    if (tamanhoOriginal > estado->tamanhoMaximo) return -1;
+
+    // Início de uma janela em colunas: os próximos blocos são acumulados
+    if (tipo == BLOCO_COLUNAS) {
+        uint64_t tamanhoRegistro;
+        if (estado->janelaColunas > 0 || tamanhoOriginal == 0 || lerVarint(dados, tamanho, &tamanhoRegistro) == 0 ||
+            tamanhoRegistro < 2 || tamanhoRegistro > MAXIMO_REGISTRO) {
+            return -1;
+        }
+        estado->janelaColunas = tamanhoOriginal;
+        estado->registro = (size_t)tamanhoRegistro;
+        estado->acumulado = 0;
+        return 0;
+    }
+
+    // Com estágios, os dados começam com o tamanho do bloco transformado
+    // (e com o índice primário, se houver BWT, e o descritor do filtro)
+    int estagios = tipo & ~MASCARA_TIPO;
+    tipo &= MASCARA_TIPO;
+    const unsigned char* corpo = dados;
+    size_t tamanhoBloco = tamanhoOriginal;
+    uint64_t primario = 0;
+    int filtro = 0;
+    if (estagios) {
+        uint64_t transformado;
+        size_t lidos = lerVarint(dados, tamanho, &transformado);
+        size_t lidosPrimario = 0;
+        if (lidos > 0 && (estagios & ESTAGIO_BWT)) {
+            lidosPrimario = lerVarint(dados + lidos, tamanho - lidos, &primario);
+        }
+        size_t cabecalhoEstagios = lidos + lidosPrimario;
+        if (lidos > 0 && (estagios & ESTAGIO_FILTRO) && cabecalhoEstagios < tamanho) {
+            filtro = dados[cabecalhoEstagios++];
+        }
+        if (lidos == 0 || ((estagios & ESTAGIO_BWT) && (lidosPrimario == 0 || !(estagios & ESTAGIO_MTF))) ||
+            ((estagios & ESTAGIO_FILTRO) && !filtroValido(filtro)) ||
+            transformado > estado->tamanhoMaximo || tipo == BLOCO_ARMAZENADO) {
+            return -1;
+        }
+        corpo += cabecalhoEstagios;
+        tamanho -= cabecalhoEstagios;
+        tamanhoBloco = (size_t)transformado;
+    }
+
+    unsigned char* bloco = estado->bloco;
+    int erro = 0;
+    if (tipo == BLOCO_ARMAZENADO && tamanho == tamanhoOriginal) {
+        memcpy(bloco, corpo, tamanho);
+    } else if ((tipo == BLOCO_HUFFMAN || (tipo == BLOCO_HUFFMAN_REPETIDO && estado->temTabela)) &&
+               decodificarBlocoHuffman(corpo, tamanho, bloco, tamanhoBloco, estado->arvore,
+                                       tipo == BLOCO_HUFFMAN_REPETIDO) == 0) {
+        estado->temTabela = 1;
+    } else if (tipo == BLOCO_MULTI_TABELA &&
+               decodificarBlocoMultiTabela(corpo, tamanho, bloco, tamanhoBloco, estado->arvoresMulti,
+                                           estado->seletores) == 0) {
+    } else if (tipo == BLOCO_ORDEM1 &&
+               decodificarBlocoOrdem1(corpo, tamanho, bloco, tamanhoBloco, estado->arvoresMulti) == 0) {
+    } else if (tipo == BLOCO_PRESET &&
+               decodificarBlocoPreset(corpo, tamanho, bloco, tamanhoBloco, estado->presets, estado->numPresets) == 0) {
+    } else if (tipo == BLOCO_TANS && decodificarBlocoTans(corpo, tamanho, bloco, tamanhoBloco) == 0) {
+    } else {
+        erro = 1;
+    }
+
+    // Desfazer os estágios na ordem inversa (MTF, BWT, RLE, filtro), alternando
+    // entre os buffers 'bloco' e 'original'
+    unsigned char* pronto = bloco;
+    unsigned char* livre = estado->original;
+    if (!erro && (estagios & ESTAGIO_MTF)) {
+        desfazerMtf(pronto, tamanhoBloco);
+    }
+    unsigned char* transformado;
+    if (!erro && (estagios & ESTAGIO_BWT)) {
+        erro = desfazerBwt(pronto, tamanhoBloco, (size_t)primario, livre, estado->vetorBwt) != 0;
+        transformado = pronto;
+        pronto = livre;
+        livre = transformado;
+    }
+    if (!erro && (estagios & ESTAGIO_RLE)) {
+        long long n = desfazerRle(pronto, tamanhoBloco, livre, tamanhoOriginal);
+        erro = n != (long long)tamanhoOriginal;
+        transformado = pronto;
+        pronto = livre;
+        livre = transformado;
+    } else if (!erro && tamanhoBloco != tamanhoOriginal) {
+        erro = 1;
+    }
+    if (!erro && (estagios & ESTAGIO_FILTRO)) {
+        desfazerFiltro(pronto, tamanhoOriginal, filtro, livre);
+        pronto = livre;
+    }
+
+    if (erro || (estado->janelaColunas > 0 && tamanhoOriginal > estado->janelaColunas - estado->acumulado)) {
+        return -1;
+    }
+    if (estado->janelaColunas == 0) {
+        *resultado = pronto;
+        *tamanhoResultado = tamanhoOriginal;
+        return 0;
+    }
+
+    memcpy(estado->colunas + estado->acumulado, pronto, tamanhoOriginal);
+    estado->acumulado += tamanhoOriginal;
+    if (estado->acumulado == estado->janelaColunas) {
+        juntarColunas(estado->colunas, estado->janelaColunas, estado->registro, estado->bloco);
+        *resultado = estado->bloco;
+        *tamanhoResultado = estado->janelaColunas;
+        estado->janelaColunas = 0;
+    }
+    return 0;
+}
+
+#ifndef HUFF_BIBLIOTECA
+// Função de descompactação do formato em blocos (um bloco por vez na memória).
+// 'presets' são as tabelas pré-definidas e do cache carregadas (-T / -C).
+static int descompactarArquivoBlocos(FILE* entrada, FILE* saida, const struct huff_preset* const* presets,
+                                     int numPresets) {
+    if (fgetc(entrada) != VERSAO_BLOCOS) {
+        printf("Erro: Versão do formato em blocos não suportada\n");
+        return 1;
+    }
+
+    unsigned char* dados = (unsigned char*)malloc(2 * TAMANHO_JANELA + 1024);
+    struct EstadoDescompressao estado;
+    if (!dados || alocarEstadoDescompressao(&estado, TAMANHO_JANELA) != 0) {
+        printf("Erro na alocação de memória.\n");
+        free(dados);
+        return 1;
+    }
+    estado.presets = presets;
+    estado.numPresets = numPresets;
+
+    int status = 1;
+    while (1) {
+        int tipo = fgetc(entrada);
+        if (tipo == BLOCO_FIM) {
+            if (estado.janelaColunas > 0) {
+                printf("Erro: Dados compactados truncados ou corrompidos\n");
+            } else {
+                status = 0;
+            }
+            break;
+        }
+
+        uint64_t tamanhoOriginal, tamanho;
+        if (tipo == EOF || lerVarintArquivo(entrada, &tamanhoOriginal) != 0 ||
+            lerVarintArquivo(entrada, &tamanho) != 0 ||
+            tamanhoOriginal > TAMANHO_JANELA || tamanho > 2 * TAMANHO_JANELA + 1024 ||
+            fread(dados, 1, (size_t)tamanho, entrada) != tamanho) {
+            printf("Erro: Dados compactados truncados ou corrompidos\n");
+            break;
+        }
+
+        const unsigned char* resultado;
+        size_t tamanhoResultado;
+        if (decodificarBlocoFormato(&estado, tipo, (size_t)tamanhoOriginal, dados, (size_t)tamanho, &resultado,
+                                    &tamanhoResultado) != 0) {
+            if ((tipo & MASCARA_TIPO) == BLOCO_PRESET) {
+                printf("Erro: Bloco inválido ou tabela pré-definida não carregada (informe -T<tabela> ou"
+                       " -C<cache>)\n");
+            } else {
+                printf("Erro: Bloco inválido ou corrompido\n");
+            }
+            break;
+        }
+        if (tamanhoResultado > 0) fwrite(resultado, 1, tamanhoResultado, saida);
+    }
+
+    free(dados);
+    liberarEstadoDescompressao(&estado);
+    return status;
+}
+
+/*
+ ============================================================================
+ PARTE 9: MODO ADAPTATIVO (FGK) PARA FLUXOS AO VIVO
+ ============================================================================
+ Uma passada só, sem histograma prévio e sem árvore no cabeçalho: compressor e
+ descompactador começam com a mesma árvore vazia (só o nó NYT, "ainda não
+ transmitido") e a atualizam do mesmo jeito depois de cada símbolo.
+ Estrutura do arquivo: "HUFA" + versão (1 byte) + bits. Símbolo novo = código
+ do NYT + 9 bits crus; o símbolo FIM_ADAPTATIVO (256) encerra o fluxo.
+*/
+
+#define MAGICO_ADAPTATIVO "HUFA"
+#define VERSAO_ADAPTATIVO 1
+#define SIMBOLOS_ADAPTATIVO 257              // 256 bytes + FIM_ADAPTATIVO
+#define FIM_ADAPTATIVO 256
+#define NOS_ADAPTATIVO (2 * (SIMBOLOS_ADAPTATIVO + 1) - 1)  // folhas + NYT + internos
+#define LIMITE_PESO_ADAPTATIVO (1u << 16)    // Ao atingir, os pesos são divididos por 2
+#define SIMBOLO_NYT (-2)
+
+// Árvore adaptativa em vetores. O índice de cada nó é o seu número na ordem
+// do FGK: pesos não decrescem com o índice, irmãos são vizinhos e a raiz é o
+// último nó.
+struct ArvoreAdaptativa {
+    uint32_t peso[NOS_ADAPTATIVO];
+    int16_t pai[NOS_ADAPTATIVO];
+    int16_t esquerdo[NOS_ADAPTATIVO];        // -1 = folha
+    int16_t direito[NOS_ADAPTATIVO];
+    int16_t simbolo[NOS_ADAPTATIVO];         // -1 = nó interno, SIMBOLO_NYT = NYT
+    int16_t folha[SIMBOLOS_ADAPTATIVO];      // Nó de cada símbolo (-1 = ainda não visto)
+    int nyt;
+    int raiz;
+};
+
+// Procedimento para iniciar a árvore só com o NYT (que também é a raiz)
+static void iniciarArvoreAdaptativa(struct ArvoreAdaptativa* arvore) {
+    for (int i = 0; i < NOS_ADAPTATIVO; i++) {
+        arvore->peso[i] = 0;
+        arvore->pai[i] = -1;
+        arvore->esquerdo[i] = -1;
+        arvore->direito[i] = -1;
+        arvore->simbolo[i] = -1;
+    }
+    for (int s = 0; s < SIMBOLOS_ADAPTATIVO; s++) {
+        arvore->folha[s] = -1;
+    }
+    arvore->raiz = NOS_ADAPTATIVO - 1;
+    arvore->nyt = arvore->raiz;
+    arvore->simbolo[arvore->nyt] = SIMBOLO_NYT;
+}
+
+// Procedimento para acertar os ponteiros que apontam para o conteúdo do nó 'no'
+static void religarNo(struct ArvoreAdaptativa* arvore, int no) {
+    if (arvore->esquerdo[no] >= 0) {
+        arvore->pai[arvore->esquerdo[no]] = (int16_t)no;
+        arvore->pai[arvore->direito[no]] = (int16_t)no;
+    } else if (arvore->simbolo[no] == SIMBOLO_NYT) {
+        arvore->nyt = no;
+    } else {
+        arvore->folha[arvore->simbolo[no]] = (int16_t)no;
+    }
+}
+
+// Procedimento para trocar de lugar as subárvores dos nós 'a' e 'b' (de mesmo
+// peso); cada posição continua com o mesmo pai
+static void trocarNos(struct ArvoreAdaptativa* arvore, int a, int b) {
+    int16_t temp;
+    temp = arvore->esquerdo[a]; arvore->esquerdo[a] = arvore->esquerdo[b]; arvore->esquerdo[b] = temp;
+    temp = arvore->direito[a]; arvore->direito[a] = arvore->direito[b]; arvore->direito[b] = temp;
+    temp = arvore->simbolo[a]; arvore->simbolo[a] = arvore->simbolo[b]; arvore->simbolo[b] = temp;
+    religarNo(arvore, a);
+    religarNo(arvore, b);
+}
+
+// Procedimento para remontar a árvore com os pesos divididos por 2. A montagem
+// com duas filas (folhas ordenadas + nós internos na ordem de criação) numera
+// os nós na ordem em que saem das filas, o que preserva a propriedade dos irmãos.
+static void reconstruirArvoreAdaptativa(struct ArvoreAdaptativa* arvore) {
+    int16_t simbolos[SIMBOLOS_ADAPTATIVO + 1];
+    uint32_t pesos[NOS_ADAPTATIVO];
+    int16_t esquerdo[NOS_ADAPTATIVO], direito[NOS_ADAPTATIVO];
+    int ordem[NOS_ADAPTATIVO];
+    int numFolhas = 0;
+
+    // Folhas (NYT com peso 0 primeiro) em ordem crescente de peso
+    simbolos[numFolhas] = SIMBOLO_NYT;
+    pesos[numFolhas++] = 0;
+    for (int s = 0; s < SIMBOLOS_ADAPTATIVO; s++) {
+        if (arvore->folha[s] >= 0) {
+            uint32_t peso = (arvore->peso[arvore->folha[s]] + 1) / 2;
+            int j = numFolhas++;
+            while (j > 1 && pesos[j - 1] > peso) {
+                pesos[j] = pesos[j - 1];
+                simbolos[j] = simbolos[j - 1];
+                j--;
+            }
+            pesos[j] = peso;
+            simbolos[j] = (int16_t)s;
+        }
+    }
+    for (int i = 0; i < numFolhas; i++) {
+        esquerdo[i] = direito[i] = -1;
+    }
+
+    // Huffman com duas filas; 'ordem' guarda a sequência de saída das filas
+    int totalNos = 2 * numFolhas - 1;
+    int proximaFolha = 0, proximoInterno = numFolhas, criados = numFolhas, numOrdem = 0;
+    while (criados < totalNos) {
+        int filhos[2];
+        for (int k = 0; k < 2; k++) {
+            if (proximaFolha < numFolhas &&
+                (proximoInterno >= criados || pesos[proximaFolha] <= pesos[proximoInterno])) {
+                filhos[k] = proximaFolha++;
+            } else {
+                filhos[k] = proximoInterno++;
+            }
+            ordem[numOrdem++] = filhos[k];
+        }
+        pesos[criados] = pesos[filhos[0]] + pesos[filhos[1]];
+        esquerdo[criados] = (int16_t)filhos[0];
+        direito[criados] = (int16_t)filhos[1];
+        criados++;
+    }
+    ordem[numOrdem++] = totalNos - 1;
+
+    // Número final de cada nó temporário: a raiz fica no último índice
+    int numero[NOS_ADAPTATIVO];
+    int base = NOS_ADAPTATIVO - totalNos;
+    for (int k = 0; k < totalNos; k++) {
+        numero[ordem[k]] = base + k;
+    }
+
+    iniciarArvoreAdaptativa(arvore);
+    for (int t = 0; t < totalNos; t++) {
+        int no = numero[t];
+        arvore->peso[no] = pesos[t];
+        if (t < numFolhas) {
+            arvore->simbolo[no] = simbolos[t];
+        } else {
+            arvore->esquerdo[no] = (int16_t)numero[esquerdo[t]];
+            arvore->direito[no] = (int16_t)numero[direito[t]];
+        }
+    }
+    for (int no = base; no < NOS_ADAPTATIVO; no++) {
+        religarNo(arvore, no);
+    }
+}
+
+// Procedimento de atualização do FGK depois de codificar/decodificar 'simbolo'
+static void atualizarArvoreAdaptativa(struct ArvoreAdaptativa* arvore, int simbolo) {
+    int no = arvore->folha[simbolo];
+
+    if (no < 0) {
+        // Símbolo novo: o NYT vira nó interno com o novo NYT à esquerda e a folha à direita
+        int antigo = arvore->nyt;
+        int novaFolha = antigo - 1;
+        int novoNyt = antigo - 2;
+
+        arvore->esquerdo[antigo] = (int16_t)novoNyt;
+        arvore->direito[antigo] = (int16_t)novaFolha;
+        arvore->simbolo[antigo] = -1;
+
+        arvore->peso[novaFolha] = 0;
+        arvore->pai[novaFolha] = (int16_t)antigo;
+        arvore->simbolo[novaFolha] = (int16_t)simbolo;
+        arvore->folha[simbolo] = (int16_t)novaFolha;
+
+        arvore->peso[novoNyt] = 0;
+        arvore->pai[novoNyt] = (int16_t)antigo;
+        arvore->simbolo[novoNyt] = SIMBOLO_NYT;
+        arvore->nyt = novoNyt;
+
+        no = novaFolha;
+    }
+
+    // Subir até a raiz: cada nó troca de lugar com o líder do seu peso (o de
+    // maior número) antes de ser incrementado
+    while (no != arvore->raiz) {
+        int lider = no;
+        while (lider + 1 < arvore->raiz && arvore->peso[lider + 1] == arvore->peso[no]) {
+            lider++;
+        }
+        if (lider != no && lider != arvore->pai[no]) {
+            trocarNos(arvore, no, lider);
+            no = lider;
+        }
+        arvore->peso[no]++;
+        no = arvore->pai[no];
+    }
+    arvore->peso[arvore->raiz]++;
+
+    if (arvore->peso[arvore->raiz] >= LIMITE_PESO_ADAPTATIVO) {
+        reconstruirArvoreAdaptativa(arvore);
+    }
+}
+
+// Procedimento para codificar um símbolo com a árvore atual e atualizá-la
+static void codificarSimboloAdaptativo(struct ArvoreAdaptativa* arvore, struct EscritorBits* escritor, int simbolo) {
+    unsigned char caminho[NOS_ADAPTATIVO];
+    int tamanho = 0;
+    int novo = arvore->folha[simbolo] < 0;
+    int no = novo ? arvore->nyt : arvore->folha[simbolo];
+
+    // O caminho sai da folha para a raiz, então é gravado ao contrário
+    while (no != arvore->raiz) {
+        int pai = arvore->pai[no];
+        caminho[tamanho++] = arvore->direito[pai] == no;
+        no = pai;
+    }
+    while (tamanho > 0) {
+        int parte = tamanho < 16 ? tamanho : 16;
+        uint32_t bits = 0;
+        for (int i = 0; i < parte; i++) {
+            bits = (bits << 1) | caminho[--tamanho];
+        }
+        escreverBits(escritor, bits, parte);
+    }
+
+    if (novo) {
+        escreverBits(escritor, (uint32_t)simbolo, 9);
+    }
+    atualizarArvoreAdaptativa(arvore, simbolo);
+}
+
+// Função principal do compressor ao vivo: lê byte a byte e, a cada fim de linha,
+// fecha o byte e manda tudo para a saída (latência de uma linha de log, ao custo
+// de até 7 bits de enchimento por linha)
+static int compactarFluxoAdaptativo(const char* nome_entrada, const char* nome_saida) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    struct ArvoreAdaptativa* arvore = (struct ArvoreAdaptativa*)malloc(sizeof(struct ArvoreAdaptativa));
+    unsigned char* buffer = (unsigned char*)malloc(TAMANHO_BUFFER);
+    if (!arvore || !buffer) {
+        printf("Erro na alocação de memória.\n");
+        free(arvore);
+        free(buffer);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    fwrite(MAGICO_ADAPTATIVO, 1, 4, saida);
+    fputc(VERSAO_ADAPTATIVO, saida);
+    fflush(saida);
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, buffer, TAMANHO_BUFFER, saida);
+    iniciarArvoreAdaptativa(arvore);
+
+    int byte;
+    while ((byte = getc(entrada)) != EOF) {
+        codificarSimboloAdaptativo(arvore, &escritor, byte);
+        if (byte == '\n') {
+            descarregarEscritor(&escritor);
+        }
+    }
+
+    codificarSimboloAdaptativo(arvore, &escritor, FIM_ADAPTATIVO);
+    finalizarEscritor(&escritor);
+
+    free(arvore);
+    free(buffer);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return 0;
+}
+
+// Função para ler um bit do arquivo (-1 no fim do arquivo)
+static inline int lerBitArquivo(FILE* arquivo, int* byte, int* restantes) {
+    if (*restantes == 0) {
+        *byte = getc(arquivo);
+        if (*byte == EOF) return -1;
+        *restantes = 8;
+    }
+    (*restantes)--;
+    return (*byte >> *restantes) & 1;
+}
+
+// Função de descompactação do modo adaptativo (o número mágico já foi lido)
+static int descompactarFluxoAdaptativo(FILE* entrada, FILE* saida) {
+    if (getc(entrada) != VERSAO_ADAPTATIVO) {
+        printf("Erro: Versão do formato adaptativo não suportada\n");
+        return 1;
+    }
+
+    struct ArvoreAdaptativa* arvore = (struct ArvoreAdaptativa*)malloc(sizeof(struct ArvoreAdaptativa));
+    if (!arvore) {
+        printf("Erro na alocação de memória.\n");
+        return 1;
+    }
+    iniciarArvoreAdaptativa(arvore);
+
+    int byte = 0, restantes = 0;
+    while (1) {
+        // Descer da raiz até uma folha
+        int no = arvore->raiz;
+        int bit = 0;
+        while (arvore->esquerdo[no] >= 0 && (bit = lerBitArquivo(entrada, &byte, &restantes)) >= 0) {
+            no = bit ? arvore->direito[no] : arvore->esquerdo[no];
+        }
+
+        int simbolo = arvore->simbolo[no];
+        if (bit >= 0 && simbolo == SIMBOLO_NYT) {
+            // Símbolo novo: 9 bits crus, que precisam ser um byte ainda sem folha ou o fim
+            simbolo = 0;
+            for (int i = 0; i < 9 && bit >= 0; i++) {
+                bit = lerBitArquivo(entrada, &byte, &restantes);
+                simbolo = (simbolo << 1) | (bit & 1);
+            }
+            if (simbolo > FIM_ADAPTATIVO || arvore->folha[simbolo] >= 0) {
+                bit = -1;
+            }
+        }
+        if (bit < 0) {
+            printf("Erro: Dados compactados truncados ou corrompidos\n");
+            free(arvore);
+            return 1;
+        }
+        if (simbolo == FIM_ADAPTATIVO) {
+            break;
+        }
+
+        putc(simbolo, saida);
+        if (simbolo == '\n') {
+            // O compressor completou o byte com zeros depois do fim de linha
+            restantes = 0;
+            fflush(saida);
+        }
+        atualizarArvoreAdaptativa(arvore, simbolo);
+    }
+
+    free(arvore);
+    return 0;
+}
+
+/*
+ ============================================================================
+ PARTE 10: MODO SEMIADAPTATIVO (TABELA RECONSTRUÍDA A CADA PERÍODO)
+ ============================================================================
+ Mais barato que o FGK: a tabela fica fixa durante um período de N KiB e, no
+ fim de cada período, compressor e descompactador a reconstroem do mesmo jeito
+ a partir do histograma desse período. Nenhuma tabela vai no arquivo e a
+ decodificação continua usando a tabela de BITS_TABELA bits.
+ Estrutura do arquivo: "HUFP" + versão (1 byte) + varint(período em bytes) +
+ períodos [varint(original) + varint(tamanho) + cabeçalho de 2 bytes com árvore
+ vazia + bits]. Um período com original 0 encerra o fluxo.
+*/
+
+#define MAGICO_PERIODICO "HUFP"
+#define VERSAO_PERIODICO 1
+#define PERIODO_PADRAO_KIB 64
+#define PERIODO_MAXIMO_KIB (TAMANHO_JANELA / 1024)
+
+// Procedimento para montar a tabela do próximo período a partir do histograma do
+// período que terminou. Todo byte ganha peso mínimo 1 para continuar codificável.
+static void reconstruirTabelaPeriodica(const uint32_t histograma[256], struct CodigoHuffman dicionario[256]) {
+    uint64_t contagem[256];
+    int frequencias[256];
+
+    for (int i = 0; i < 256; i++) {
+        contagem[i] = (uint64_t)histograma[i] + 1;
+    }
+    normalizarFrequencias(contagem, frequencias);
+    construirDicionario(frequencias, dicionario);
+}
+
+// Função principal do compressor semiadaptativo. Cada período é gravado e
+// descarregado assim que completa, então funciona sobre fluxos contínuos.
+static int compactarFluxoPeriodico(const char* nome_entrada, const char* nome_saida, int periodoKiB) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    size_t periodo = (size_t)periodoKiB * 1024;
+    unsigned char* dados = (unsigned char*)malloc(periodo);
+    unsigned char* destino = (unsigned char*)malloc(2 * periodo + 1024);
+    if (!dados || !destino) {
+        printf("Erro na alocação de memória.\n");
+        free(dados);
+        free(destino);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    unsigned char cabecalho[4 + 1 + 10];
+    memcpy(cabecalho, MAGICO_PERIODICO, 4);
+    cabecalho[4] = VERSAO_PERIODICO;
+    int n = 5 + escreverVarint(cabecalho + 5, periodo);
+    fwrite(cabecalho, 1, (size_t)n, saida);
+
+    // Primeiro período: histograma vazio = todos os bytes com 8 bits
+    uint32_t histograma[256] = {0};
+    struct CodigoHuffman dicionario[256];
+    reconstruirTabelaPeriodica(histograma, dicionario);
+
+    size_t lidos;
+    while ((lidos = fread(dados, 1, periodo, entrada)) > 0) {
+        size_t tamanho = codificarBlocoHuffman(dados, lidos, dicionario, NULL, 0, destino);
+
+        n = escreverVarint(cabecalho, lidos);
+        n += escreverVarint(cabecalho + n, tamanho);
+        fwrite(cabecalho, 1, (size_t)n, saida);
+        fwrite(destino, 1, tamanho, saida);
+        fflush(saida);
+
+        memset(histograma, 0, sizeof(histograma));
+        for (size_t i = 0; i < lidos; i++) {
+            histograma[dados[i]]++;
+        }
+        reconstruirTabelaPeriodica(histograma, dicionario);
+    }
+
+    fputc(0, saida);
+
+    free(dados);
+    free(destino);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return 0;
+}
+
+// Função de descompactação do modo semiadaptativo (o número mágico já foi lido)
+static int descompactarFluxoPeriodico(FILE* entrada, FILE* saida) {
+    uint64_t periodo;
+    if (fgetc(entrada) != VERSAO_PERIODICO || lerVarintArquivo(entrada, &periodo) != 0 ||
+        periodo == 0 || periodo > TAMANHO_JANELA) {
+        printf("Erro: Versão ou período do formato semiadaptativo não suportado\n");
+        return 1;
+    }
+
+    unsigned char* dados = (unsigned char*)malloc(2 * (size_t)periodo + 1024);
+    unsigned char* bloco = (unsigned char*)malloc((size_t)periodo);
+    struct ArvoreDecodificacao* arvore = (struct ArvoreDecodificacao*)malloc(sizeof(struct ArvoreDecodificacao));
+    if (!dados || !bloco || !arvore) {
+        printf("Erro na alocação de memória.\n");
+        free(dados);
+        free(bloco);
+        free(arvore);
+        return 1;
+    }
+
+    uint32_t histograma[256] = {0};
+    struct CodigoHuffman dicionario[256];
+    reconstruirTabelaPeriodica(histograma, dicionario);
+
+    int status = 1;
+    while (montarDecodificacaoDicionario(dicionario, arvore) == 0) {
+        uint64_t tamanhoOriginal, tamanho;
+        if (lerVarintArquivo(entrada, &tamanhoOriginal) != 0) break;
+        if (tamanhoOriginal == 0) {
+            status = 0;
+            break;
+        }
+        if (tamanhoOriginal > periodo || lerVarintArquivo(entrada, &tamanho) != 0 ||
+            tamanho > 2 * periodo + 1024 || fread(dados, 1, (size_t)tamanho, entrada) != tamanho ||
+            decodificarBlocoHuffman(dados, (size_t)tamanho, bloco, (size_t)tamanhoOriginal, arvore, 1) != 0) {
+            break;
+        }
+        fwrite(bloco, 1, (size_t)tamanhoOriginal, saida);
+        fflush(saida);
+
+        memset(histograma, 0, sizeof(histograma));
+        for (size_t i = 0; i < tamanhoOriginal; i++) {
+            histograma[bloco[i]]++;
+        }
+        reconstruirTabelaPeriodica(histograma, dicionario);
+    }
+    if (status != 0) {
+        printf("Erro: Dados compactados truncados ou corrompidos\n");
+    }
+
+    free(dados);
+    free(bloco);
+    free(arvore);
+    return status;
+}
+
+/*
+ ============================================================================
+ PARTE 11: NÚCLEO PARA ALFABETOS GRANDES (SÍMBOLOS DE 16 BITS, LZ, TOKENS)
+ ============================================================================
+ O caminho de 256 símbolos acima continua como está. Aqui a construção dos
+ tamanhos e dos códigos recebe o número de símbolos em tempo de execução (é
+ feita uma vez por tabela), enquanto os laços quentes de codificação e
+ decodificação são gerados por DEFINIR_ALFABETO para cada alfabeto, com o tipo
+ do símbolo e o tamanho das tabelas fixos em tempo de compilação.
+*/
+
+#define MAXIMO_LIMITE_ALFABETO 24      // Maior 'limite' aceito (cabe no buffer do leitor)
+
+// Par (frequência, símbolo) usado para ordenar as folhas de um alfabeto grande
+struct FrequenciaSimbolo {
+    uint32_t frequencia;
+    int simbolo;
+};
+
+// Função de comparação para o qsort: frequência crescente, depois símbolo
+static int compararFrequenciaSimbolo(const void* a, const void* b) {
+    const struct FrequenciaSimbolo* x = (const struct FrequenciaSimbolo*)a;
+    const struct FrequenciaSimbolo* y = (const struct FrequenciaSimbolo*)b;
+    if (x->frequencia != y->frequencia) return x->frequencia < y->frequencia ? -1 : 1;
+    return x->simbolo - y->simbolo;
+}
+
+// Função para calcular os tamanhos dos códigos de um alfabeto com 'numSimbolos'
+// símbolos, limitados a 'limite' bits. Usa Huffman com duas filas sobre as folhas
+// ordenadas (a lista encadeada da PARTE 1 seria quadrática com 64K símbolos) e
+// corta os códigos longos pela contagem por tamanho, como o zlib.
+// Exige numSimbolos <= 2^limite. Retorna o número de símbolos presentes (-1 se
+// faltar memória).
+static int calcularTamanhosAlfabeto(const uint32_t* frequencias, int numSimbolos, int limite, uint8_t* tamanhos) {
+    memset(tamanhos, 0, (size_t)numSimbolos);
+
+    struct FrequenciaSimbolo* folhas =
+        (struct FrequenciaSimbolo*)malloc((size_t)numSimbolos * sizeof(struct FrequenciaSimbolo));
+    if (!folhas) return -1;
+
+    int presentes = 0;
+    for (int s = 0; s < numSimbolos; s++) {
+        if (frequencias[s] > 0) {
+            folhas[presentes].frequencia = frequencias[s];
+            folhas[presentes].simbolo = s;
+            presentes++;
+        }
+    }
+
+    if (presentes <= 1) {
+        // Árvore de uma folha não gera bits: criar uma folha irmã fictícia
+        if (presentes == 1 && numSimbolos > 1) {
+            tamanhos[folhas[0].simbolo] = 1;
+            tamanhos[(folhas[0].simbolo + 1) % numSimbolos] = 1;
+        }
+        free(folhas);
+        return presentes;
+    }
+
+    qsort(folhas, (size_t)presentes, sizeof(struct FrequenciaSimbolo), compararFrequenciaSimbolo);
+
+    // Huffman com duas filas: folhas em 0..presentes-1, nós internos depois, na
+    // ordem de criação; o pai sempre tem índice maior que os filhos
+    int total = 2 * presentes - 1;
+    uint64_t* peso = (uint64_t*)malloc((size_t)total * sizeof(uint64_t));
+    int* pai = (int*)malloc((size_t)total * sizeof(int));
+    if (!peso || !pai) {
+        free(folhas);
+        free(peso);
+        free(pai);
+        return -1;
+    }
+
+    for (int i = 0; i < presentes; i++) {
+        peso[i] = folhas[i].frequencia;
+    }
+    int proximaFolha = 0, proximoInterno = presentes;
+    for (int novo = presentes; novo < total; novo++) {
+        int filhos[2];
+        for (int k = 0; k < 2; k++) {
+            if (proximaFolha < presentes &&
+                (proximoInterno >= novo || peso[proximaFolha] <= peso[proximoInterno])) {
+                filhos[k] = proximaFolha++;
+            } else {
+                filhos[k] = proximoInterno++;
+            }
+        }
+        peso[novo] = peso[filhos[0]] + peso[filhos[1]];
+        pai[filhos[0]] = pai[filhos[1]] = novo;
+    }
+
+    // Profundidades da raiz para baixo (o vetor de pesos é reaproveitado)
+    int quantidade[MAXIMO_LIMITE_ALFABETO + 1] = {0};
+    peso[total - 1] = 0;
+    for (int i = total - 2; i >= 0; i--) {
+        peso[i] = peso[pai[i]] + 1;
+    }
+    for (int i = 0; i < presentes; i++) {
+        int profundidade = peso[i] > (uint64_t)limite ? limite : (int)peso[i];
+        quantidade[profundidade]++;
+    }
+
+    // O corte em 'limite' faz a árvore transbordar: cada passo desce uma folha
+    // do maior nível abaixo do limite e pendura nela uma folha do limite
+    uint64_t kraft = 0;
+    for (int t = 1; t <= limite; t++) {
+        kraft += (uint64_t)quantidade[t] << (limite - t);
+    }
+    while (kraft > (1ULL << limite)) {
+        int t = limite - 1;
+        while (quantidade[t] == 0) t--;
+        quantidade[t]--;
+        quantidade[t + 1] += 2;
+        quantidade[limite]--;
+        kraft--;
+    }
+
+    // Os símbolos mais frequentes ficam com os códigos mais curtos
+    int t = limite;
+    for (int i = 0; i < presentes; i++) {
+        while (quantidade[t] == 0) t--;
+        tamanhos[folhas[i].simbolo] = (uint8_t)t;
+        quantidade[t]--;
+    }
+
+    free(folhas);
+    free(peso);
+    free(pai);
+    return presentes;
+}
+
+// Procedimento para gerar os códigos canônicos de um alfabeto a partir dos tamanhos
+static void gerarCodigosAlfabeto(const uint8_t* tamanhos, int numSimbolos, struct CodigoHuffman* dicionario) {
+    uint32_t quantidade[MAXIMO_LIMITE_ALFABETO + 1] = {0};
+    uint32_t proximo[MAXIMO_LIMITE_ALFABETO + 1];
+
+    for (int s = 0; s < numSimbolos; s++) {
+        quantidade[tamanhos[s]]++;
+    }
+    quantidade[0] = 0;
+
+    uint32_t codigo = 0;
+    for (int t = 1; t <= MAXIMO_LIMITE_ALFABETO; t++) {
+        codigo = (codigo + quantidade[t - 1]) << 1;
+        proximo[t] = codigo;
+    }
+
+    for (int s = 0; s < numSimbolos; s++) {
+        dicionario[s].tamanho = tamanhos[s];
+        dicionario[s].codigo = tamanhos[s] > 0 ? proximo[tamanhos[s]]++ : 0;
+    }
+}
+
+// Função para gravar os tamanhos de forma compacta: varint(presentes) e, para cada
+// símbolo presente, varint(distância ao anterior) + 1 byte de tamanho. Serve bem
+// para alfabetos esparsos. Retorna os bytes gravados (no máximo 11 * numSimbolos + 10).
+static size_t escreverTamanhosAlfabeto(const uint8_t* tamanhos, int numSimbolos, unsigned char* destino) {
+    int presentes = 0;
+    for (int s = 0; s < numSimbolos; s++) {
+        if (tamanhos[s] > 0) presentes++;
+    }
+
+    size_t n = (size_t)escreverVarint(destino, (uint64_t)presentes);
+    int anterior = -1;
+    for (int s = 0; s < numSimbolos; s++) {
+        if (tamanhos[s] > 0) {
+            n += (size_t)escreverVarint(destino + n, (uint64_t)(s - anterior - 1));
+            destino[n++] = tamanhos[s];
+            anterior = s;
+        }
+    }
+    return n;
+}
+
+// Função inversa de escreverTamanhosAlfabeto. Retorna os bytes lidos (0 se inválido).
+static size_t lerTamanhosAlfabeto(const unsigned char* dados, size_t tamanho, int numSimbolos, int limite,
+                                  uint8_t* tamanhos) {
+    uint64_t presentes, distancia;
+    size_t n = lerVarint(dados, tamanho, &presentes);
+    if (n == 0 || presentes > (uint64_t)numSimbolos) return 0;
+
+    memset(tamanhos, 0, (size_t)numSimbolos);
+    int64_t simbolo = -1;
+    for (uint64_t i = 0; i < presentes; i++) {
+        size_t lidos = lerVarint(dados + n, tamanho - n, &distancia);
+        if (lidos == 0) return 0;
+        n += lidos;
+        simbolo += (int64_t)distancia + 1;
+        if (distancia >= (uint64_t)numSimbolos || simbolo >= numSimbolos || n >= tamanho ||
+            dados[n] == 0 || dados[n] > limite) {
+            return 0;
+        }
+        tamanhos[simbolo] = dados[n++];
+    }
+    return n;
+}
+
+// Gera, para um alfabeto de NUM_SIMBOLOS símbolos do tipo TIPO com códigos de até
+// LIMITE bits (<= MAXIMO_LIMITE_ALFABETO):
+//   codificarSimbolos<NOME>     laço de codificação
+//   struct Decodificador<NOME>  tabela de BITS_TABELA bits + decodificação canônica
+//                               dos códigos longos (sem árvore)
+//   montarDecodificador<NOME>   monta o decodificador a partir dos tamanhos
+//   decodificarSimbolos<NOME>   laço de decodificação
+#define DEFINIR_ALFABETO(NOME, NUM_SIMBOLOS, TIPO, LIMITE)                                          \
+                                                                                                    \
+static inline void codificarSimbolos##NOME(const TIPO* simbolos, size_t n,                          \
+                                           const struct CodigoHuffman* dicionario,                  \
+                                           struct EscritorBits* escritor) {                         \
+    for (size_t i = 0; i < n; i++) {                                                                \
+        const struct CodigoHuffman* c = &dicionario[simbolos[i]];                                   \
+        escreverBits(escritor, c->codigo, c->tamanho);                                              \
+    }                                                                                               \
+}                                                                                                   \
+                                                                                                    \
+struct Decodificador##NOME {                                                                        \
+    uint32_t tabela[1 << BITS_TABELA];  /* simbolo << 8 | tamanho; 0 = código longo */              \
+    uint32_t primeiro[LIMITE + 1];      /* Primeiro código canônico de cada tamanho */              \
+    uint32_t quantidade[LIMITE + 1];                                                                \
+    uint32_t inicio[LIMITE + 1];        /* Posição do primeiro símbolo de cada tamanho */           \
+    TIPO ordenados[NUM_SIMBOLOS];       /* Símbolos na ordem canônica */                            \
+};                                                                                                  \
+                                                                                                    \
+static int montarDecodificador##NOME(const uint8_t* tamanhos, struct Decodificador##NOME* d) {      \
+    uint32_t proximo[LIMITE + 1];                                                                   \
+    memset(d->quantidade, 0, sizeof(d->quantidade));                                                \
+    for (int s = 0; s < (NUM_SIMBOLOS); s++) {                                                      \
+        if (tamanhos[s] > (LIMITE)) return -1;                                                      \
+        d->quantidade[tamanhos[s]]++;                                                               \
+    }                                                                                               \
+    d->quantidade[0] = 0;                                                                           \
+                                                                                                    \
+    /* Códigos canônicos; um código que transborda a árvore é rejeitado */                          \
+    uint32_t codigo = 0, posicao = 0;                                                               \
+    for (int t = 1; t <= (LIMITE); t++) {                                                           \
+        codigo = (codigo + d->quantidade[t - 1]) << 1;                                              \
+        if (codigo + d->quantidade[t] > (1u << t)) return -1;                                       \
+        d->primeiro[t] = codigo;                                                                    \
+        d->inicio[t] = proximo[t] = posicao;                                                        \
+        posicao += d->quantidade[t];                                                                \
+    }                                                                                               \
+    for (int s = 0; s < (NUM_SIMBOLOS); s++) {                                                      \
+        if (tamanhos[s] > 0) d->ordenados[proximo[tamanhos[s]]++] = (TIPO)s;                        \
+    }                                                                                               \
+                                                                                                    \
+    /* Tabela: todas as entradas com o prefixo de um código curto levam ao símbolo */              \
+    memset(d->tabela, 0, sizeof(d->tabela));                                                        \
+    for (int t = 1; t <= (LIMITE) && t <= BITS_TABELA; t++) {                                       \
+        int livres = BITS_TABELA - t;                                                               \
+        for (uint32_t k = 0; k < d->quantidade[t]; k++) {                                           \
+            uint32_t entrada = ((uint32_t)d->ordenados[d->inicio[t] + k] << 8) | (uint32_t)t;       \
+            uint32_t base = (d->primeiro[t] + k) << livres;                                         \
+            for (uint32_t i = 0; i < (1u << livres); i++) {                                         \
+                d->tabela[base + i] = entrada;                                                      \
+            }                                                                                       \
+        }                                                                                           \
+    }                                                                                               \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+/* Decodifica um símbolo; -1 se os bits não formam um código */                                    \
+static inline int decodificarSimbolo##NOME(const struct Decodificador##NOME* d,                    \
+                                           struct LeitorBits* leitor) {                             \
+    if (leitor->bits < 32) recarregarBits(leitor);                                                  \
+                                                                                                    \
+    uint32_t entrada = d->tabela[leitor->buffer >> (64 - BITS_TABELA)];                             \
+    if (entrada != 0) {                                                                             \
+        int tamanho = (int)(entrada & 0xFF);                                                        \
+        leitor->buffer <<= tamanho;                                                                 \
+        leitor->bits -= tamanho;                                                                    \
+        return (int)(entrada >> 8);                                                                 \
+    }                                                                                               \
+                                                                                                    \
+    /* Código longo: procurar o tamanho cujo intervalo canônico contém os bits */                   \
+    for (int t = BITS_TABELA + 1; t <= (LIMITE); t++) {                                             \
+        uint32_t codigo = (uint32_t)(leitor->buffer >> (64 - t));                                   \
+        if (codigo - d->primeiro[t] < d->quantidade[t]) {                                           \
+            leitor->buffer <<= t;                                                                   \
+            leitor->bits -= t;                                                                      \
+            return d->ordenados[d->inicio[t] + codigo - d->primeiro[t]];                            \
+        }                                                                                           \
+    }                                                                                               \
+    return -1;                                                                                      \
+}                                                                                                   \
+                                                                                                    \
+/* Decodifica até 'n' símbolos. Retorna quantos foram decodificados e guarda */                     \
+/* em 'bitsLidos' os bits consumidos desde iniciarLeitor. */                                        \
+static inline size_t decodificarSimbolos##NOME(const struct Decodificador##NOME* d,                 \
+                                               struct LeitorBits* leitor, TIPO* saida, size_t n,    \
+                                               size_t* bitsLidos) {                                 \
+    size_t i = 0;                                                                                   \
+    for (; i < n; i++) {                                                                            \
+        int simbolo = decodificarSimbolo##NOME(d, leitor);                                          \
+        if (simbolo < 0) break;                                                                     \
+        saida[i] = (TIPO)simbolo;                                                                   \
+    }                                                                                               \
+    *bitsLidos = leitor->posicao * 8 - (size_t)leitor->bits;                                        \
+    return i;                                                                                       \
+}
+
+// Alfabeto de palavras de 16 bits (dados tokenizados, amostras de áudio, UTF-16)
+#define SIMBOLOS_PALAVRA 65536
+#define LIMITE_PALAVRA 20
+DEFINIR_ALFABETO(Palavra, SIMBOLOS_PALAVRA, uint16_t, LIMITE_PALAVRA)
+
+/*
+ Formato de palavras: "HUFW" + versão (1 byte) + blocos [varint(palavras) +
+ varint(tamanho) + tamanhos (escreverTamanhosAlfabeto) + bits]. Tamanho 0 marca
+ um bloco armazenado: seguem as palavras cruas (2 bytes cada), usado quando as
+ tabelas e os bits não ficam menores que a entrada. Um bloco com 0 palavras
+ encerra e é seguido de 1 byte (0/1) e do byte final de entradas com tamanho
+ ímpar. As palavras são lidas em little-endian.
+*/
+
+#define MAGICO_PALAVRAS "HUFW"
+#define VERSAO_PALAVRAS 1
+#define PALAVRAS_POR_BLOCO (TAMANHO_JANELA / 2)
+#define TAMANHO_TABELA_PALAVRAS (11 * SIMBOLOS_PALAVRA + 10)
+
+// Função principal de compactação de palavras de 16 bits
+static int compactarArquivoPalavras(const char* nome_entrada, const char* nome_saida) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    unsigned char* bytes = (unsigned char*)malloc(TAMANHO_JANELA);
+    uint16_t* palavras = (uint16_t*)malloc(PALAVRAS_POR_BLOCO * sizeof(uint16_t));
+    uint32_t* frequencias = (uint32_t*)malloc(SIMBOLOS_PALAVRA * sizeof(uint32_t));
+    uint8_t* tamanhos = (uint8_t*)malloc(SIMBOLOS_PALAVRA);
+    struct CodigoHuffman* dicionario =
+        (struct CodigoHuffman*)malloc(SIMBOLOS_PALAVRA * sizeof(struct CodigoHuffman));
+    unsigned char* destino = (unsigned char*)malloc(TAMANHO_TABELA_PALAVRAS + 3 * TAMANHO_JANELA);
+    int status = 0;
+    if (!bytes || !palavras || !frequencias || !tamanhos || !dicionario || !destino) {
+        printf("Erro na alocação de memória.\n");
+        status = 1;
+    } else {
+        fwrite(MAGICO_PALAVRAS, 1, 4, saida);
+        fputc(VERSAO_PALAVRAS, saida);
+    }
+
+    size_t lidos;
+    int sobra = -1;
+    while (status == 0 && (lidos = fread(bytes, 1, TAMANHO_JANELA, entrada)) > 0) {
+        size_t n = lidos / 2;
+        if (lidos % 2) sobra = bytes[lidos - 1];
+
+        memset(frequencias, 0, SIMBOLOS_PALAVRA * sizeof(uint32_t));
+        for (size_t i = 0; i < n; i++) {
+            palavras[i] = (uint16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+            frequencias[palavras[i]]++;
+        }
+        if (n == 0) break;
+
+        if (calcularTamanhosAlfabeto(frequencias, SIMBOLOS_PALAVRA, LIMITE_PALAVRA, tamanhos) < 0) {
+            printf("Erro na alocação de memória.\n");
+            status = 1;
+            break;
+        }
+        gerarCodigosAlfabeto(tamanhos, SIMBOLOS_PALAVRA, dicionario);
+
+        size_t tamanho = escreverTamanhosAlfabeto(tamanhos, SIMBOLOS_PALAVRA, destino);
+        struct EscritorBits escritor;
+        iniciarEscritor(&escritor, destino + tamanho, 3 * TAMANHO_JANELA, NULL);
+        codificarSimbolosPalavra(palavras, n, dicionario, &escritor);
+        finalizarEscritor(&escritor);
+        tamanho += escritor.posicao;
+
+        // Bloco que não compensa: armazenado (tamanho 0 + palavras cruas)
+        unsigned char cabecalho[20];
+        int c = escreverVarint(cabecalho, n);
+        if (tamanho >= 2 * n) {
+            c += escreverVarint(cabecalho + c, 0);
+            fwrite(cabecalho, 1, (size_t)c, saida);
+            fwrite(bytes, 1, 2 * n, saida);
+            continue;
+        }
+        c += escreverVarint(cabecalho + c, tamanho);
+        fwrite(cabecalho, 1, (size_t)c, saida);
+        fwrite(destino, 1, tamanho, saida);
+    }
+
+    if (status == 0) {
+        // Fim: bloco vazio + byte que sobrou de uma entrada de tamanho ímpar
+        fputc(0, saida);
+        fputc(sobra >= 0, saida);
+        if (sobra >= 0) fputc(sobra, saida);
+    }
+
+    free(bytes);
+    free(palavras);
+    free(frequencias);
+    free(tamanhos);
+    free(dicionario);
+    free(destino);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return status;
+}
+
+// Função de descompactação de palavras (o número mágico já foi lido)
+static int descompactarArquivoPalavras(FILE* entrada, FILE* saida) {
+    if (fgetc(entrada) != VERSAO_PALAVRAS) {
+        printf("Erro: Versão do formato de palavras não suportada\n");
+        return 1;
+    }
+
+    unsigned char* dados = (unsigned char*)malloc(TAMANHO_TABELA_PALAVRAS + 3 * TAMANHO_JANELA);
+    uint16_t* palavras = (uint16_t*)malloc(PALAVRAS_POR_BLOCO * sizeof(uint16_t));
+    unsigned char* bytes = (unsigned char*)malloc(TAMANHO_JANELA);
+    uint8_t* tamanhos = (uint8_t*)malloc(SIMBOLOS_PALAVRA);
+    struct DecodificadorPalavra* decodificador =
+        (struct DecodificadorPalavra*)malloc(sizeof(struct DecodificadorPalavra));
+    int status = 1;
+    if (!dados || !palavras || !bytes || !tamanhos || !decodificador) {
+        printf("Erro na alocação de memória.\n");
+        free(dados);
+        free(palavras);
+        free(bytes);
+        free(tamanhos);
+        free(decodificador);
+        return 1;
+    }
+
+    while (1) {
+        uint64_t n, tamanho;
+        if (lerVarintArquivo(entrada, &n) != 0) break;
+        if (n == 0) {
+            int temSobra = fgetc(entrada);
+            int sobra = temSobra == 1 ? fgetc(entrada) : 0;
+            if (temSobra == 0 || (temSobra == 1 && sobra != EOF)) {
+                if (temSobra == 1) fputc(sobra, saida);
+                status = 0;
+            }
+            break;
+        }
+
+        if (n > PALAVRAS_POR_BLOCO || lerVarintArquivo(entrada, &tamanho) != 0 ||
+            tamanho > TAMANHO_TABELA_PALAVRAS + 3 * TAMANHO_JANELA) {
+            break;
+        }
+
+        // Bloco armazenado
+        if (tamanho == 0) {
+            if (fread(bytes, 1, 2 * (size_t)n, entrada) != 2 * n) break;
+            fwrite(bytes, 1, 2 * (size_t)n, saida);
+            continue;
+        }
+        if (fread(dados, 1, (size_t)tamanho, entrada) != tamanho) break;
+
+        size_t usados = lerTamanhosAlfabeto(dados, (size_t)tamanho, SIMBOLOS_PALAVRA, LIMITE_PALAVRA, tamanhos);
+        if (usados == 0 || montarDecodificadorPalavra(tamanhos, decodificador) != 0) break;
+
+        // Os bits precisam acabar no último byte do bloco, completado com zeros
+        struct LeitorBits leitor;
+        size_t bitsBloco = 8 * ((size_t)tamanho - usados);
+        size_t bitsLidos;
+        iniciarLeitor(&leitor, dados + usados, (size_t)tamanho - usados);
+        if (decodificarSimbolosPalavra(decodificador, &leitor, palavras, (size_t)n, &bitsLidos) != n ||
+            bitsLidos > bitsBloco || bitsLidos + 8 <= bitsBloco ||
+            lerBits(&leitor, (int)(bitsBloco - bitsLidos)) != 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            bytes[2 * i] = (unsigned char)palavras[i];
+            bytes[2 * i + 1] = (unsigned char)(palavras[i] >> 8);
+        }
+        fwrite(bytes, 1, 2 * (size_t)n, saida);
+    }
+    if (status != 0) {
+        printf("Erro: Dados compactados truncados ou corrompidos\n");
+    }
+
+    free(dados);
+    free(palavras);
+    free(bytes);
+    free(tamanhos);
+    free(decodificador);
+    return status;
+}
+
+/*
+ ============================================================================
+ PARTE 12: ESTÁGIO LZ77 (CADEIAS DE HASH) COM HUFFMAN NA SAÍDA
+ ============================================================================
+ Os matches são procurados em cadeias de hash (3 bytes) dentro de uma janela
+ configurável; o esforço (tamanho da cadeia, match "bom o suficiente" e busca
+ preguiçosa) vem do nível. Literais/comprimentos e distâncias usam os alfabetos
+ do DEFLATE, com a distância estendida até 1 MiB, codificados pelo núcleo de
+ alfabetos grandes da PARTE 11.
+ Estrutura do arquivo: "HUFZ" + versão (1 byte) + varint(janela) + blocos
+ [tipo + varint(original) + varint(tamanho) + dados] até BLOCO_FIM. Um bloco
+ BLOCO_LZ77 traz os tamanhos dos códigos de literais (286) e de distâncias (40)
+ e os bits, terminados pelo símbolo FIM_BLOCO_LZ. Os matches podem apontar para
+ blocos anteriores.
+*/
+
+#define MAGICO_LZ77 "HUFZ"
+#define VERSAO_LZ77 1
+#define SIMBOLOS_LITERAL 286           // 256 literais + fim de bloco + 29 códigos de comprimento
+#define FIM_BLOCO_LZ 256
+#define SIMBOLOS_DISTANCIA 40          // 30 do DEFLATE (até 32 KiB) + 10 até 1 MiB
+#define LIMITE_LZ 15
+#define COMPRIMENTO_MINIMO 3
+#define COMPRIMENTO_MAXIMO 258
+#define JANELA_PADRAO_KIB 32
+#define JANELA_MAXIMA_KIB 1024
+#define BITS_HASH 15
+
+DEFINIR_ALFABETO(Literal, SIMBOLOS_LITERAL, uint16_t, LIMITE_LZ)
+DEFINIR_ALFABETO(Distancia, SIMBOLOS_DISTANCIA, uint8_t, LIMITE_LZ)
+
+static const uint16_t baseComprimento[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t extraComprimento[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint32_t baseDistancia[SIMBOLOS_DISTANCIA] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    32769, 49153, 65537, 98305, 131073, 196609, 262145, 393217, 524289, 786433
+};
+static const uint8_t extraDistancia[SIMBOLOS_DISTANCIA] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+    9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18
+};
+
+// Saída do LZ77: literal (distancia == 0) ou match (comprimento + distância)
+struct TokenLz {
+    uint32_t distancia;
+    uint16_t valor;              // Byte do literal ou comprimento do match
+};
+
+// Cadeias de hash: 'cabeca' guarda a última posição de cada hash e 'anterior'
+// a posição anterior com o mesmo hash (índice = posição módulo janela)
+struct BuscadorLz {
+    int32_t cabeca[1 << BITS_HASH];
+    int32_t* anterior;
+    size_t janela;               // Potência de 2
+};
+
+// Função para achar o código de comprimento (0..28) de um match
+static int codigoComprimento(int comprimento) {
+    int c = 28;
+    while (baseComprimento[c] > comprimento) c--;
+    return c;
+}
+
+// Função para achar o código de distância (0..39) de um match
+static int codigoDistancia(uint32_t distancia) {
+    int c = SIMBOLOS_DISTANCIA - 1;
+    while (baseDistancia[c] > distancia) c--;
+    return c;
+}
+
+static inline uint32_t hashLz(const unsigned char* p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - BITS_HASH);
+}
+
+// Procedimento para inserir as posições [de, ate) nas cadeias (só as que têm
+// 3 bytes disponíveis antes de 'fim')
+static void inserirPosicoesLz(struct BuscadorLz* buscador, const unsigned char* dados, size_t de, size_t ate,
+                              size_t fim) {
+    for (size_t p = de; p < ate && p + 2 < fim; p++) {
+        uint32_t h = hashLz(dados + p);
+        buscador->anterior[p & (buscador->janela - 1)] = buscador->cabeca[h];
+        buscador->cabeca[h] = (int32_t)p;
+    }
+}
+
+// Função para procurar o maior match para a posição 'pos' (que ainda não foi
+// inserida). Retorna o comprimento (0 se nenhum chega a COMPRIMENTO_MINIMO).
+static int procurarMatchLz(const struct BuscadorLz* buscador, const unsigned char* dados, size_t pos, size_t fim,
+                           int cadeia, int bom, uint32_t* distancia) {
+    if (pos + COMPRIMENTO_MINIMO > fim) return 0;
+
+    int maximo = fim - pos < COMPRIMENTO_MAXIMO ? (int)(fim - pos) : COMPRIMENTO_MAXIMO;
+    int melhor = COMPRIMENTO_MINIMO - 1;
+    const unsigned char* atual = dados + pos;
+    int32_t candidato = buscador->cabeca[hashLz(atual)];
+
+    while (candidato >= 0 && cadeia-- > 0) {
+        size_t d = pos - (size_t)candidato;
+        if (d > buscador->janela) break;
+
+        // Descartar rápido pelo byte que decidiria se o match é melhor
+        const unsigned char* anterior = dados + candidato;
+        if (anterior[melhor] == atual[melhor] && anterior[0] == atual[0]) {
+            int n = 0;
+            while (n < maximo && anterior[n] == atual[n]) n++;
+            if (n > melhor) {
+                melhor = n;
+                *distancia = (uint32_t)d;
+                if (n >= bom || n == maximo) break;
+            }
+        }
+
+        int32_t proximo = buscador->anterior[candidato & (buscador->janela - 1)];
+        if (proximo >= candidato) break;      // Posição já sobrescrita por uma mais nova
+        candidato = proximo;
+    }
+    return melhor >= COMPRIMENTO_MINIMO ? melhor : 0;
+}
+
+// Função para transformar dados[inicio, fim) em tokens (com o histórico antes de
+// 'inicio' disponível para matches). Retorna o número de tokens.
+static size_t gerarTokensLz(struct BuscadorLz* buscador, const unsigned char* dados, size_t inicio, size_t fim,
+                            const struct ConfigNivel* config, struct TokenLz* tokens) {
+    size_t n = 0;
+    size_t pos = inicio;
+    int pendente = 0;                    // Match da posição anterior à espera (busca preguiçosa)
+    int comprimentoPendente = 0;
+    uint32_t distanciaPendente = 0;
+
+    while (pos < fim) {
+        uint32_t distancia = 0;
+        int comprimento = procurarMatchLz(buscador, dados, pos, fim, config->cadeiaLz,
+                                          config->comprimentoBomLz, &distancia);
+        inserirPosicoesLz(buscador, dados, pos, pos + 1, fim);
+
+        if (pendente) {
+            pendente = 0;
+            if (comprimento > comprimentoPendente) {
+                // O match começando aqui é melhor: a posição anterior vira literal
+                tokens[n].distancia = 0;
+                tokens[n++].valor = dados[pos - 1];
+            } else {
+                tokens[n].distancia = distanciaPendente;
+                tokens[n++].valor = (uint16_t)comprimentoPendente;
+                size_t proxima = pos - 1 + (size_t)comprimentoPendente;
+                inserirPosicoesLz(buscador, dados, pos + 1, proxima, fim);
+                pos = proxima;
+                continue;
+            }
+        }
+
+        if (comprimento == 0) {
+            tokens[n].distancia = 0;
+            tokens[n++].valor = dados[pos++];
+        } else if (config->preguicosoLz && comprimento < config->comprimentoBomLz) {
+            pendente = 1;
+            comprimentoPendente = comprimento;
+            distanciaPendente = distancia;
+            pos++;
+        } else {
+            tokens[n].distancia = distancia;
+            tokens[n++].valor = (uint16_t)comprimento;
+            inserirPosicoesLz(buscador, dados, pos + 1, pos + (size_t)comprimento, fim);
+            pos += (size_t)comprimento;
+        }
+    }
+
+    if (pendente) {
+        tokens[n].distancia = distanciaPendente;
+        tokens[n++].valor = (uint16_t)comprimentoPendente;
+    }
+    return n;
+}
+
+// Função para codificar os tokens de um bloco: tabelas de tamanhos + bits.
+// Retorna os bytes gravados em 'destino' (capacidade: 2 * original + 4096).
+static size_t codificarBlocoLz(const struct TokenLz* tokens, size_t numTokens, unsigned char* destino,
+                               size_t capacidade) {
+    uint32_t frequenciasLiteral[SIMBOLOS_LITERAL] = {0};
+    uint32_t frequenciasDistancia[SIMBOLOS_DISTANCIA] = {0};
+    uint8_t tamanhosLiteral[SIMBOLOS_LITERAL];
+    uint8_t tamanhosDistancia[SIMBOLOS_DISTANCIA];
+    struct CodigoHuffman literais[SIMBOLOS_LITERAL];
+    struct CodigoHuffman distancias[SIMBOLOS_DISTANCIA];
+
+    for (size_t i = 0; i < numTokens; i++) {
+        if (tokens[i].distancia == 0) {
+            frequenciasLiteral[tokens[i].valor]++;
+        } else {
+            frequenciasLiteral[257 + codigoComprimento(tokens[i].valor)]++;
+            frequenciasDistancia[codigoDistancia(tokens[i].distancia)]++;
+        }
+    }
+    frequenciasLiteral[FIM_BLOCO_LZ]++;
+
+    if (calcularTamanhosAlfabeto(frequenciasLiteral, SIMBOLOS_LITERAL, LIMITE_LZ, tamanhosLiteral) < 0 ||
+        calcularTamanhosAlfabeto(frequenciasDistancia, SIMBOLOS_DISTANCIA, LIMITE_LZ, tamanhosDistancia) < 0) {
+        return 0;
+    }
+    gerarCodigosAlfabeto(tamanhosLiteral, SIMBOLOS_LITERAL, literais);
+    gerarCodigosAlfabeto(tamanhosDistancia, SIMBOLOS_DISTANCIA, distancias);
+
+    size_t n = escreverTamanhosAlfabeto(tamanhosLiteral, SIMBOLOS_LITERAL, destino);
+    n += escreverTamanhosAlfabeto(tamanhosDistancia, SIMBOLOS_DISTANCIA, destino + n);
+
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, destino + n, capacidade - n, NULL);
+    for (size_t i = 0; i < numTokens; i++) {
+        if (tokens[i].distancia == 0) {
+            escreverBits(&escritor, literais[tokens[i].valor].codigo, literais[tokens[i].valor].tamanho);
+            continue;
+        }
+        int c = codigoComprimento(tokens[i].valor);
+        escreverBits(&escritor, literais[257 + c].codigo, literais[257 + c].tamanho);
+        escreverBits(&escritor, tokens[i].valor - baseComprimento[c], extraComprimento[c]);
+
+        c = codigoDistancia(tokens[i].distancia);
+        escreverBits(&escritor, distancias[c].codigo, distancias[c].tamanho);
+        escreverBits(&escritor, tokens[i].distancia - baseDistancia[c], extraDistancia[c]);
+    }
+    escreverBits(&escritor, literais[FIM_BLOCO_LZ].codigo, literais[FIM_BLOCO_LZ].tamanho);
+    finalizarEscritor(&escritor);
+
+    return n + escritor.posicao;
+}
+
+// Decodificadores das duas tabelas de um bloco LZ77
+struct DecodificadorLz {
+    struct DecodificadorLiteral literais;
+    struct DecodificadorDistancia distancias;
+};
+
+// Função para decodificar um bloco LZ77 em saida[0, tamanhoOriginal); 'saida' é
+// precedida por 'historico' bytes já decodificados. Retorna 0 se ok.
+static int decodificarBlocoLz(const unsigned char* dados, size_t tamanho, unsigned char* saida, size_t tamanhoOriginal,
+                              size_t historico, struct DecodificadorLz* decodificador) {
+    uint8_t tamanhosLiteral[SIMBOLOS_LITERAL];
+    uint8_t tamanhosDistancia[SIMBOLOS_DISTANCIA];
+
+    size_t n = lerTamanhosAlfabeto(dados, tamanho, SIMBOLOS_LITERAL, LIMITE_LZ, tamanhosLiteral);
+    if (n == 0) return -1;
+    size_t m = lerTamanhosAlfabeto(dados + n, tamanho - n, SIMBOLOS_DISTANCIA, LIMITE_LZ, tamanhosDistancia);
+    if (m == 0 || montarDecodificadorLiteral(tamanhosLiteral, &decodificador->literais) != 0 ||
+        montarDecodificadorDistancia(tamanhosDistancia, &decodificador->distancias) != 0) {
+        return -1;
+    }
+    n += m;
+
+    struct LeitorBits leitor;
+    iniciarLeitor(&leitor, dados + n, tamanho - n);
+
+    size_t k = 0;
+    while (1) {
+        int simbolo = decodificarSimboloLiteral(&decodificador->literais, &leitor);
+        if (simbolo < 0) return -1;
+        if (simbolo < 256) {
+            if (k >= tamanhoOriginal) return -1;
+            saida[k++] = (unsigned char)simbolo;
+            continue;
+        }
+        if (simbolo == FIM_BLOCO_LZ) break;
+
+        int c = simbolo - 257;
+        if (c >= 29) return -1;
+        size_t comprimento = baseComprimento[c] + lerBits(&leitor, extraComprimento[c]);
+
+        c = decodificarSimboloDistancia(&decodificador->distancias, &leitor);
+        if (c < 0) return -1;
+        size_t distancia = baseDistancia[c] + lerBits(&leitor, extraDistancia[c]);
+
+        if (distancia > historico + k || comprimento > tamanhoOriginal - k) return -1;
+
+        // Cópia byte a byte: o match pode sobrepor os bytes que ele mesmo gera
+        const unsigned char* origem = saida + k - distancia;
+        for (size_t i = 0; i < comprimento; i++) {
+            saida[k + i] = origem[i];
+        }
+        k += comprimento;
+    }
+
+    return k == tamanhoOriginal ? 0 : -1;
+}
+
+// Função para descartar o histórico antigo: mantém entre 'janela' e 2 * 'janela'
+// bytes, deslocando um múltiplo da janela (assim 'anterior' não precisa ser
+// reindexado). Retorna o deslocamento aplicado.
+static size_t deslizarHistoricoLz(unsigned char* dados, size_t* total, size_t janela) {
+    if (*total <= 2 * janela) return 0;
+
+    size_t deslocamento = (*total - janela) / janela * janela;
+    memmove(dados, dados + deslocamento, *total - deslocamento);
+    *total -= deslocamento;
+    return deslocamento;
+}
+
+// Procedimento para ajustar as posições das cadeias depois de deslizar o histórico
+static void deslocarBuscadorLz(struct BuscadorLz* buscador, size_t deslocamento) {
+    for (int i = 0; i < (1 << BITS_HASH); i++) {
+        buscador->cabeca[i] = buscador->cabeca[i] >= (int32_t)deslocamento ?
+                              buscador->cabeca[i] - (int32_t)deslocamento : -1;
+    }
+    for (size_t i = 0; i < buscador->janela; i++) {
+        buscador->anterior[i] = buscador->anterior[i] >= (int32_t)deslocamento ?
+                                buscador->anterior[i] - (int32_t)deslocamento : -1;
+    }
+}
+
+// Função principal de compactação com LZ77 + Huffman
+static int compactarArquivoLz(const char* nome_entrada, const char* nome_saida, int nivel, int janelaKiB) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    size_t janela = 1;
+    while (janela < (size_t)janelaKiB * 1024) janela <<= 1;
+
+    struct BuscadorLz* buscador = (struct BuscadorLz*)malloc(sizeof(struct BuscadorLz));
+    int32_t* anterior = (int32_t*)malloc(janela * sizeof(int32_t));
+    unsigned char* dados = (unsigned char*)malloc(2 * janela + TAMANHO_JANELA);
+    struct TokenLz* tokens = (struct TokenLz*)malloc(TAMANHO_JANELA * sizeof(struct TokenLz));
+    unsigned char* destino = (unsigned char*)malloc(2 * TAMANHO_JANELA + 4096);
+    if (!buscador || !anterior || !dados || !tokens || !destino) {
+        printf("Erro na alocação de memória.\n");
+        free(buscador);
+        free(anterior);
+        free(dados);
+        free(tokens);
+        free(destino);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    buscador->anterior = anterior;
+    buscador->janela = janela;
+    for (int i = 0; i < (1 << BITS_HASH); i++) buscador->cabeca[i] = -1;
+    for (size_t i = 0; i < janela; i++) anterior[i] = -1;
+
+    unsigned char cabecalho[1 + 2 * 10];
+    fwrite(MAGICO_LZ77, 1, 4, saida);
+    fputc(VERSAO_LZ77, saida);
+    fwrite(cabecalho, 1, (size_t)escreverVarint(cabecalho, janela), saida);
+
+    size_t total = 0;
+    size_t lidos;
+    while ((lidos = fread(dados + total, 1, TAMANHO_JANELA, entrada)) > 0) {
+        size_t numTokens = gerarTokensLz(buscador, dados, total, total + lidos, &configuracoesNivel[nivel], tokens);
+        size_t tamanho = codificarBlocoLz(tokens, numTokens, destino, 2 * TAMANHO_JANELA + 4096);
+
+        if (tamanho > 0 && tamanho < lidos) {
+            escreverBloco(saida, BLOCO_LZ77, lidos, destino, tamanho);
+        } else {
+            escreverBloco(saida, BLOCO_ARMAZENADO, lidos, dados + total, lidos);
+        }
+
+        total += lidos;
+        size_t deslocamento = deslizarHistoricoLz(dados, &total, janela);
+        if (deslocamento > 0) {
+            deslocarBuscadorLz(buscador, deslocamento);
+        }
+    }
+
+    fputc(BLOCO_FIM, saida);
+
+    free(buscador);
+    free(anterior);
+    free(dados);
+    free(tokens);
+    free(destino);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return 0;
+}
+
+// Função de descompactação do formato LZ77 (o número mágico já foi lido)
+static int descompactarArquivoLz(FILE* entrada, FILE* saida) {
+    uint64_t janela;
+    if (fgetc(entrada) != VERSAO_LZ77 || lerVarintArquivo(entrada, &janela) != 0 ||
+        janela == 0 || janela > (uint64_t)JANELA_MAXIMA_KIB * 1024 || (janela & (janela - 1)) != 0) {
+        printf("Erro: Versão ou janela do formato LZ77 não suportada\n");
+        return 1;
+    }
+
+    unsigned char* dados = (unsigned char*)malloc(2 * TAMANHO_JANELA + 4096);
+    unsigned char* historico = (unsigned char*)malloc(2 * (size_t)janela + TAMANHO_JANELA);
+    struct DecodificadorLz* decodificador = (struct DecodificadorLz*)malloc(sizeof(struct DecodificadorLz));
+    if (!dados || !historico || !decodificador) {
+        printf("Erro na alocação de memória.\n");
+        free(dados);
+        free(historico);
+        free(decodificador);
+        return 1;
+    }
+
+    int status = 1;
+    size_t total = 0;
+    while (1) {
+        int tipo = fgetc(entrada);
+        if (tipo == BLOCO_FIM) {
+            status = 0;
+            break;
+        }
+
+        uint64_t tamanhoOriginal, tamanho;
+        if (tipo == EOF || lerVarintArquivo(entrada, &tamanhoOriginal) != 0 ||
+            lerVarintArquivo(entrada, &tamanho) != 0 ||
+            tamanhoOriginal > TAMANHO_JANELA || tamanho > 2 * TAMANHO_JANELA + 4096 ||
+            fread(dados, 1, (size_t)tamanho, entrada) != tamanho) {
+            printf("Erro: Dados compactados truncados ou corrompidos\n");
+            break;
+        }
+
+        if (tipo == BLOCO_ARMAZENADO && tamanho == tamanhoOriginal) {
+            memcpy(historico + total, dados, (size_t)tamanho);
+        } else if (tipo != BLOCO_LZ77 ||
+                   decodificarBlocoLz(dados, (size_t)tamanho, historico + total, (size_t)tamanhoOriginal,
+                                      total, decodificador) != 0) {
+            printf("Erro: Bloco inválido ou corrompido\n");
+            break;
+        }
+
+        fwrite(historico + total, 1, (size_t)tamanhoOriginal, saida);
+        total += (size_t)tamanhoOriginal;
+        deslizarHistoricoLz(historico, &total, (size_t)janela);
+    }
+
+    free(dados);
+    free(historico);
+    free(decodificador);
+    return status;
+}
+
+/*
+ ============================================================================
+ PARTE 13: SAÍDA COMPATÍVEL COM DEFLATE/GZIP (RFC 1951 / RFC 1952)
+ ============================================================================
+ Os tokens da PARTE 12 (janela fixa de 32 KiB) viram blocos DEFLATE com
+ Huffman dinâmico, usando os mesmos códigos canônicos de tamanho limitado (15
+ bits; 7 para o alfabeto dos tamanhos). O resultado abre com gzip/gunzip/zlib.
+ Diferente do resto do programa, o DEFLATE grava os bits do menos significativo
+ para o mais significativo, e os códigos de Huffman entram invertidos.
+*/
+
+#define JANELA_DEFLATE (32 * 1024)
+#define DISTANCIAS_DEFLATE 30
+#define SIMBOLOS_TAMANHOS 19           // Alfabeto dos tamanhos dos códigos (0-15, 16, 17, 18)
+#define LIMITE_TAMANHOS 7
+#define TOKENS_BLOCO_DEFLATE 16384     // Tokens por bloco (cada bloco tem as suas tabelas)
+#define MAXIMO_ARMAZENADO 65535        // Maior bloco armazenado do DEFLATE
+
+// Ordem em que os tamanhos do alfabeto dos tamanhos são gravados
+static const uint8_t ordemTamanhos[SIMBOLOS_TAMANHOS] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Escritor de bits do DEFLATE (bit menos significativo primeiro) em memória
+struct EscritorDeflate {
+    unsigned char* buffer;
+    size_t posicao;
+    uint64_t acumulador;
+    int bitsPendentes;
+};
+
+static inline void escreverBitsDeflate(struct EscritorDeflate* escritor, uint32_t valor, int tamanho) {
+    escritor->acumulador |= (uint64_t)valor << escritor->bitsPendentes;
+    escritor->bitsPendentes += tamanho;
+    while (escritor->bitsPendentes >= 8) {
+        escritor->buffer[escritor->posicao++] = (unsigned char)escritor->acumulador;
+        escritor->acumulador >>= 8;
+        escritor->bitsPendentes -= 8;
+    }
+}
+
+// Procedimento para completar o byte atual com zeros
+static void alinharEscritorDeflate(struct EscritorDeflate* escritor) {
+    if (escritor->bitsPendentes > 0) {
+        escreverBitsDeflate(escritor, 0, 8 - escritor->bitsPendentes);
+    }
+}
+
+// Função para inverter a ordem dos 'tamanho' bits de um código
+static uint32_t inverterBits(uint32_t codigo, int tamanho) {
+    uint32_t invertido = 0;
+    for (int i = 0; i < tamanho; i++) {
+        invertido = (invertido << 1) | ((codigo >> i) & 1);
+    }
+    return invertido;
+}
+
+// Procedimento para inverter os códigos de um dicionário (ordem do DEFLATE)
+static void inverterDicionario(struct CodigoHuffman* dicionario, int numSimbolos) {
+    for (int s = 0; s < numSimbolos; s++) {
+        dicionario[s].codigo = inverterBits(dicionario[s].codigo, dicionario[s].tamanho);
+    }
+}
+
+// Procedimento para montar a tabela do CRC-32 do gzip (polinômio 0xEDB88320)
+static void gerarTabelaCrc32(uint32_t tabela[256]) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        tabela[i] = c;
+    }
+}
+
+static uint32_t atualizarCrc32(uint32_t crc, const uint32_t tabela[256], const unsigned char* dados, size_t n) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc = tabela[(crc ^ dados[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Procedimento para gravar dados[0, n) como blocos armazenados
+static void escreverArmazenadoDeflate(struct EscritorDeflate* escritor, const unsigned char* dados, size_t n) {
+    do {
+        size_t parte = n < MAXIMO_ARMAZENADO ? n : MAXIMO_ARMAZENADO;
+        escreverBitsDeflate(escritor, 0, 3);              // BFINAL = 0, BTYPE = 00
+        alinharEscritorDeflate(escritor);
+        escreverBitsDeflate(escritor, (uint32_t)parte, 16);
+        escreverBitsDeflate(escritor, (uint32_t)parte ^ 0xFFFF, 16);
+        memcpy(escritor->buffer + escritor->posicao, dados, parte);
+        escritor->posicao += parte;
+        dados += parte;
+        n -= parte;
+    } while (n > 0);
+}
+
+// Procedimento para gravar um bloco DEFLATE com os tokens dados, que cobrem
+// 'original' bytes. Usa Huffman dinâmico ou, se ficar maior, blocos armazenados.
+static void codificarBlocoDeflate(const struct TokenLz* tokens, size_t numTokens, const unsigned char* original,
+                                  size_t tamanhoOriginal, struct EscritorDeflate* escritor) {
+    uint32_t frequenciasLiteral[SIMBOLOS_LITERAL] = {0};
+    uint32_t frequenciasDistancia[DISTANCIAS_DEFLATE] = {0};
+    uint8_t tamanhos[SIMBOLOS_LITERAL + DISTANCIAS_DEFLATE];
+    uint8_t* tamanhosDistancia = tamanhos + SIMBOLOS_LITERAL;
+    struct CodigoHuffman literais[SIMBOLOS_LITERAL];
+    struct CodigoHuffman distancias[DISTANCIAS_DEFLATE];
+    long long bitsExtras = 0;
+
+    for (size_t i = 0; i < numTokens; i++) {
+        if (tokens[i].distancia == 0) {
+            frequenciasLiteral[tokens[i].valor]++;
+        } else {
+            int c = codigoComprimento(tokens[i].valor);
+            int d = codigoDistancia(tokens[i].distancia);
+            frequenciasLiteral[257 + c]++;
+            frequenciasDistancia[d]++;
+            bitsExtras += extraComprimento[c] + extraDistancia[d];
+        }
+    }
+    frequenciasLiteral[FIM_BLOCO_LZ]++;
+
+    int distanciasPresentes = calcularTamanhosAlfabeto(frequenciasDistancia, DISTANCIAS_DEFLATE, LIMITE_LZ,
+                                                       tamanhosDistancia);
+    if (calcularTamanhosAlfabeto(frequenciasLiteral, SIMBOLOS_LITERAL, LIMITE_LZ, tamanhos) < 0 ||
+        distanciasPresentes < 0) {
+        escreverArmazenadoDeflate(escritor, original, tamanhoOriginal);
+        return;
+    }
+    if (distanciasPresentes == 0) {
+        // Sem matches o DEFLATE ainda pede ao menos um código de distância
+        tamanhosDistancia[0] = tamanhosDistancia[1] = 1;
+    }
+    gerarCodigosAlfabeto(tamanhos, SIMBOLOS_LITERAL, literais);
+    gerarCodigosAlfabeto(tamanhosDistancia, DISTANCIAS_DEFLATE, distancias);
+
+    int hlit = SIMBOLOS_LITERAL;
+    while (hlit > 257 && tamanhos[hlit - 1] == 0) hlit--;
+    int hdist = DISTANCIAS_DEFLATE;
+    while (hdist > 1 && tamanhosDistancia[hdist - 1] == 0) hdist--;
+
+    // Sequência dos tamanhos (literais seguidos das distâncias) com repetições:
+    // 16 = repete o anterior 3-6x, 17 = 3-10 zeros, 18 = 11-138 zeros
+    uint8_t sequencia[SIMBOLOS_LITERAL + DISTANCIAS_DEFLATE];
+    uint8_t simbolosRle[SIMBOLOS_LITERAL + DISTANCIAS_DEFLATE];
+    uint8_t extrasRle[SIMBOLOS_LITERAL + DISTANCIAS_DEFLATE];
+    int total = 0, numRle = 0;
+    for (int s = 0; s < hlit; s++) sequencia[total++] = tamanhos[s];
+    for (int d = 0; d < hdist; d++) sequencia[total++] = tamanhosDistancia[d];
+
+    for (int i = 0; i < total;) {
+        int valor = sequencia[i];
+        int repeticoes = 1;
+        while (i + repeticoes < total && sequencia[i + repeticoes] == valor) repeticoes++;
+        i += repeticoes;
+
+        if (valor == 0) {
+            while (repeticoes >= 11) {
+                int r = repeticoes < 138 ? repeticoes : 138;
+                simbolosRle[numRle] = 18;
+                extrasRle[numRle++] = (uint8_t)(r - 11);
+                repeticoes -= r;
+            }
+            if (repeticoes >= 3) {
+                simbolosRle[numRle] = 17;
+                extrasRle[numRle++] = (uint8_t)(repeticoes - 3);
+                repeticoes = 0;
+            }
+        } else {
+            simbolosRle[numRle++] = (uint8_t)valor;
+            repeticoes--;
+            while (repeticoes >= 3) {
+                int r = repeticoes < 6 ? repeticoes : 6;
+                simbolosRle[numRle] = 16;
+                extrasRle[numRle++] = (uint8_t)(r - 3);
+                repeticoes -= r;
+            }
+        }
+        while (repeticoes-- > 0) {
+            simbolosRle[numRle++] = (uint8_t)valor;
+        }
+    }
+
+    uint32_t frequenciasTamanhos[SIMBOLOS_TAMANHOS] = {0};
+    uint8_t tamanhosTamanhos[SIMBOLOS_TAMANHOS];
+    struct CodigoHuffman codigosTamanhos[SIMBOLOS_TAMANHOS];
+    for (int i = 0; i < numRle; i++) frequenciasTamanhos[simbolosRle[i]]++;
+    calcularTamanhosAlfabeto(frequenciasTamanhos, SIMBOLOS_TAMANHOS, LIMITE_TAMANHOS, tamanhosTamanhos);
+    gerarCodigosAlfabeto(tamanhosTamanhos, SIMBOLOS_TAMANHOS, codigosTamanhos);
+
+    int hclen = SIMBOLOS_TAMANHOS;
+    while (hclen > 4 && tamanhosTamanhos[ordemTamanhos[hclen - 1]] == 0) hclen--;
+
+    // Custo exato do bloco dinâmico contra o dos blocos armazenados
+    static const uint8_t extraTamanhos[3] = {2, 3, 7};
+    long long bits = 3 + 5 + 5 + 4 + 3LL * hclen + bitsExtras;
+    for (int i = 0; i < numRle; i++) {
+        bits += tamanhosTamanhos[simbolosRle[i]] + (simbolosRle[i] >= 16 ? extraTamanhos[simbolosRle[i] - 16] : 0);
+    }
+    for (int s = 0; s < SIMBOLOS_LITERAL; s++) bits += (long long)frequenciasLiteral[s] * tamanhos[s];
+    for (int d = 0; d < DISTANCIAS_DEFLATE; d++) bits += (long long)frequenciasDistancia[d] * tamanhosDistancia[d];
+
+    long long bitsArmazenado = 8 * ((long long)tamanhoOriginal +
+                                    5 * ((long long)tamanhoOriginal / MAXIMO_ARMAZENADO + 1)) + 7;
+    if (bits >= bitsArmazenado) {
+        escreverArmazenadoDeflate(escritor, original, tamanhoOriginal);
+        return;
+    }
+
+    inverterDicionario(literais, SIMBOLOS_LITERAL);
+    inverterDicionario(distancias, DISTANCIAS_DEFLATE);
+    inverterDicionario(codigosTamanhos, SIMBOLOS_TAMANHOS);
+
+    // Cabeçalho do bloco dinâmico: BFINAL = 0, BTYPE = 10
+    escreverBitsDeflate(escritor, 0, 1);
+    escreverBitsDeflate(escritor, 2, 2);
+    escreverBitsDeflate(escritor, (uint32_t)(hlit - 257), 5);
+    escreverBitsDeflate(escritor, (uint32_t)(hdist - 1), 5);
+    escreverBitsDeflate(escritor, (uint32_t)(hclen - 4), 4);
+    for (int i = 0; i < hclen; i++) {
+        escreverBitsDeflate(escritor, tamanhosTamanhos[ordemTamanhos[i]], 3);
+    }
+    for (int i = 0; i < numRle; i++) {
+        const struct CodigoHuffman* c = &codigosTamanhos[simbolosRle[i]];
+        escreverBitsDeflate(escritor, c->codigo, c->tamanho);
+        if (simbolosRle[i] >= 16) {
+            escreverBitsDeflate(escritor, extrasRle[i], extraTamanhos[simbolosRle[i] - 16]);
+        }
+    }
+
+    // Dados
+    for (size_t i = 0; i < numTokens; i++) {
+        if (tokens[i].distancia == 0) {
+            escreverBitsDeflate(escritor, literais[tokens[i].valor].codigo, literais[tokens[i].valor].tamanho);
+            continue;
+        }
+        int c = codigoComprimento(tokens[i].valor);
+        escreverBitsDeflate(escritor, literais[257 + c].codigo, literais[257 + c].tamanho);
+        escreverBitsDeflate(escritor, tokens[i].valor - baseComprimento[c], extraComprimento[c]);
+
+        c = codigoDistancia(tokens[i].distancia);
+        escreverBitsDeflate(escritor, distancias[c].codigo, distancias[c].tamanho);
+        escreverBitsDeflate(escritor, tokens[i].distancia - baseDistancia[c], extraDistancia[c]);
+    }
+    escreverBitsDeflate(escritor, literais[FIM_BLOCO_LZ].codigo, literais[FIM_BLOCO_LZ].tamanho);
+}
+
+// Função principal de compactação no formato gzip
+static int compactarArquivoGzip(const char* nome_entrada, const char* nome_saida, int nivel) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    struct BuscadorLz* buscador = (struct BuscadorLz*)malloc(sizeof(struct BuscadorLz));
+    int32_t* anterior = (int32_t*)malloc(JANELA_DEFLATE * sizeof(int32_t));
+    unsigned char* dados = (unsigned char*)malloc(2 * JANELA_DEFLATE + TAMANHO_JANELA);
+    struct TokenLz* tokens = (struct TokenLz*)malloc(TAMANHO_JANELA * sizeof(struct TokenLz));
+    unsigned char* destino = (unsigned char*)malloc(2 * TAMANHO_JANELA + 4096);
+    if (!buscador || !anterior || !dados || !tokens || !destino) {
+        printf("Erro na alocação de memória.\n");
+        free(buscador);
+        free(anterior);
+        free(dados);
+        free(tokens);
+        free(destino);
+        fecharArquivo(entrada);
+        fecharArquivo(saida);
+        return 1;
+    }
+
+    buscador->anterior = anterior;
+    buscador->janela = JANELA_DEFLATE;
+    for (int i = 0; i < (1 << BITS_HASH); i++) buscador->cabeca[i] = -1;
+    for (size_t i = 0; i < JANELA_DEFLATE; i++) anterior[i] = -1;
+
+    uint32_t tabelaCrc[256];
+    gerarTabelaCrc32(tabelaCrc);
+    uint32_t crc = 0;
+    uint32_t tamanhoTotal = 0;               // Módulo 2^32, como pede o gzip
+
+    // Cabeçalho gzip: mágico, método 8 (deflate), sem flags nem data, SO desconhecido
+    static const unsigned char cabecalho[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+    fwrite(cabecalho, 1, sizeof(cabecalho), saida);
+
+    struct EscritorDeflate escritor;
+    escritor.buffer = destino;
+    escritor.posicao = 0;
+    escritor.acumulador = 0;
+    escritor.bitsPendentes = 0;
+
+    size_t total = 0;
+    size_t lidos;
+    while ((lidos = fread(dados + total, 1, TAMANHO_JANELA, entrada)) > 0) {
+        crc = atualizarCrc32(crc, tabelaCrc, dados + total, lidos);
+        tamanhoTotal += (uint32_t)lidos;
+
+        size_t numTokens = gerarTokensLz(buscador, dados, total, total + lidos, &configuracoesNivel[nivel], tokens);
+
+        // Um bloco DEFLATE a cada TOKENS_BLOCO_DEFLATE tokens
+        size_t inicio = total;
+        for (size_t t = 0; t < numTokens; t += TOKENS_BLOCO_DEFLATE) {
+            size_t fim = t + TOKENS_BLOCO_DEFLATE < numTokens ? t + TOKENS_BLOCO_DEFLATE : numTokens;
+            size_t cobertos = 0;
+            for (size_t i = t; i < fim; i++) {
+                cobertos += tokens[i].distancia ? tokens[i].valor : 1;
+            }
+            codificarBlocoDeflate(tokens + t, fim - t, dados + inicio, cobertos, &escritor);
+            inicio += cobertos;
+
+            // Os bytes completos vão para o arquivo; os bits do byte atual ficam
+            fwrite(destino, 1, escritor.posicao, saida);
+            escritor.posicao = 0;
+        }
+
+        total += lidos;
+        size_t deslocamento = deslizarHistoricoLz(dados, &total, JANELA_DEFLATE);
+        if (deslocamento > 0) {
+            deslocarBuscadorLz(buscador, deslocamento);
+        }
+    }
+
+    // Último bloco: Huffman fixo só com o fim de bloco (BFINAL = 1, BTYPE = 01, 7 zeros)
+    escreverBitsDeflate(&escritor, 1, 1);
+    escreverBitsDeflate(&escritor, 1, 2);
+    escreverBitsDeflate(&escritor, 0, 7);
+    alinharEscritorDeflate(&escritor);
+    fwrite(destino, 1, escritor.posicao, saida);
+
+    // Rodapé gzip: CRC-32 e tamanho original em little-endian
+    unsigned char rodape[8];
+    for (int i = 0; i < 4; i++) {
+        rodape[i] = (unsigned char)(crc >> (8 * i));
+        rodape[4 + i] = (unsigned char)(tamanhoTotal >> (8 * i));
+    }
+    fwrite(rodape, 1, sizeof(rodape), saida);
+
+    free(buscador);
+    free(anterior);
+    free(dados);
+    free(tokens);
+    free(destino);
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return 0;
+}
+#endif
+
+/*
+ ============================================================================
+ PARTE 14: BIBLIOTECA EM MEMÓRIA (libhuff.h)
+ ============================================================================
+ Mesmo formato em blocos do compactarArquivoBlocos, de buffer para buffer:
+ os blocos são gravados numa SaidaBlocos em memória e lidos direto do buffer
+ de entrada. Nenhuma função desta parte usa stdio ou estado global; as áreas
+ de trabalho ficam nos contextos (huff_cctx / huff_dctx), dimensionadas pela
+ maior entrada já vista (no máximo uma janela).
+*/
+
+// Função para ler o cabeçalho (tipo + dois varints) do bloco em dados[*posicao].
+// Avança *posicao até os dados do bloco. Retorna 0 ou -1 se estiver truncado.
+static int lerCabecalhoBlocoMemoria(const unsigned char* dados, size_t n, size_t* posicao, int* tipo,
+                                    uint64_t* tamanhoOriginal, uint64_t* tamanho) {
+    if (*posicao >= n) return -1;
+    *tipo = dados[(*posicao)++];
+    if (*tipo == BLOCO_FIM) return 0;
+
+    size_t lidos = lerVarint(dados + *posicao, n - *posicao, tamanhoOriginal);
+    if (lidos == 0) return -1;
+    *posicao += lidos;
+    lidos = lerVarint(dados + *posicao, n - *posicao, tamanho);
+    if (lidos == 0) return -1;
+    *posicao += lidos;
+    return *tamanho <= n - *posicao ? 0 : -1;
+}
+
+// Função para percorrer os cabeçalhos dos blocos sem decodificar nada: soma os
+// tamanhos originais em *total e guarda o maior bloco em *maiorBloco.
+// Retorna 0 ou -1 se o buffer não for um "HUFB" completo.
+static int percorrerBlocosMemoria(const unsigned char* dados, size_t n, uint64_t* total, size_t* maiorBloco) {
+    *total = 0;
+    *maiorBloco = 0;
+    if (n < 5 || memcmp(dados, MAGICO_BLOCOS, 4) != 0 || dados[4] != VERSAO_BLOCOS) return -1;
+
+    size_t posicao = 5;
+    while (1) {
+        int tipo;
+        uint64_t tamanhoOriginal, tamanho;
+        if (lerCabecalhoBlocoMemoria(dados, n, &posicao, &tipo, &tamanhoOriginal, &tamanho) != 0) return -1;
+        if (tipo == BLOCO_FIM) return 0;
+        if (tamanhoOriginal > TAMANHO_JANELA) return -1;
+
+        // As colunas de uma janela já somam o tamanho dela
+        if (tipo != BLOCO_COLUNAS) *total += tamanhoOriginal;
+        if (tamanhoOriginal > *maiorBloco) *maiorBloco = (size_t)tamanhoOriginal;
+        posicao += (size_t)tamanho;
+    }
+}
+
+size_t huff_compress_bound(size_t n) {
+    // Pior caso: todos os blocos armazenados, com cabeçalho de bloco e de estágios
+    return n + n / 256 + 64;
+}
+
+// Contexto de compressão: guarda as áreas de trabalho (com a arena) entre as
+// chamadas. Elas só são realocadas quando chega uma entrada maior ou um nível
+// mais alto que os anteriores, então um contexto reaproveitado não aloca nada.
+struct huff_cctx {
+    struct AreasCompressao areas;
+    int temAreas;
+    const struct huff_preset* preset;
+};
+
+#define MAXIMO_PRESETS 16              // Tabelas pré-definidas por contexto de descompressão
+
+// Contexto de descompressão: o estado do descompactador, no mesmo esquema
+struct huff_dctx {
+    struct EstadoDescompressao estado;
+    int temEstado;
+    const struct huff_preset* presets[MAXIMO_PRESETS];
+    int numPresets;
+};
+
+struct huff_cctx* huff_cctx_create(void) {
+    struct huff_cctx* cctx = (struct huff_cctx*)malloc(sizeof(struct huff_cctx));
+    if (cctx) {
+        cctx->temAreas = 0;
+        cctx->preset = NULL;
+    }
+    return cctx;
+}
+
+void huff_cctx_free(struct huff_cctx* cctx) {
+    if (!cctx) return;
+    if (cctx->temAreas) liberarAreasCompressao(&cctx->areas);
+    free(cctx);
+}
+
+struct huff_dctx* huff_dctx_create(void) {
+    struct huff_dctx* dctx = (struct huff_dctx*)malloc(sizeof(struct huff_dctx));
+    if (dctx) {
+        dctx->temEstado = 0;
+        dctx->numPresets = 0;
+    }
+    return dctx;
+}
+
+void huff_dctx_free(struct huff_dctx* dctx) {
+    if (!dctx) return;
+    if (dctx->temEstado) liberarEstadoDescompressao(&dctx->estado);
+    free(dctx);
+}
+
+// Função para deixar o contexto pronto para janelas de até 'tamanhoJanela'
+// bytes no nível 'nivel', esquecendo a chamada anterior. Retorna 0 ou -1.
+static int prepararContextoCompressao(struct huff_cctx* cctx, size_t tamanhoJanela, int nivel) {
+    if (cctx->temAreas && cctx->areas.tamanhoJanela >= tamanhoJanela && cctx->areas.nivel >= nivel) {
+        cctx->areas.arena.usado = 0;
+        cctx->areas.anterior.valida = 0;
+        return 0;
+    }
+
+    // Crescer sem perder o que já era suportado
+    if (cctx->temAreas) {
+        if (cctx->areas.tamanhoJanela > tamanhoJanela) tamanhoJanela = cctx->areas.tamanhoJanela;
+        if (cctx->areas.nivel > nivel) nivel = cctx->areas.nivel;
+        liberarAreasCompressao(&cctx->areas);
+        cctx->temAreas = 0;
+    }
+    if (alocarAreasCompressao(&cctx->areas, tamanhoJanela, 0, nivel) != 0) return -1;
+    cctx->temAreas = 1;
+    return 0;
+}
+
+// Função para deixar o contexto pronto para blocos de até 'tamanhoMaximo' bytes,
+// esquecendo a chamada anterior. Retorna 0 ou -1.
+static int prepararContextoDescompressao(struct huff_dctx* dctx, size_t tamanhoMaximo) {
+    if (dctx->temEstado && dctx->estado.tamanhoMaximo >= tamanhoMaximo) {
+        dctx->estado.temTabela = 0;
+        dctx->estado.janelaColunas = 0;
+        dctx->estado.acumulado = 0;
+        return 0;
+    }
+
+    if (dctx->temEstado) {
+        liberarEstadoDescompressao(&dctx->estado);
+        dctx->temEstado = 0;
+    }
+    if (alocarEstadoDescompressao(&dctx->estado, tamanhoMaximo) != 0) return -1;
+    dctx->temEstado = 1;
+    return 0;
+}
+
+long long huff_compress_cctx(struct huff_cctx* cctx, const void* src, size_t n, void* dst, size_t cap, int level) {
+    if (!cctx || (!src && n > 0) || (!dst && cap > 0) || level < HUFF_NIVEL_MINIMO || level > HUFF_NIVEL_MAXIMO) {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    if (prepararContextoCompressao(cctx, n < TAMANHO_JANELA ? n : TAMANHO_JANELA, level) != 0) {
+        return HUFF_ERRO_MEMORIA;
+    }
+    cctx->areas.preset = cctx->preset;
+
+    struct SaidaBlocos saida = {NULL, (unsigned char*)dst, cap, 0, 0};
+    unsigned char cabecalho[5];
+    memcpy(cabecalho, MAGICO_BLOCOS, 4);
+    cabecalho[4] = VERSAO_BLOCOS;
+    gravarSaida(&saida, cabecalho, sizeof(cabecalho));
+
+    const unsigned char* dados = (const unsigned char*)src;
+    for (size_t inicio = 0; inicio < n && !saida.estourou; inicio += TAMANHO_JANELA) {
+        size_t tamanho = n - inicio < TAMANHO_JANELA ? n - inicio : TAMANHO_JANELA;
+        compactarJanela(dados + inicio, tamanho, level, FILTRO_AUTOMATICO, 0, &cctx->areas, &saida);
+    }
+
+    unsigned char fim = BLOCO_FIM;
+    gravarSaida(&saida, &fim, 1);
+    return saida.estourou ? HUFF_ERRO_DESTINO_PEQUENO : (long long)saida.usado;
+}
+
+long long huff_compress_level(const void* src, size_t n, void* dst, size_t cap, int level) {
+    struct huff_cctx* cctx = huff_cctx_create();
+    if (!cctx) return HUFF_ERRO_MEMORIA;
+
+    long long resultado = huff_compress_cctx(cctx, src, n, dst, cap, level);
+    huff_cctx_free(cctx);
+    return resultado;
+}
+
+long long huff_compress(const void* src, size_t n, void* dst, size_t cap) {
+    return huff_compress_level(src, n, dst, cap, HUFF_NIVEL_PADRAO);
+}
+
+long long huff_decompressed_size(const void* src, size_t n) {
+    if (!src && n > 0) return HUFF_ERRO_PARAMETRO;
+
+    uint64_t total;
+    size_t maiorBloco;
+    if (percorrerBlocosMemoria((const unsigned char*)src, n, &total, &maiorBloco) != 0) {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    return (long long)total;
+}
+
+long long huff_decompress_dctx(struct huff_dctx* dctx, const void* src, size_t n, void* dst, size_t cap) {
+    if (!dctx || (!src && n > 0) || (!dst && cap > 0)) return HUFF_ERRO_PARAMETRO;
+
+    const unsigned char* dados = (const unsigned char*)src;
+    uint64_t total;
+    size_t maiorBloco;
+    if (percorrerBlocosMemoria(dados, n, &total, &maiorBloco) != 0) return HUFF_ERRO_DADOS_INVALIDOS;
+    if (total > cap) return HUFF_ERRO_DESTINO_PEQUENO;
+    if (prepararContextoDescompressao(dctx, maiorBloco) != 0) return HUFF_ERRO_MEMORIA;
+
+    struct EstadoDescompressao* estado = &dctx->estado;
+    estado->presets = dctx->presets;
+    estado->numPresets = dctx->numPresets;
+    unsigned char* saida = (unsigned char*)dst;
+    size_t usado = 0;
+    size_t posicao = 5;
+    while (1) {
+        int tipo;
+        uint64_t tamanhoOriginal, tamanho;
+        if (lerCabecalhoBlocoMemoria(dados, n, &posicao, &tipo, &tamanhoOriginal, &tamanho) != 0) break;
+        if (tipo == BLOCO_FIM) {
+            return estado->janelaColunas == 0 ? (long long)usado : HUFF_ERRO_DADOS_INVALIDOS;
+        }
+
+        const unsigned char* resultado;
+        size_t tamanhoResultado;
+        if (decodificarBlocoFormato(estado, tipo, (size_t)tamanhoOriginal, dados + posicao, (size_t)tamanho,
+                                    &resultado, &tamanhoResultado) != 0 ||
+            tamanhoResultado > cap - usado) {
+            break;
+        }
+        if (tamanhoResultado > 0) memcpy(saida + usado, resultado, tamanhoResultado);
+        usado += tamanhoResultado;
+        posicao += (size_t)tamanho;
+    }
+    return HUFF_ERRO_DADOS_INVALIDOS;
+}
+
+long long huff_decompress(const void* src, size_t n, void* dst, size_t cap) {
+    struct huff_dctx* dctx = huff_dctx_create();
+    if (!dctx) return HUFF_ERRO_MEMORIA;
+
+    long long resultado = huff_decompress_dctx(dctx, src, n, dst, cap);
+    huff_dctx_free(dctx);
+    return resultado;
+}
+
+// Tabelas pré-definidas gravadas em arquivo: "HUFT" + versão (1 byte) +
+// ID (varint) + tamanho do código de cada um dos 256 bytes. Os códigos são os
+// canônicos desses tamanhos, então compressor e descompactador chegam à mesma tabela.
+#define MAGICO_PRESET "HUFT"
+#define VERSAO_PRESET 1
+
+struct huff_preset* huff_preset_train(const void* const* samples, const size_t* sizes, size_t count,
+                                      unsigned int id) {
+    if (count > 0 && (!samples || !sizes)) return NULL;
+
+    uint64_t contagem[256] = {0};
+    for (size_t s = 0; s < count; s++) {
+        const unsigned char* dados = (const unsigned char*)samples[s];
+        if (!dados && sizes[s] > 0) return NULL;
+        for (size_t i = 0; i < sizes[s]; i++) contagem[dados[i]]++;
+    }
+
+    struct huff_preset* preset = (struct huff_preset*)malloc(sizeof(struct huff_preset));
+    if (preset && montarPreset(preset, contagem, (uint32_t)id) != 0) {
+        free(preset);
+        preset = NULL;
+    }
+    return preset;
+}
+
+long long huff_preset_save(const struct huff_preset* preset, void* dst, size_t cap) {
+    if (!preset || (!dst && cap > 0)) return HUFF_ERRO_PARAMETRO;
+
+    unsigned char cabecalho[5 + 10];
+    memcpy(cabecalho, MAGICO_PRESET, 4);
+    cabecalho[4] = VERSAO_PRESET;
+    size_t tamanho = 5 + (size_t)escreverVarint(cabecalho + 5, preset->id);
+    if (tamanho + 256 > cap) return HUFF_ERRO_DESTINO_PEQUENO;
+
+    memcpy(dst, cabecalho, tamanho);
+    memcpy((unsigned char*)dst + tamanho, preset->tamanhos, 256);
+    return (long long)(tamanho + 256);
+}
+
+struct huff_preset* huff_preset_load(const void* src, size_t n) {
+    const unsigned char* dados = (const unsigned char*)src;
+    if (!src || n < 6 || memcmp(dados, MAGICO_PRESET, 4) != 0 || dados[4] != VERSAO_PRESET) return NULL;
+
+    uint64_t id;
+    size_t lidos = lerVarint(dados + 5, n - 5, &id);
+    if (lidos == 0 || id > 0xFFFFFFFFu || 5 + lidos + 256 != n) return NULL;
+
+    struct huff_preset* preset = (struct huff_preset*)malloc(sizeof(struct huff_preset));
+    if (preset && montarPresetTamanhos(preset, dados + 5 + lidos, (uint32_t)id) != 0) {
+        free(preset);
+        preset = NULL;
+    }
+    return preset;
+}
+
+unsigned int huff_preset_id(const struct huff_preset* preset) {
+    return preset ? preset->id : 0;
+}
+
+void huff_preset_free(struct huff_preset* preset) {
+    free(preset);
+}
+
+void huff_cctx_use_preset(struct huff_cctx* cctx, const struct huff_preset* preset) {
+    if (cctx) cctx->preset = preset;
+}
+
+int huff_dctx_add_preset(struct huff_dctx* dctx, const struct huff_preset* preset) {
+    if (!dctx || !preset) return HUFF_ERRO_PARAMETRO;
+
+    // Uma tabela com o mesmo ID substitui a anterior
+    for (int i = 0; i < dctx->numPresets; i++) {
+        if (dctx->presets[i]->id == preset->id) {
+            dctx->presets[i] = preset;
+            return 0;
+        }
+    }
+    if (dctx->numPresets == MAXIMO_PRESETS) return HUFF_ERRO_PARAMETRO;
+    dctx->presets[dctx->numPresets++] = preset;
+    return 0;
+}
+
+// Compressor em fluxo: a entrada é juntada numa janela, compactada quando ela
+// enche e a saída da janela fica em 'pendente' até o chamador recolhê-la. Só
+// uma janela e a saída dela ficam na memória, qualquer que seja o fluxo.
+struct huff_cstream {
+    int nivel;
+    size_t tamanhoJanela;
+    unsigned char* janela;
+    size_t naJanela;
+    unsigned char* pendente;           // huff_compress_bound(tamanhoJanela) bytes
+    size_t tamanhoPendente;
+    size_t entregue;                   // Bytes de 'pendente' já copiados para o chamador
+    int terminado;                     // BLOCO_FIM já está em 'pendente'
+    int falhou;                        // Uma janela não coube em 'pendente'; só reset volta
+    struct AreasCompressao areas;
+};
+
+struct huff_cstream* huff_cstream_create(int level, size_t windowSize) {
+    if (level < HUFF_NIVEL_MINIMO || level > HUFF_NIVEL_MAXIMO || windowSize > TAMANHO_JANELA) return NULL;
+    if (windowSize == 0) windowSize = TAMANHO_JANELA;
+
+    struct huff_cstream* fluxo = (struct huff_cstream*)malloc(sizeof(struct huff_cstream));
+    if (!fluxo) return NULL;
+    fluxo->nivel = level;
+    fluxo->tamanhoJanela = windowSize;
+    fluxo->janela = (unsigned char*)malloc(windowSize);
+    fluxo->pendente = (unsigned char*)malloc(huff_compress_bound(windowSize));
+    if (!fluxo->janela || !fluxo->pendente || alocarAreasCompressao(&fluxo->areas, windowSize, 0, level) != 0) {
+        free(fluxo->janela);
+        free(fluxo->pendente);
+        free(fluxo);
+        return NULL;
+    }
+    huff_cstream_reset(fluxo);
+    return fluxo;
+}
+
+void huff_cstream_reset(struct huff_cstream* fluxo) {
+    // O fluxo novo começa pelo cabeçalho do formato em blocos
+    memcpy(fluxo->pendente, MAGICO_BLOCOS, 4);
+    fluxo->pendente[4] = VERSAO_BLOCOS;
+    fluxo->tamanhoPendente = 5;
+    fluxo->entregue = 0;
+    fluxo->naJanela = 0;
+    fluxo->terminado = 0;
+    fluxo->falhou = 0;
+    fluxo->areas.anterior.valida = 0;
+}
+
+void huff_cstream_free(struct huff_cstream* fluxo) {
+    if (!fluxo) return;
+    liberarAreasCompressao(&fluxo->areas);
+    free(fluxo->janela);
+    free(fluxo->pendente);
+    free(fluxo);
+}
+
+// Função para copiar para 'destino' o que couber da saída pendente.
+// Retorna os bytes copiados.
+static size_t entregarPendente(struct huff_cstream* fluxo, unsigned char* destino, size_t capacidade) {
+    size_t quantos = fluxo->tamanhoPendente - fluxo->entregue;
+    if (quantos > capacidade) quantos = capacidade;
+    if (quantos > 0) memcpy(destino, fluxo->pendente + fluxo->entregue, quantos);
+    fluxo->entregue += quantos;
+    return quantos;
+}
+
+// Função para compactar a janela acumulada (a saída anterior já foi entregue).
+// Se os blocos não couberem em 'pendente' o fluxo falha, em vez de perder
+// blocos. Retorna 0 ou HUFF_ERRO_DESTINO_PEQUENO.
+static int compactarJanelaFluxo(struct huff_cstream* fluxo) {
+    struct SaidaBlocos saida = {NULL, fluxo->pendente, huff_compress_bound(fluxo->tamanhoJanela), 0, 0};
+    compactarJanela(fluxo->janela, fluxo->naJanela, fluxo->nivel, FILTRO_AUTOMATICO, 0, &fluxo->areas, &saida);
+    fluxo->tamanhoPendente = saida.estourou ? 0 : saida.usado;
+    fluxo->entregue = 0;
+    fluxo->naJanela = 0;
+    fluxo->falhou = saida.estourou;
+    return saida.estourou ? HUFF_ERRO_DESTINO_PEQUENO : 0;
+}
+
+long long huff_compress_update(struct huff_cstream* fluxo, const void* src, size_t n, size_t* consumed, void* dst,
+                               size_t cap) {
+    if (consumed) *consumed = 0;
+    if (!fluxo || !consumed || (!src && n > 0) || (!dst && cap > 0) || fluxo->terminado) {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    if (fluxo->falhou) return HUFF_ERRO_DESTINO_PEQUENO;
+
+    const unsigned char* entrada = (const unsigned char*)src;
+    unsigned char* saida = (unsigned char*)dst;
+    size_t escritos = 0;
+    while (1) {
+        escritos += entregarPendente(fluxo, saida + escritos, cap - escritos);
+        int livre = fluxo->entregue == fluxo->tamanhoPendente;
+
+        if (livre && fluxo->naJanela == fluxo->tamanhoJanela) {
+            if (compactarJanelaFluxo(fluxo) != 0) return HUFF_ERRO_DESTINO_PEQUENO;
+        } else if (fluxo->naJanela < fluxo->tamanhoJanela && *consumed < n) {
+            size_t quantos = fluxo->tamanhoJanela - fluxo->naJanela;
+            if (quantos > n - *consumed) quantos = n - *consumed;
+            memcpy(fluxo->janela + fluxo->naJanela, entrada + *consumed, quantos);
+            fluxo->naJanela += quantos;
+            *consumed += quantos;
+        } else {
+            break;
+        }
+    }
+    return (long long)escritos;
+}
+
+long long huff_compress_end(struct huff_cstream* fluxo, void* dst, size_t cap) {
+    if (!fluxo || (!dst && cap > 0)) return HUFF_ERRO_PARAMETRO;
+    if (fluxo->falhou) return HUFF_ERRO_DESTINO_PEQUENO;
+
+    unsigned char* saida = (unsigned char*)dst;
+    size_t escritos = 0;
+    while (1) {
+        escritos += entregarPendente(fluxo, saida + escritos, cap - escritos);
+        if (fluxo->entregue < fluxo->tamanhoPendente) break;
+
+        if (fluxo->naJanela > 0) {
+            if (compactarJanelaFluxo(fluxo) != 0) return HUFF_ERRO_DESTINO_PEQUENO;
+        } else if (!fluxo->terminado) {
+            fluxo->pendente[0] = BLOCO_FIM;
+            fluxo->tamanhoPendente = 1;
+            fluxo->entregue = 0;
+            fluxo->terminado = 1;
+        } else {
+            break;
+        }
+    }
+    return (long long)escritos;
+}
+
+// Descompactador em fluxo: puxa os dados compactados pela função 'ler' do
+// chamador, um bloco de cada vez, e entrega os bytes do bloco decodificado
+// conforme são pedidos. A memória é a de um bloco, qualquer que seja o fluxo.
+struct huff_dstream {
+    long long (*ler)(void* usuario, void* buffer, size_t capacidade);
+    void* usuario;
+    int etapa;                         // ETAPA_FLUXO_*
+    unsigned char* dados;              // Dados do bloco atual
+    const unsigned char* pendente;     // Bytes decodificados ainda não entregues
+    size_t tamanhoPendente;
+    struct EstadoDescompressao estado;
+};
+
+#define ETAPA_FLUXO_CABECALHO 0        // Falta ler o cabeçalho "HUFB"
+#define ETAPA_FLUXO_BLOCOS 1
+#define ETAPA_FLUXO_FIM 2
+#define ETAPA_FLUXO_ERRO 3
+
+struct huff_dstream* huff_dstream_create(long long (*read)(void* user, void* buf, size_t cap), void* user) {
+    if (!read) return NULL;
+
+    struct huff_dstream* fluxo = (struct huff_dstream*)malloc(sizeof(struct huff_dstream));
+    if (!fluxo) return NULL;
+    fluxo->ler = read;
+    fluxo->usuario = user;
+    fluxo->etapa = ETAPA_FLUXO_CABECALHO;
+    fluxo->pendente = NULL;
+    fluxo->tamanhoPendente = 0;
+    fluxo->dados = (unsigned char*)malloc(2 * TAMANHO_JANELA + 1024);
+    if (!fluxo->dados || alocarEstadoDescompressao(&fluxo->estado, TAMANHO_JANELA) != 0) {
+        free(fluxo->dados);
+        free(fluxo);
+        return NULL;
+    }
+    return fluxo;
+}
+
+void huff_dstream_free(struct huff_dstream* fluxo) {
+    if (!fluxo) return;
+    liberarEstadoDescompressao(&fluxo->estado);
+    free(fluxo->dados);
+    free(fluxo);
+}
+
+// Função para puxar exatamente 'tamanho' bytes da função de leitura.
+// Retorna 0 ou -1 se o fluxo acabar antes (ou a leitura falhar).
+static int puxarExato(struct huff_dstream* fluxo, unsigned char* destino, size_t tamanho) {
+    size_t lidos = 0;
+    while (lidos < tamanho) {
+        long long r = fluxo->ler(fluxo->usuario, destino + lidos, tamanho - lidos);
+        if (r <= 0 || (size_t)r > tamanho - lidos) return -1;
+        lidos += (size_t)r;
+    }
+    return 0;
+}
+
+// Função para puxar um varint, byte a byte. Retorna 0 ou -1 se inválido.
+static int puxarVarint(struct huff_dstream* fluxo, uint64_t* valor) {
+    *valor = 0;
+    for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+        unsigned char byte;
+        if (puxarExato(fluxo, &byte, 1) != 0) return -1;
+        *valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80)) return 0;
+    }
+    return -1;
+}
+
+// Função para puxar e decodificar o próximo bloco, deixando a saída dele em
+// 'pendente'. Retorna 0 ou -1 se o fluxo for inválido.
+static int puxarBloco(struct huff_dstream* fluxo) {
+    unsigned char tipo;
+    if (puxarExato(fluxo, &tipo, 1) != 0) return -1;
+    if (tipo == BLOCO_FIM) {
+        if (fluxo->estado.janelaColunas > 0) return -1;
+        fluxo->etapa = ETAPA_FLUXO_FIM;
+        return 0;
+    }
+
+    uint64_t tamanhoOriginal, tamanho;
+    if (puxarVarint(fluxo, &tamanhoOriginal) != 0 || puxarVarint(fluxo, &tamanho) != 0 ||
+        tamanhoOriginal > TAMANHO_JANELA || tamanho > 2 * TAMANHO_JANELA + 1024 ||
+        puxarExato(fluxo, fluxo->dados, (size_t)tamanho) != 0) {
+        return -1;
+    }
+    return decodificarBlocoFormato(&fluxo->estado, tipo, (size_t)tamanhoOriginal, fluxo->dados, (size_t)tamanho,
+                                   &fluxo->pendente, &fluxo->tamanhoPendente);
+}
+
+long long huff_decompress_read(struct huff_dstream* fluxo, void* dst, size_t cap) {
+    if (!fluxo || (!dst && cap > 0)) return HUFF_ERRO_PARAMETRO;
+    if (fluxo->etapa == ETAPA_FLUXO_ERRO) return HUFF_ERRO_DADOS_INVALIDOS;
+
+    if (fluxo->etapa == ETAPA_FLUXO_CABECALHO) {
+        unsigned char cabecalho[5];
+        if (puxarExato(fluxo, cabecalho, 5) != 0 || memcmp(cabecalho, MAGICO_BLOCOS, 4) != 0 ||
+            cabecalho[4] != VERSAO_BLOCOS) {
+            fluxo->etapa = ETAPA_FLUXO_ERRO;
+            return HUFF_ERRO_DADOS_INVALIDOS;
+        }
+        fluxo->etapa = ETAPA_FLUXO_BLOCOS;
+    }
+
+    unsigned char* saida = (unsigned char*)dst;
+    size_t escritos = 0;
+    while (escritos < cap) {
+        if (fluxo->tamanhoPendente > 0) {
+            size_t quantos = fluxo->tamanhoPendente < cap - escritos ? fluxo->tamanhoPendente : cap - escritos;
+            memcpy(saida + escritos, fluxo->pendente, quantos);
+            fluxo->pendente += quantos;
+            fluxo->tamanhoPendente -= quantos;
+            escritos += quantos;
+        } else if (fluxo->etapa == ETAPA_FLUXO_FIM) {
+            break;
+        } else if (puxarBloco(fluxo) != 0) {
+            // O erro fica para a próxima chamada se algo já foi entregue nesta
+            fluxo->etapa = ETAPA_FLUXO_ERRO;
+            return escritos > 0 ? (long long)escritos : HUFF_ERRO_DADOS_INVALIDOS;
+        }
+    }
+    return (long long)escritos;
+}
+
+/*
+ ============================================================================
+ PARTE 15: EXECUÇÃO PARALELA E LOTES
+ ============================================================================
+ Lotes da biblioteca e o formato legado em várias threads, sobre o grupo de
+ threads da PARTE 8.
+*/
+
+// Grupo de threads da biblioteca, com um contexto de compressão por thread
+// (reaproveitado de um lote para o outro)
+struct huff_pool {
+    struct GrupoThreads* grupo;
+    struct huff_cctx** contextos;
+};
+
+struct huff_pool* huff_pool_create(int threads) {
+    struct huff_pool* pool = (struct huff_pool*)malloc(sizeof(struct huff_pool));
+    if (!pool) return NULL;
+    pool->grupo = criarGrupoThreads(threads > 0 ? threads : 1);
+    pool->contextos = NULL;
+
+    int criados = 0;
+    if (pool->grupo) {
+        pool->contextos = (struct huff_cctx**)malloc((size_t)pool->grupo->numThreads * sizeof(struct huff_cctx*));
+        while (pool->contextos && criados < pool->grupo->numThreads &&
+               (pool->contextos[criados] = huff_cctx_create()) != NULL) {
+            criados++;
+        }
+    }
+    if (!pool->grupo || criados < pool->grupo->numThreads) {
+        for (int t = 0; t < criados; t++) huff_cctx_free(pool->contextos[t]);
+        free(pool->contextos);
+        liberarGrupoThreads(pool->grupo);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void huff_pool_free(struct huff_pool* pool) {
+    if (!pool) return;
+    for (int t = 0; t < pool->grupo->numThreads; t++) huff_cctx_free(pool->contextos[t]);
+    liberarGrupoThreads(pool->grupo);
+    free(pool->contextos);
+    free(pool);
+}
+
+int huff_pool_threads(const struct huff_pool* pool) {
+    return pool ? pool->grupo->numThreads : 0;
+}
+
+// Um lote: cada item é compactado pelo contexto da thread que o pegou
+struct LoteCompressao {
+    struct huff_batch_item* itens;
+    struct huff_cctx** contextos;
+    int nivel;
+};
+
+// Procedimento (tarefa do grupo) para compactar um item do lote
+static void compactarItemLote(void* contexto, size_t indice, int thread) {
+    struct LoteCompressao* lote = (struct LoteCompressao*)contexto;
+    struct huff_batch_item* item = &lote->itens[indice];
+    item->result = huff_compress_cctx(lote->contextos[thread], item->src, item->size, item->dst, item->cap,
+                                      lote->nivel);
+}
+
+long long huff_compress_batch(struct huff_pool* pool, struct huff_batch_item* items, size_t count, int level,
+                              const struct huff_preset* preset) {
+    if ((!items && count > 0) || level < HUFF_NIVEL_MINIMO || level > HUFF_NIVEL_MAXIMO) {
+        return HUFF_ERRO_PARAMETRO;
+    }
+
+    // Sem grupo, um grupo de uma thread só para esta chamada
+    struct huff_pool* temporario = NULL;
+    if (!pool) {
+        temporario = huff_pool_create(1);
+        if (!temporario) return HUFF_ERRO_MEMORIA;
+        pool = temporario;
+    }
+
+    for (int t = 0; t < pool->grupo->numThreads; t++) {
+        huff_cctx_use_preset(pool->contextos[t], preset);
+    }
+    struct LoteCompressao lote = {items, pool->contextos, level};
+    executarParalelo(pool->grupo, count, compactarItemLote, &lote);
+    huff_pool_free(temporario);
+
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].result < 0) return items[i].result;
+    }
+    return 0;
+}
+
+#ifndef HUFF_BIBLIOTECA
+/*
+ Formato legado em várias threads. Com a tabela pronta, o tamanho em bits de
+ cada pedaço da entrada já é conhecido antes de codificar: uma soma de
+ prefixos desses tamanhos dá o bit em que cada pedaço começa na saída. Cada
+ thread codifica o seu pedaço num buffer próprio, já deslocado para esse bit,
+ e copia os bytes para a sua faixa da saída. Só o primeiro byte de um pedaço
+ pode ser dividido com o anterior: ele fica à parte e é juntado (OU) depois.
+ O arquivo gerado é o mesmo de compactarArquivoLegado, bit a bit.
+*/
+#define PEDACO_PARALELO (256 * 1024)   // Bytes de entrada por tarefa
+#define PEDACOS_POR_THREAD 8           // Tarefas por thread em cada janela lida
+
+struct CodificacaoParalela {
+    const unsigned char* dados;
+    size_t n;
+    const struct CodigoHuffman* dicionario;
+    uint64_t* inicios;                 // Bit inicial de cada pedaço na saída da janela
+    unsigned char* saida;              // Byte 0 = sobra da janela anterior
+    unsigned char* bordas;             // Primeiro byte de cada pedaço
+    unsigned char** buffers;           // Um buffer de trabalho por thread
+};
+
+// Procedimento (tarefa do grupo) para somar os bits de um pedaço; o total vai
+// para inicios[indice + 1], onde a soma de prefixos o transforma em posição
+static void contarBitsPedaco(void* contexto, size_t indice, int thread) {
+    struct CodificacaoParalela* c = (struct CodificacaoParalela*)contexto;
+    size_t inicio = indice * PEDACO_PARALELO;
+    size_t fim = inicio + PEDACO_PARALELO < c->n ? inicio + PEDACO_PARALELO : c->n;
+    uint64_t bits = 0;
+    (void)thread;
+
+    for (size_t i = inicio; i < fim; i++) {
+        bits += c->dicionario[c->dados[i]].tamanho;
+    }
+    c->inicios[indice + 1] = bits;
+}
+
+// Procedimento (tarefa do grupo) para codificar um pedaço a partir do seu bit
+static void codificarPedaco(void* contexto, size_t indice, int thread) {
+    struct CodificacaoParalela* c = (struct CodificacaoParalela*)contexto;
+    size_t inicio = indice * PEDACO_PARALELO;
+    size_t fim = inicio + PEDACO_PARALELO < c->n ? inicio + PEDACO_PARALELO : c->n;
+    uint64_t bit = c->inicios[indice];
+    unsigned char* buffer = c->buffers[thread];
+
+    // Os bits do pedaço anterior no primeiro byte entram como zeros
+    struct EscritorBits escritor;
+    iniciarEscritor(&escritor, buffer, 2 * PEDACO_PARALELO + 16, NULL);
+    escritor.bitsPendentes = (int)(bit % 8);
+    codificarBytes(&escritor, c->dados + inicio, fim - inicio, c->dicionario);
+    finalizarEscritor(&escritor);
+
+    c->bordas[indice] = buffer[0];
+    memcpy(c->saida + bit / 8 + 1, buffer + 1, escritor.posicao - 1);
+}
+
+// Função para compactar no formato legado com até 'numThreads' threads
+static int compactarArquivoLegadoParalelo(const char* nome_entrada, const char* nome_saida, int nivel, int numThreads) {
+    FILE* entrada = fopen(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = fopen(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fclose(entrada);
+        return 1;
+    }
+
+    struct CodigoHuffman dicionario[256];
+    int tamanho_arvore = iniciarArquivoLegado(entrada, saida, nivel, dicionario);
+    if (tamanho_arvore == 0) {
+        fclose(entrada);
+        fclose(saida);
+        return 0;
+    }
+
+    // Cada janela lida tem alguns pedaços por thread, para equilibrar a carga
+    struct GrupoThreads* grupo = criarGrupoThreads(numThreads);
+    int threads = grupo ? grupo->numThreads : 0;
+    size_t numPedacos = (size_t)threads * PEDACOS_POR_THREAD;
+    size_t janela = numPedacos * PEDACO_PARALELO;
+
+    struct CodificacaoParalela c;
+    c.dicionario = dicionario;
+    c.dados = (unsigned char*)malloc(janela);
+    c.saida = (unsigned char*)malloc(2 * janela + 8);
+    c.inicios = (uint64_t*)malloc((numPedacos + 1) * sizeof(uint64_t));
+    c.bordas = (unsigned char*)malloc(numPedacos);
+    c.buffers = (unsigned char**)calloc((size_t)threads, sizeof(unsigned char*));
+    int ok = grupo && c.dados && c.saida && c.inicios && c.bordas && c.buffers;
+    for (int t = 0; ok && t < threads; t++) {
+        ok = (c.buffers[t] = (unsigned char*)malloc(2 * PEDACO_PARALELO + 16)) != NULL;
+    }
+
+    unsigned char sobra = 0;           // Último byte incompleto da janela anterior
+    int bitsSobra = 0;
+    size_t lidos;
+    fseek(entrada, 0, SEEK_SET);
+    while (ok && (lidos = fread((unsigned char*)c.dados, 1, janela, entrada)) > 0) {
+        size_t pedacos = (lidos + PEDACO_PARALELO - 1) / PEDACO_PARALELO;
+        c.n = lidos;
+        executarParalelo(grupo, pedacos, contarBitsPedaco, &c);
+
+        // Soma de prefixos: bit inicial de cada pedaço, depois da sobra
+        c.inicios[0] = (uint64_t)bitsSobra;
+        for (size_t k = 1; k <= pedacos; k++) {
+            c.inicios[k] += c.inicios[k - 1];
+        }
+        uint64_t bits = c.inicios[pedacos];
+        memset(c.saida, 0, (size_t)((bits + 7) / 8));
+        c.saida[0] = sobra;
+
+        executarParalelo(grupo, pedacos, codificarPedaco, &c);
+        for (size_t k = 0; k < pedacos; k++) {
+            c.saida[c.inicios[k] / 8] |= c.bordas[k];
+        }
+
+        // Só os bytes completos são gravados; o incompleto vai para a próxima janela
+        fwrite(c.saida, 1, (size_t)(bits / 8), saida);
+        bitsSobra = (int)(bits % 8);
+        sobra = bitsSobra > 0 ? c.saida[bits / 8] : 0;
+    }
+
+    int lixo = 0;
+    if (ok && bitsSobra > 0) {
+        fwrite(&sobra, 1, 1, saida);
+        lixo = 8 - bitsSobra;
+    }
+
+    // Corrigir o cabeçalho com os bits de lixo reais
+    if (ok) {
+        unsigned char cabecalho[2];
+        montarCabecalho(cabecalho, lixo, tamanho_arvore);
+        fseek(saida, 0, SEEK_SET);
+        fwrite(cabecalho, 1, 2, saida);
+    } else {
+        printf("Erro na alocação de memória.\n");
+    }
+
+    for (int t = 0; c.buffers && t < threads; t++) free(c.buffers[t]);
+    free(c.buffers);
+    free(c.bordas);
+    free(c.inicios);
+    free(c.saida);
+    free((unsigned char*)c.dados);
+    liberarGrupoThreads(grupo);
+    fclose(entrada);
+    fclose(saida);
+    return ok ? 0 : 1;
+}
+
+/*
+ Descompactação do formato legado em várias threads. O arquivo não tem índice
+ de blocos, mas um código de Huffman costuma se sincronizar sozinho: começando
+ a decodificar num bit qualquer, depois de alguns símbolos errados as
+ fronteiras dos símbolos voltam a coincidir com as verdadeiras. Cada pedaço da
+ janela é decodificado a partir do seu primeiro byte e guarda onde começam os
+ seus primeiros símbolos; o primeiro pedaço de cada janela parte do bit exato.
+ Na costura, a decodificação verdadeira continua do ponto em que o pedaço
+ anterior terminou até cair numa dessas fronteiras: dali em diante a saída
+ especulativa do pedaço está certa. Se o pedaço não sincronizou a tempo, ele
+ é decodificado de novo, em sequência, a partir do bit verdadeiro.
+*/
+#define PEDACO_DECODIFICACAO (64 * 1024)   // Bytes compactados por tarefa
+#define SIMBOLOS_SINCRONIA 1024             // Fronteiras guardadas por pedaço
+
+// Um pedaço da janela: saída especulativa e onde ela parou
+struct PedacoDecodificacao {
+    long long inicio;                  // Bit em que a decodificação começa
+    long long fimNominal;              // Para no primeiro símbolo que passar daqui
+    long long fim;                     // Bit em que parou
+    size_t numSimbolos;
+    long long* fronteiras;             // Bit inicial dos primeiros símbolos
+    unsigned char* saida;
+};
+
+struct DecodificacaoParalela {
+    const struct ArvoreDecodificacao* arvore;
+    const unsigned char* dados;        // Bits do arquivo (depois da árvore)
+    size_t tamanho;
+    long long totalBits;
+    struct PedacoDecodificacao* pedacos;
+};
+
+// Procedimento para posicionar o leitor no bit 'bit' dos dados
+static void posicionarLeitor(struct LeitorBits* leitor, const struct DecodificacaoParalela* d, long long bit) {
+    iniciarLeitor(leitor, d->dados, d->tamanho);
+    leitor->posicao = (size_t)(bit / 8);
+    lerBits(leitor, (int)(bit % 8));
+}
+
+// Procedimento para decodificar o pedaço a partir de pedaco->inicio até passar
+// do fim nominal (ou do fim dos dados), guardando as primeiras fronteiras
+static void decodificarPedaco(const struct DecodificacaoParalela* d, struct PedacoDecodificacao* pedaco) {
+    struct LeitorBits leitor;
+    posicionarLeitor(&leitor, d, pedaco->inicio);
+
+    long long lidos = pedaco->inicio;
+    long long limite = pedaco->fimNominal < d->totalBits ? pedaco->fimNominal : d->totalBits;
+    size_t n = 0;
+    while (lidos < limite) {
+        if (n < SIMBOLOS_SINCRONIA) pedaco->fronteiras[n] = lidos;
+        pedaco->saida[n++] = decodificarUmSimbolo(d->arvore, &leitor, &lidos);
+    }
+    pedaco->fim = lidos;
+    pedaco->numSimbolos = n;
+}
+
+// Procedimento (tarefa do grupo) para a decodificação especulativa de um pedaço
+static void decodificarPedacoTarefa(void* contexto, size_t indice, int thread) {
+    struct DecodificacaoParalela* d = (struct DecodificacaoParalela*)contexto;
+    (void)thread;
+    decodificarPedaco(d, &d->pedacos[indice]);
+}
+
+// Função de descompactação do formato legado com até 'numThreads' threads.
+// A saída é a mesma de descompactarArquivoLegado.
+static int descompactarArquivoLegadoParalelo(FILE* entrada, FILE* saida, int numThreads) {
+    long tamanho;
+    unsigned char* dados = lerArquivoInteiro(entrada, &tamanho);
+    struct ArvoreDecodificacao* arvore = (struct ArvoreDecodificacao*)malloc(sizeof(struct ArvoreDecodificacao));
+    size_t inicio = 0;
+    long long totalBits = 0;
+    int cabecalho = dados && arvore ? lerCabecalhoLegado(dados, tamanho, arvore, &inicio, &totalBits) : -1;
+    if (cabecalho != 0) {
+        if (cabecalho < 0) printf("Erro: Cabeçalho inválido ou arquivo corrompido\n");
+        free(arvore);
+        free(dados);
+        return cabecalho < 0 ? 1 : 0;
+    }
+
+    // Cada símbolo gasta ao menos 1 bit; o último pode passar do fim nominal
+    // por menos que a maior profundidade da árvore
+    struct GrupoThreads* grupo = criarGrupoThreads(numThreads);
+    size_t numPedacos = grupo ? (size_t)grupo->numThreads * PEDACOS_POR_THREAD : 0;
+    size_t capacidade = 8 * (size_t)PEDACO_DECODIFICACAO + MAXIMO_NOS;
+    struct DecodificacaoParalela d = {arvore, dados + inicio, (size_t)tamanho - inicio, totalBits, NULL};
+    d.pedacos = (struct PedacoDecodificacao*)calloc(numPedacos > 0 ? numPedacos : 1, sizeof(struct PedacoDecodificacao));
+    int ok = grupo && d.pedacos;
+    for (size_t k = 0; ok && k < numPedacos; k++) {
+        d.pedacos[k].fronteiras = (long long*)malloc(SIMBOLOS_SINCRONIA * sizeof(long long));
+        d.pedacos[k].saida = (unsigned char*)malloc(capacidade);
+        ok = d.pedacos[k].fronteiras && d.pedacos[k].saida;
+    }
+    if (!ok) printf("Erro na alocação de memória.\n");
+
+    // 'verdadeiro' é sempre uma fronteira real de símbolo
+    long long verdadeiro = 0;
+    int status = ok ? 0 : 1;
+    while (ok && verdadeiro < totalBits) {
+        // Pedaços da janela; o primeiro começa no bit exato
+        long long base = verdadeiro / 8 * 8;
+        size_t pedacos = 0;
+        while (pedacos < numPedacos && base + (long long)pedacos * 8 * PEDACO_DECODIFICACAO < totalBits) {
+            struct PedacoDecodificacao* pedaco = &d.pedacos[pedacos];
+            pedaco->inicio = pedacos == 0 ? verdadeiro : base + (long long)pedacos * 8 * PEDACO_DECODIFICACAO;
+            pedaco->fimNominal = base + (long long)(pedacos + 1) * 8 * PEDACO_DECODIFICACAO;
+            pedacos++;
+        }
+        executarParalelo(grupo, pedacos, decodificarPedacoTarefa, &d);
+
+        // Costura: os símbolos verdadeiros seguem do fim do pedaço anterior até
+        // a primeira fronteira em comum; dali em diante vale a saída do pedaço
+        for (size_t k = 0; k < pedacos; k++) {
+            struct PedacoDecodificacao* pedaco = &d.pedacos[k];
+            size_t primeiro = 0;
+            if (k > 0) {
+                size_t guardadas = pedaco->numSimbolos < SIMBOLOS_SINCRONIA ? pedaco->numSimbolos
+                                                                            : SIMBOLOS_SINCRONIA;
+                unsigned char ponte[256];
+                size_t numPonte = 0;
+                struct LeitorBits leitor;
+                posicionarLeitor(&leitor, &d, verdadeiro);
+                while (verdadeiro < totalBits) {
+                    while (primeiro < guardadas && pedaco->fronteiras[primeiro] < verdadeiro) primeiro++;
+                    if (primeiro == guardadas || pedaco->fronteiras[primeiro] == verdadeiro) break;
+                    ponte[numPonte++] = decodificarUmSimbolo(arvore, &leitor, &verdadeiro);
+                    if (numPonte == sizeof(ponte)) {
+                        fwrite(ponte, 1, numPonte, saida);
+                        numPonte = 0;
+                    }
+                }
+                fwrite(ponte, 1, numPonte, saida);
+
+                // Não sincronizou: decodificar de novo a partir do bit verdadeiro
+                if (primeiro == guardadas || pedaco->fronteiras[primeiro] != verdadeiro) {
+                    pedaco->inicio = verdadeiro;
+                    decodificarPedaco(&d, pedaco);
+                    primeiro = 0;
+                }
+            }
+            fwrite(pedaco->saida + primeiro, 1, pedaco->numSimbolos - primeiro, saida);
+            verdadeiro = pedaco->fim;
+        }
+    }
+
+    if (ok && verdadeiro != totalBits) {
+        printf("Erro: Dados compactados truncados ou corrompidos\n");
+        status = 1;
+    }
+
+    for (size_t k = 0; d.pedacos && k < numPedacos; k++) {
+        free(d.pedacos[k].fronteiras);
+        free(d.pedacos[k].saida);
+    }
+    free(d.pedacos);
+    liberarGrupoThreads(grupo);
+    free(arvore);
+    free(dados);
+    return status;
+}
+
+/*
+ ============================================================================
+ PARTE 16: LINHA DE COMANDO
+ ============================================================================
+*/
+
+// Função para carregar uma tabela pré-definida (-T) gravada por huff_preset_save.
+// Retorna NULL em caso de erro.
+static struct huff_preset* carregarTabelaArquivo(const char* nome) {
+    FILE* arquivo = fopen(nome, "rb");
+    if (!arquivo) {
+        printf("Erro ao abrir tabela: %s\n", nome);
+        return NULL;
+    }
+
+    long tamanho;
+    unsigned char* dados = lerArquivoInteiro(arquivo, &tamanho);
+    fclose(arquivo);
+    struct huff_preset* preset = dados ? huff_preset_load(dados, (size_t)tamanho) : NULL;
+    if (!preset) {
+        printf("Erro: Tabela pré-definida inválida: %s\n", nome);
+    }
+    free(dados);
+    return preset;
+}
+
+// Arquivo do cache de tabelas (-C): "HUFC" + versão (1 byte) + número de
+// entradas (varint) + por entrada: assinatura (as 256 faixas, duas por byte) e
+// o tamanho do código de cada byte. As entradas vão da mais recente para a mais
+// antiga; o ID de cada tabela é recalculado a partir dos tamanhos.
+#define MAGICO_CACHE "HUFC"
+#define VERSAO_CACHE 1
+
+// Função para carregar o cache de tabelas. Um arquivo inexistente é um cache
+// vazio quando 'obrigatorio' é 0. Retorna 0 ou 1 em caso de erro.
+static int carregarCache(const char* nome, struct CacheTabelas* cache, int obrigatorio) {
+    cache->numEntradas = 0;
+    cache->relogio = 0;
+    cache->inicioExecucao = 0;
+    cache->alterado = 0;
+
+    FILE* arquivo = fopen(nome, "rb");
+    if (!arquivo) {
+        if (!obrigatorio) return 0;
+        printf("Erro ao abrir cache de tabelas: %s\n", nome);
+        return 1;
+    }
+
+    long tamanho;
+    unsigned char* dados = lerArquivoInteiro(arquivo, &tamanho);
+    fclose(arquivo);
+
+    uint64_t numEntradas = 0;
+    size_t posicao = 5;
+    size_t lidos = 0;
+    int valido = dados && tamanho >= 6 && memcmp(dados, MAGICO_CACHE, 4) == 0 && dados[4] == VERSAO_CACHE &&
+                 (lidos = lerVarint(dados + 5, (size_t)tamanho - 5, &numEntradas)) > 0 &&
+                 numEntradas <= MAXIMO_CACHE && 5 + lidos + numEntradas * (128 + 256) == (uint64_t)tamanho;
+    posicao += lidos;
+    for (int i = 0; valido && i < (int)numEntradas; i++) {
+        struct EntradaCache* entrada = &cache->entradas[i];
+        const unsigned char* bruto = dados + posicao;
+        for (int b = 0; b < 128; b++) {
+            entrada->assinatura[2 * b] = bruto[b] & 0x0F;
+            entrada->assinatura[2 * b + 1] = bruto[b] >> 4;
+        }
+        entrada->uso = numEntradas - (uint64_t)i;
+        valido = montarPresetTamanhos(&entrada->preset, bruto + 128, hashTamanhos(bruto + 128)) == 0;
+        posicao += 128 + 256;
+    }
+    free(dados);
+
+    if (!valido) {
+        printf("Erro: Cache de tabelas inválido: %s\n", nome);
+        return 1;
+    }
+    cache->numEntradas = (int)numEntradas;
+    cache->relogio = numEntradas;
+    cache->inicioExecucao = numEntradas;
+    return 0;
+}
+
+// Função para gravar o cache de tabelas, da entrada mais recente para a mais
+// antiga. Retorna 0 ou 1 em caso de erro.
+static int gravarCache(const char* nome, const struct CacheTabelas* cache) {
+    FILE* arquivo = fopen(nome, "wb");
+    if (!arquivo) {
+        printf("Erro ao gravar cache de tabelas: %s\n", nome);
+        return 1;
+    }
+
+    unsigned char cabecalho[5 + 10];
+    memcpy(cabecalho, MAGICO_CACHE, 4);
+    cabecalho[4] = VERSAO_CACHE;
+    size_t tamanho = 5 + (size_t)escreverVarint(cabecalho + 5, (uint64_t)cache->numEntradas);
+    fwrite(cabecalho, 1, tamanho, arquivo);
+
+    // Ordem decrescente de uso (o cache tem no máximo MAXIMO_CACHE entradas)
+    int gravada[MAXIMO_CACHE] = {0};
+    for (int k = 0; k < cache->numEntradas; k++) {
+        int maior = -1;
+        for (int i = 0; i < cache->numEntradas; i++) {
+            if (!gravada[i] && (maior < 0 || cache->entradas[i].uso > cache->entradas[maior].uso)) maior = i;
+        }
+        gravada[maior] = 1;
+
+        const struct EntradaCache* entrada = &cache->entradas[maior];
+        unsigned char assinatura[128];
+        for (int b = 0; b < 128; b++) {
+            assinatura[b] = (unsigned char)(entrada->assinatura[2 * b] | entrada->assinatura[2 * b + 1] << 4);
+        }
+        fwrite(assinatura, 1, sizeof(assinatura), arquivo);
+        fwrite(entrada->preset.tamanhos, 1, 256, arquivo);
+    }
+
+    int erro = ferror(arquivo);
+    if (fclose(arquivo) != 0 || erro) {
+        printf("Erro ao gravar cache de tabelas: %s\n", nome);
+        return 1;
+    }
+    return 0;
+}
+
+// Função que detecta o formato pelo número mágico e descompacta
+static int descompactarArquivo(const char* nome_entrada, const char* nome_saida,
+                               const struct huff_preset* const* presets, int numPresets, int numThreads) {
+    FILE* entrada = abrirArquivo(nome_entrada, "rb");
+    if (!entrada) {
+        printf("Erro ao abrir arquivo compactado: %s\n", nome_entrada);
+        return 1;
+    }
+
+    FILE* saida = abrirArquivo(nome_saida, "wb");
+    if (!saida) {
+        printf("Erro ao criar arquivo de saída: %s\n", nome_saida);
+        fecharArquivo(entrada);
+        return 1;
+    }
+
+    // Um .huff legado válido sempre tem '*' (raiz) no terceiro byte, nunca 'F'
+    char magico[4];
+    int status;
+    int lidos = (int)fread(magico, 1, 4, entrada);
+    if (lidos == 4 && memcmp(magico, MAGICO_BLOCOS, 4) == 0) {
+        status = descompactarArquivoBlocos(entrada, saida, presets, numPresets);
+    } else if (lidos == 4 && memcmp(magico, MAGICO_ADAPTATIVO, 4) == 0) {
+        status = descompactarFluxoAdaptativo(entrada, saida);
+    } else if (lidos == 4 && memcmp(magico, MAGICO_PERIODICO, 4) == 0) {
+        status = descompactarFluxoPeriodico(entrada, saida);
+    } else if (lidos == 4 && memcmp(magico, MAGICO_PALAVRAS, 4) == 0) {
+        status = descompactarArquivoPalavras(entrada, saida);
+    } else if (lidos == 4 && memcmp(magico, MAGICO_LZ77, 4) == 0) {
+        status = descompactarArquivoLz(entrada, saida);
+    } else if (lidos >= 2 && (unsigned char)magico[0] == 0x1F && (unsigned char)magico[1] == 0x8B) {
+        printf("Erro: Arquivo gzip (-G); descompacte com gunzip ou zlib\n");
+        status = 1;
+    } else if (fseek(entrada, 0, SEEK_SET) == 0) {
+        status = numThreads > 1 ? descompactarArquivoLegadoParalelo(entrada, saida, numThreads)
+                                : descompactarArquivoLegado(entrada, saida);
+    } else {
+        printf("Erro: O formato legado precisa de um arquivo (não aceita pipe)\n");
+        status = 1;
+    }
+
+    fecharArquivo(entrada);
+    fecharArquivo(saida);
+    return status;
+}
+
+// Função para calcular os bits por byte de um histograma com uma tabela
+// e a entropia de ordem 0 dele (o mínimo que qualquer tabela alcançaria)
+static double bitsPorByte(const uint64_t contagem[256], const uint8_t tamanhos[256], double* entropia) {
+    uint64_t total = 0;
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        total += contagem[i];
+        bits += (double)contagem[i] * tamanhos[i];
+    }
+
+    *entropia = 0;
+    if (total == 0) return 0;
+    for (int i = 0; i < 256; i++) {
+        if (contagem[i] > 0) {
+            double p = (double)contagem[i] / (double)total;
+            *entropia -= p * log2(p);
+        }
+    }
+    return bits / (double)total;
+}
+
+// Função para treinar uma tabela pré-definida com os arquivos de amostra e
+// gravá-la em 'nome_tabela'. Mostra os bits/byte esperados em cada amostra.
+static int treinarTabela(const char* nome_tabela, char* const amostras[], int numAmostras, uint32_t id) {
+    uint64_t (*contagens)[256] = (uint64_t (*)[256])calloc((size_t)numAmostras, sizeof(*contagens));
+    unsigned char* buffer = (unsigned char*)malloc(TAMANHO_BUFFER);
+    struct huff_preset* preset = (struct huff_preset*)malloc(sizeof(struct huff_preset));
+    if (!contagens || !buffer || !preset) {
+        printf("Erro na alocação de memória.\n");
+        free(contagens);
+        free(buffer);
+        free(preset);
+        return 1;
+    }
+
+    // Um histograma por amostra, somados no histograma do corpus
+    uint64_t corpus[256] = {0};
+    int status = 0;
+    for (int a = 0; a < numAmostras && status == 0; a++) {
+        FILE* arquivo = fopen(amostras[a], "rb");
+        if (!arquivo) {
+            printf("Erro ao abrir amostra: %s\n", amostras[a]);
+            status = 1;
+            break;
+        }
+        size_t lidos;
+        while ((lidos = fread(buffer, 1, TAMANHO_BUFFER, arquivo)) > 0) {
+            contarBytes(buffer, lidos, contagens[a]);
+        }
+        if (ferror(arquivo)) {
+            printf("Erro ao ler amostra: %s\n", amostras[a]);
+            status = 1;
+        }
+        fclose(arquivo);
+        for (int i = 0; i < 256; i++) corpus[i] += contagens[a][i];
+    }
+
+    unsigned char tabela[HUFF_TAMANHO_MAXIMO_PRESET];
+    long long tamanhoTabela = 0;
+    if (status == 0 && (montarPreset(preset, corpus, id) != 0 ||
+                        (tamanhoTabela = huff_preset_save(preset, tabela, sizeof(tabela))) < 0)) {
+        printf("Erro ao montar a tabela\n");
+        status = 1;
+    }
+
+    FILE* saida = status == 0 ? fopen(nome_tabela, "wb") : NULL;
+    if (status == 0 && (!saida || fwrite(tabela, 1, (size_t)tamanhoTabela, saida) != (size_t)tamanhoTabela)) {
+        printf("Erro ao gravar tabela: %s\n", nome_tabela);
+        status = 1;
+    }
+    if (saida) fclose(saida);
+
+    if (status == 0) {
+        printf("Tabela %s: ID %lu, %lld bytes, %d amostra(s)\n", nome_tabela, (unsigned long)id, tamanhoTabela,
+               numAmostras);
+        printf("Amostra                          |      Bytes | Bits/byte | Entropia\n");
+        double entropia;
+        for (int a = 0; a < numAmostras; a++) {
+            uint64_t bytes = 0;
+            for (int i = 0; i < 256; i++) bytes += contagens[a][i];
+            double bits = bitsPorByte(contagens[a], preset->tamanhos, &entropia);
+            printf("%-32.32s | %10llu | %9.3f | %8.3f\n", amostras[a], (unsigned long long)bytes, bits, entropia);
+        }
+        double bits = bitsPorByte(corpus, preset->tamanhos, &entropia);
+        printf("%-32s |            | %9.3f | %8.3f\n", "(corpus)", bits, entropia);
+    }
+
+    free(contagens);
+    free(buffer);
+    free(preset);
+    return status;
+}
+
+// Procedimento para mostrar o cabeçalho do arquivo compactado
+static void mostrarCabecalhoCompactado(const char* arquivo_compactado) {
+    FILE* arquivo = fopen(arquivo_compactado, "rb");
+    if (!arquivo) {
+        printf("Erro ao abrir arquivo compactado\n");
+        return;
+    }
+
+    char magico[4];
+    int lidos = (int)fread(magico, 1, 4, arquivo);
+    int lz77 = lidos == 4 && memcmp(magico, MAGICO_LZ77, 4) == 0;
+    if (lz77 || (lidos == 4 && memcmp(magico, MAGICO_BLOCOS, 4) == 0)) {
+        static const char* nomes[] = {"fim", "armazenado", "huffman", "repetido", "multitabela",
+                                      "ordem1", "lz77", "tans", "colunas", "preset"};
+        printf("=== ARQUIVO EM BLOCOS%s (versão %d) ===\n", lz77 ? " LZ77" : "", fgetc(arquivo));
+        if (lz77) {
+            uint64_t janela = 0;
+            lerVarintArquivo(arquivo, &janela);
+            printf("Janela: %llu bytes\n", (unsigned long long)janela);
+        }
+        printf("Bloco | Tipo        | Original | Compactado\n");
+
+        int numero = 0;
+        int tipo;
+        uint64_t tamanhoOriginal, tamanho;
+        while ((tipo = fgetc(arquivo)) != EOF && tipo != BLOCO_FIM &&
+               lerVarintArquivo(arquivo, &tamanhoOriginal) == 0 &&
+               lerVarintArquivo(arquivo, &tamanho) == 0) {
+            int estagios = tipo & ~MASCARA_TIPO;
+            tipo &= MASCARA_TIPO;
+            printf("%5d | %-11s | %8llu | %10llu%s%s%s%s\n", numero++,
+                   tipo < 10 ? nomes[tipo] : "?",
+                   (unsigned long long)tamanhoOriginal, (unsigned long long)tamanho,
+                   (estagios & ESTAGIO_FILTRO) ? " +filtro" : "", (estagios & ESTAGIO_RLE) ? " +rle" : "", (estagios & ESTAGIO_BWT) ? " +bwt" : "",
+                   (estagios & ESTAGIO_MTF) ? " +mtf" : "");
+            fseek(arquivo, (long)tamanho, SEEK_CUR);
+        }
+        fclose(arquivo);
+        return;
+    }
+    if (memcmp(magico, MAGICO_ADAPTATIVO, 4) == 0) {
+        printf("=== FLUXO ADAPTATIVO (versão %d) ===\n", fgetc(arquivo));
+        printf("Sem árvore no cabeçalho: o código se ajusta a cada símbolo\n");
+        printf("Tamanho total: %ld bytes\n", tamanhoArquivo(arquivo));
+        fclose(arquivo);
+        return;
+    }
+    if (memcmp(magico, MAGICO_PALAVRAS, 4) == 0) {
+        printf("=== PALAVRAS DE 16 BITS (versão %d) ===\n", fgetc(arquivo));
+        printf("Bloco | Palavras | Compactado\n");
+
+        int numero = 0;
+        uint64_t palavras, tamanho;
+        while (lerVarintArquivo(arquivo, &palavras) == 0 && palavras > 0 &&
+               lerVarintArquivo(arquivo, &tamanho) == 0) {
+            if (tamanho == 0) {
+                printf("%5d | %8llu | armazenado\n", numero++, (unsigned long long)palavras);
+                fseek(arquivo, (long)(2 * palavras), SEEK_CUR);
+                continue;
+            }
+            printf("%5d | %8llu | %10llu\n", numero++,
+                   (unsigned long long)palavras, (unsigned long long)tamanho);
+            fseek(arquivo, (long)tamanho, SEEK_CUR);
+        }
+        fclose(arquivo);
+        return;
+    }
+    if (memcmp(magico, MAGICO_PERIODICO, 4) == 0) {
+        uint64_t periodo = 0;
+        printf("=== FLUXO SEMIADAPTATIVO (versão %d) ===\n", fgetc(arquivo));
+        lerVarintArquivo(arquivo, &periodo);
+        printf("Tabela reconstruída a cada %llu bytes\n", (unsigned long long)periodo);
+        printf("Tamanho total: %ld bytes\n", tamanhoArquivo(arquivo));
+        fclose(arquivo);
+        return;
+    }
+
+    unsigned char bytes[2] = {(unsigned char)magico[0], (unsigned char)magico[1]};
+    unsigned short cabecalho = (unsigned short)((bytes[0] << 8) | bytes[1]);
+    printf("=== ESTRUTURA DO ARQUIVO COMPACTADO ===\n");
+    printf("Bits de lixo: %d\n", (cabecalho >> 13) & 0x07);
+    printf("Tamanho da árvore: %d bytes\n", cabecalho & 0x1FFF);
+    printf("Tamanho total: %ld bytes\n", tamanhoArquivo(arquivo));
+    fclose(arquivo);
+}
+
+// Função para ler a opção -F: "a" (ou vazio) automático, "0" nenhum,
+// "d<passo>" delta, "p<passo>" planos, "pd<passo>" delta e planos.
+// Retorna o descritor, 0, FILTRO_AUTOMATICO ou -2 se a opção for inválida.
+static int lerFiltro(const char* texto) {
+    if (texto[0] == '\0' || strcmp(texto, "a") == 0) return FILTRO_AUTOMATICO;
+    if (strcmp(texto, "0") == 0) return 0;
+
+    int tipo;
+    if (strncmp(texto, "pd", 2) == 0) {
+        tipo = FILTRO_PLANOS_DELTA;
+        texto += 2;
+    } else if (texto[0] == 'p') {
+        tipo = FILTRO_PLANOS;
+        texto++;
+    } else if (texto[0] == 'd') {
+        tipo = FILTRO_DELTA;
+        texto++;
+    } else {
+        return -2;
+    }
+
+    int passo = atoi(texto);
+    int descritor = DESCRITOR_FILTRO(tipo, passo);
+    return passo >= 1 && passo <= PASSO_MAXIMO_FILTRO && filtroValido(descritor) ? descritor : -2;
+}
+
+static void mostrarUso(const char* programa) {
+    printf("Uso:\n");
+    printf("  %s c [-1..-9] [-F<filtro>] [-R<bytes>] [-T<tabela>] [-C<cache>] [-j<threads>] [-L|-A|-P[KiB]|-W|-Z[KiB]|-G]"
+           " <entrada> <saida.huff> comprimir\n", programa);
+    printf("  %s d [-T<tabela>] [-C<cache>] [-j<threads>] <entrada.huff> <saida>  descomprimir\n", programa);
+    printf("  %s info <arquivo.huff>                      mostrar cabeçalho\n", programa);
+    printf("  %s train [-I<id>] <tabela> <amostra>...      treinar tabela pré-definida\n", programa);
+    printf("Níveis 1-3 usam histograma amostrado (mais rápido); 4-9 contagem exata\n");
+    printf("e blocos divididos onde a distribuição dos bytes muda.\n");
+    printf("-F filtra dados numéricos antes do Huffman: a (automático, padrão a partir do -4),\n");
+    printf("   0 (nenhum), d<passo> (delta), p<passo> (planos de bytes), pd<passo> (os dois);\n");
+    printf("   passo = tamanho do elemento em bytes, ex.: -Fpd4 para inteiros de 32 bits.\n");
+    printf("-R separa registros de tamanho fixo em colunas (byte j de cada registro),\n");
+    printf("   cada coluna com a sua tabela; ex.: -R64 para structs de 64 bytes.\n");
+    printf("-T usa uma tabela pré-definida (huff_preset_save) nos blocos em que ela\n");
+    printf("   compensa, sem árvore no arquivo; o mesmo -T é exigido no d. O train monta a\n");
+    printf("   tabela com os bytes das amostras (ex.: amostras/*.json) e mostra os bits/byte\n");
+    printf("   esperados em cada uma; -I define o ID gravado nos blocos (padrão 1).\n");
+    printf("-C mantém num arquivo as últimas %d tabelas montadas, achadas pela assinatura\n", MAXIMO_CACHE);
+    printf("   do histograma; blocos parecidos usam a tabela do cache pelo hash, sem árvore.\n");
+    printf("   O d precisa de um cache que ainda tenha as tabelas usadas.\n");
+    printf("-j divide o trabalho entre threads (compilado com -DHUFF_THREADS): os blocos ou\n");
+    printf("   colunas de cada janela (sem -C) ou os bits do formato legado (mesmo arquivo).\n");
+    printf("-L grava o formato legado (um único fluxo, sem blocos).\n");
+    printf("   No d, -j<threads> decodifica arquivos legados em paralelo.\n");
+    printf("-A usa o modo adaptativo de uma passada (fluxos ao vivo, ex.: logs);\n");
+    printf("-P reconstrói a tabela a cada período (padrão %d KiB, ex.: -P256) sem\n", PERIODO_PADRAO_KIB);
+    printf("   gravá-la no arquivo.\n");
+    printf("-Z procura repetições com LZ77 antes do Huffman (janela padrão %d KiB,\n", JANELA_PADRAO_KIB);
+    printf("   até %d; ex.: -Z256); o nível define o esforço da busca.\n", JANELA_MAXIMA_KIB);
+    printf("-G grava gzip (DEFLATE com Huffman dinâmico), que abre com gunzip/zlib.\n");
+    printf("-W codifica palavras de 16 bits (little-endian) com alfabeto de 65536 símbolos.\n");
+    printf("   \"-\" no lugar de um arquivo usa a entrada/saída padrão.\n");
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "Portuguese");
+
+    if (argc < 3) {
+        mostrarUso(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "c") == 0) {
+        int nivel = NIVEL_PADRAO;
+        int legado = 0;
+        int adaptativo = 0;
+        int periodoKiB = 0;
+        int palavras = 0;
+        int janelaKiB = 0;
+        int gzip = 0;
+        int filtro = FILTRO_AUTOMATICO;
+        int registro = 0;
+        const char* tabela = NULL;
+        const char* nomeCache = NULL;
+        int threads = 1;
+        int arg = 2;
+        while (arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0') {
+            if (argv[arg][1] == 'P') {
+                periodoKiB = argv[arg][2] ? atoi(argv[arg] + 2) : PERIODO_PADRAO_KIB;
+                if (periodoKiB < 1 || periodoKiB > PERIODO_MAXIMO_KIB) {
+                    printf("Período inválido (1 a %d KiB)\n", PERIODO_MAXIMO_KIB);
+                    return 1;
+                }
+            } else if (argv[arg][1] == 'Z') {
+                janelaKiB = argv[arg][2] ? atoi(argv[arg] + 2) : JANELA_PADRAO_KIB;
+                if (janelaKiB < 1 || janelaKiB > JANELA_MAXIMA_KIB) {
+                    printf("Janela inválida (1 a %d KiB)\n", JANELA_MAXIMA_KIB);
+                    return 1;
+                }
+            } else if (argv[arg][1] == 'R') {
+                registro = atoi(argv[arg] + 2);
+                if (registro < 2 || registro > MAXIMO_REGISTRO) {
+                    printf("Tamanho de registro inválido (2 a %d bytes)\n", MAXIMO_REGISTRO);
+                    return 1;
+                }
+            } else if (argv[arg][1] == 'T' && argv[arg][2] != '\0') {
+                tabela = argv[arg] + 2;
+            } else if (argv[arg][1] == 'C' && argv[arg][2] != '\0') {
+                nomeCache = argv[arg] + 2;
+            } else if (argv[arg][1] == 'j') {
+                threads = atoi(argv[arg] + 2);
+                if (threads < 1 || threads > MAXIMO_THREADS) {
+                    printf("Número de threads inválido (1 a %d)\n", MAXIMO_THREADS);
+                    return 1;
+                }
+            } else if (argv[arg][1] == 'F') {
+                filtro = lerFiltro(argv[arg] + 2);
+                if (filtro == -2) {
+                    printf("Filtro inválido (a, 0, d<passo>, p<passo> ou pd<passo>; passo de 1 a %d)\n",
+                           PASSO_MAXIMO_FILTRO);
+                    return 1;
+                }
+            } else if (argv[arg][2] != '\0') {
+                break;
+            } else if (argv[arg][1] >= '1' && argv[arg][1] <= '9') {
+                nivel = argv[arg][1] - '0';
+            } else if (argv[arg][1] == 'L') {
+                legado = 1;
+            } else if (argv[arg][1] == 'A') {
+                adaptativo = 1;
+            } else if (argv[arg][1] == 'W') {
+                palavras = 1;
+            } else if (argv[arg][1] == 'G') {
+                gzip = 1;
+            } else {
+                break;
+            }
+            arg++;
+        }
+        if (argc - arg != 2) {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+        if (gzip) {
+            return compactarArquivoGzip(argv[arg], argv[arg + 1], nivel);
+        }
+        if (janelaKiB > 0) {
+            return compactarArquivoLz(argv[arg], argv[arg + 1], nivel, janelaKiB);
+        }
+        if (palavras) {
+            return compactarArquivoPalavras(argv[arg], argv[arg + 1]);
+        }
+        if (periodoKiB > 0) {
+            return compactarFluxoPeriodico(argv[arg], argv[arg + 1], periodoKiB);
+        }
+        if (adaptativo) {
+            return compactarFluxoAdaptativo(argv[arg], argv[arg + 1]);
+        }
+        if (legado && threads > 1) {
+            return compactarArquivoLegadoParalelo(argv[arg], argv[arg + 1], nivel, threads);
+        }
+        if (legado) {
+            return compactarArquivoLegado(argv[arg], argv[arg + 1], nivel);
+        }
+        struct huff_preset* preset = NULL;
+        struct CacheTabelas* cache = NULL;
+        if (tabela && !(preset = carregarTabelaArquivo(tabela))) {
+            return 1;
+        }
+        if (nomeCache) {
+            cache = (struct CacheTabelas*)malloc(sizeof(struct CacheTabelas));
+            if (!cache || carregarCache(nomeCache, cache, 0) != 0) {
+                if (!cache) printf("Erro na alocação de memória.\n");
+                free(cache);
+                huff_preset_free(preset);
+                return 1;
+            }
+        }
+        int status = compactarArquivoBlocos(argv[arg], argv[arg + 1], nivel, filtro, registro, preset, cache,
+                                            threads);
+        if (status == 0 && cache) {
+            status = gravarCache(nomeCache, cache);
+        }
+        free(cache);
+        huff_preset_free(preset);
+        return status;
+    }
+
+    if (strcmp(argv[1], "d") == 0) {
+        const char* tabela = NULL;
+        const char* nomeCache = NULL;
+        int threads = 1;
+        int arg = 2;
+        while (arg < argc && (strncmp(argv[arg], "-T", 2) == 0 || strncmp(argv[arg], "-C", 2) == 0 ||
+                              strncmp(argv[arg], "-j", 2) == 0) &&
+               argv[arg][2] != '\0') {
+            if (argv[arg][1] == 'T') {
+                tabela = argv[arg] + 2;
+            } else if (argv[arg][1] == 'C') {
+                nomeCache = argv[arg] + 2;
+            } else {
+                threads = atoi(argv[arg] + 2);
+                if (threads < 1 || threads > MAXIMO_THREADS) {
+                    printf("Número de threads inválido (1 a %d)\n", MAXIMO_THREADS);
+                    return 1;
+                }
+            }
+            arg++;
+        }
+        if (argc - arg != 2) {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+
+        // A tabela pré-definida e as do cache ficam juntas, procuradas pelo ID
+        const struct huff_preset* presets[1 + MAXIMO_CACHE];
+        int numPresets = 0;
+        struct huff_preset* preset = NULL;
+        struct CacheTabelas* cache = NULL;
+        if (tabela && !(preset = carregarTabelaArquivo(tabela))) {
+            return 1;
+        }
+        if (preset) presets[numPresets++] = preset;
+        if (nomeCache) {
+            cache = (struct CacheTabelas*)malloc(sizeof(struct CacheTabelas));
+            if (!cache || carregarCache(nomeCache, cache, 1) != 0) {
+                if (!cache) printf("Erro na alocação de memória.\n");
+                free(cache);
+                huff_preset_free(preset);
+                return 1;
+            }
+            for (int i = 0; i < cache->numEntradas; i++) presets[numPresets++] = &cache->entradas[i].preset;
+        }
+        int status = descompactarArquivo(argv[arg], argv[arg + 1], presets, numPresets, threads);
+        free(cache);
+        huff_preset_free(preset);
+        return status;
+    }
+
+    if (strcmp(argv[1], "info") == 0) {
+        mostrarCabecalhoCompactado(argv[2]);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "train") == 0) {
+        int arg = 2;
+        long id = 1;
+        if (arg < argc && strncmp(argv[arg], "-I", 2) == 0) {
+            char* fim;
+            id = strtol(argv[arg] + 2, &fim, 10);
+            if (argv[arg][2] == '\0' || *fim != '\0' || id < 0 || id > 0x7FFFFFFFL) {
+                printf("ID inválido (0 a %ld)\n", 0x7FFFFFFFL);
+                return 1;
+            }
+            arg++;
+        }
+        if (argc - arg < 2) {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+        return treinarTabela(argv[arg], argv + arg + 1, argc - arg - 1, (uint32_t)id);
+    }
+
+    mostrarUso(argv[0]);
+    return 1;
+}
+#endif
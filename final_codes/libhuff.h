@@ -0,0 +1,173 @@
+#ifndef LIBHUFF_H
+#define LIBHUFF_H
+
+#include <stddef.h>
+
+/*
+ ============================================================================
+ LIBHUFF: COMPRESSÃO HUFFMAN DE BUFFER PARA BUFFER
+ Gera o mesmo formato em blocos ("HUFB") do programa huffman_optimized, mas
+ tudo na memória: sem arquivos temporários, sem stdio e sem estado global.
+ Para usar como biblioteca, compile huffman_optimized.c com -DHUFF_BIBLIOTECA:
+ as partes de arquivos e a linha de comando ficam de fora, e só as funções
+ huff_* abaixo são visíveis no objeto (o resto é static).
+
+   gcc -std=c99 -O2 -DHUFF_BIBLIOTECA -c huffman_optimized.c -o libhuff.o
+
+ test_libhuff.c, ao lado deste arquivo, é um exemplo de uso e o teste da API:
+
+   gcc -std=c99 -O2 test_libhuff.c libhuff.o -lm -o test_libhuff
+ ============================================================================
+*/
+
+#define HUFF_NIVEL_MINIMO 1
+#define HUFF_NIVEL_MAXIMO 9
+#define HUFF_NIVEL_PADRAO 6
+
+// Códigos de erro (sempre negativos)
+#define HUFF_ERRO_DESTINO_PEQUENO (-1)   // 'cap' não comporta o resultado
+#define HUFF_ERRO_DADOS_INVALIDOS (-2)   // Entrada corrompida ou de outro formato
+#define HUFF_ERRO_MEMORIA (-3)
+#define HUFF_ERRO_PARAMETRO (-4)
+
+// Maior tamanho possível da saída de huff_compress para 'n' bytes de entrada
+size_t huff_compress_bound(size_t n);
+
+// Compacta 'n' bytes de 'src' em 'dst' (até 'cap' bytes) no nível padrão.
+// Retorna o tamanho compactado ou um código de erro.
+long long huff_compress(const void* src, size_t n, void* dst, size_t cap);
+
+// Igual a huff_compress, com o nível (1 a 9) escolhido pelo chamador
+long long huff_compress_level(const void* src, size_t n, void* dst, size_t cap, int level);
+
+// Descompacta 'n' bytes de 'src' em 'dst' (até 'cap' bytes).
+// Retorna o tamanho descompactado ou um código de erro.
+long long huff_decompress(const void* src, size_t n, void* dst, size_t cap);
+
+// Tamanho descompactado de 'src' (soma dos blocos, sem decodificar nada)
+// ou um código de erro
+long long huff_decompressed_size(const void* src, size_t n);
+
+/*
+ Contextos reutilizáveis: guardam todos os buffers, tabelas e a arena de
+ trabalho entre as chamadas. Cada chamada começa do zero (nada passa de uma
+ mensagem para a outra), mas a memória só é alocada quando aparece uma entrada
+ maior ou um nível mais alto do que os já vistos; depois disso compactar e
+ descompactar não alocam nada. Um contexto não pode ser usado por duas threads
+ ao mesmo tempo: cada thread mantém o seu.
+*/
+struct huff_cctx;
+struct huff_dctx;
+
+struct huff_cctx* huff_cctx_create(void);       // NULL se faltar memória
+void huff_cctx_free(struct huff_cctx* cctx);
+long long huff_compress_cctx(struct huff_cctx* cctx, const void* src, size_t n, void* dst, size_t cap, int level);
+
+struct huff_dctx* huff_dctx_create(void);
+void huff_dctx_free(struct huff_dctx* dctx);
+long long huff_decompress_dctx(struct huff_dctx* dctx, const void* src, size_t n, void* dst, size_t cap);
+
+/*
+ Tabelas pré-definidas, para mensagens pequenas (RPC, linhas de log): a tabela
+ é treinada uma vez com amostras do tráfego e recebe um ID; os blocos que a
+ usam levam só o ID, sem árvore no cabeçalho. Os dois lados carregam a mesma
+ tabela antes de qualquer mensagem. O compressor continua escolhendo, bloco a
+ bloco, a opção mais barata (tabela própria, pré-definida ou armazenado).
+
+ Todo byte tem código na tabela treinada, mesmo os que não apareceram nas
+ amostras. huff_preset_save grava a tabela (até HUFF_TAMANHO_MAXIMO_PRESET
+ bytes) e huff_preset_load a lê de volta (NULL se inválida). As tabelas são
+ só leitura depois de criadas e podem ser compartilhadas por vários contextos
+ e threads; precisam durar enquanto algum contexto as usar.
+*/
+#define HUFF_TAMANHO_MAXIMO_PRESET 266
+
+struct huff_preset;
+
+struct huff_preset* huff_preset_train(const void* const* samples, const size_t* sizes, size_t count,
+                                      unsigned int id);
+long long huff_preset_save(const struct huff_preset* preset, void* dst, size_t cap);
+struct huff_preset* huff_preset_load(const void* src, size_t n);
+unsigned int huff_preset_id(const struct huff_preset* preset);
+void huff_preset_free(struct huff_preset* preset);
+
+// Oferece a tabela aos blocos das próximas compressões (NULL = nenhuma)
+void huff_cctx_use_preset(struct huff_cctx* cctx, const struct huff_preset* preset);
+
+// Registra uma tabela para descompactar blocos com o ID dela (até 16 por
+// contexto; o mesmo ID substitui a anterior). Retorna 0 ou um código de erro.
+int huff_dctx_add_preset(struct huff_dctx* dctx, const struct huff_preset* preset);
+
+/*
+ Lotes: compacta 'count' buffers independentes numa chamada só. Cada item
+ informa a entrada (src, size) e o destino (dst, cap) e recebe em 'result' o
+ tamanho compactado ou um código de erro; huff_compress_batch retorna 0 ou o
+ erro do primeiro item que falhou. Cada item sai no mesmo formato de
+ huff_compress e é descompactado sozinho.
+
+ Os itens são divididos entre as threads de um huff_pool, cada uma com o seu
+ contexto (sem alocação depois dos primeiros lotes). Com pool == NULL tudo roda
+ na thread que chamou. O trabalho de tabela compartilhado entre os itens é o
+ 'preset' (ou NULL), montado uma vez e usado por todas as threads. Em lotes
+ de mensagens pequenas é ele que elimina a árvore de cada item.
+
+ As threads só existem se huffman_optimized.c for compilado com
+ -DHUFF_THREADS -pthread; sem isso, huff_pool_create cria um grupo de uma
+ thread e o resultado é o mesmo. Um pool atende um lote por vez.
+*/
+struct huff_batch_item {
+    const void* src;
+    size_t size;
+    void* dst;
+    size_t cap;
+    long long result;
+};
+
+struct huff_pool;
+
+struct huff_pool* huff_pool_create(int threads);   // Inclui a thread que chama huff_compress_batch
+void huff_pool_free(struct huff_pool* pool);
+int huff_pool_threads(const struct huff_pool* pool);
+long long huff_compress_batch(struct huff_pool* pool, struct huff_batch_item* items, size_t count, int level,
+                              const struct huff_preset* preset);
+
+/*
+ Fluxos: compactação por partes, com memória limitada a uma janela qualquer
+ que seja o tamanho da entrada. O resultado é o mesmo formato de huff_compress.
+
+   huff_compress_update: consome o que puder de 'src' (devolvido em *consumed)
+   e grava em 'dst' a saída das janelas já completas. Retorna os bytes gravados.
+   Chame de novo com o resto da entrada enquanto *consumed < n.
+
+   huff_compress_end: compacta a última janela e fecha o fluxo. Retorna os
+   bytes gravados; chame até retornar 0 (com cap > 0). Depois disso o fluxo só
+   volta a ser usado após huff_cstream_reset.
+
+ 'windowSize' é o tamanho da janela (0 = 1 MiB, o máximo): janelas menores
+ entregam a saída mais cedo, janelas maiores comprimem melhor. Se os blocos de
+ uma janela passarem de huff_compress_bound(windowSize), o que não deve
+ acontecer, as duas funções retornam HUFF_ERRO_DESTINO_PEQUENO até o próximo
+ huff_cstream_reset, em vez de entregar um fluxo com blocos faltando.
+*/
+struct huff_cstream;
+
+struct huff_cstream* huff_cstream_create(int level, size_t windowSize);
+void huff_cstream_reset(struct huff_cstream* stream);
+void huff_cstream_free(struct huff_cstream* stream);
+long long huff_compress_update(struct huff_cstream* stream, const void* src, size_t n, size_t* consumed, void* dst,
+                               size_t cap);
+long long huff_compress_end(struct huff_cstream* stream, void* dst, size_t cap);
+
+/*
+ Descompactação puxada: o fluxo lê os dados compactados pela função 'read'
+ (que retorna os bytes lidos, 0 no fim ou < 0 em erro) conforme precisa, e
+ huff_decompress_read entrega até 'cap' bytes descompactados. Retorna os bytes
+ entregues (0 = fim do fluxo) ou um código de erro.
+*/
+struct huff_dstream;
+
+struct huff_dstream* huff_dstream_create(long long (*read)(void* user, void* buf, size_t cap), void* user);
+void huff_dstream_free(struct huff_dstream* stream);
+long long huff_decompress_read(struct huff_dstream* stream, void* dst, size_t cap);
+
+#endif
@@ -0,0 +1,93 @@
+// Teste do cache de tabelas (-C): um arquivo cujos blocos criam mais tabelas
+// do que cabem no cache precisa abrir com o cache gravado pela mesma execução.
+// O programa inclui o compressor inteiro, com o main dele renomeado:
+//   gcc -std=c99 -O2 -o test_cache_tabelas test_cache_tabelas.c -lm
+#define main mainHuffman
+#include "huffman_optimized.c"
+#undef main
+
+#define TAMANHO_SEGMENTO (1 << 20)
+#define NUM_DISTRIBUICOES 37           // A, B e mais 35, todas diferentes
+
+// Procedimento para gerar um segmento com a distribuição 'k': 10 símbolos a
+// partir de um byte que depende de 'k', o símbolo i com probabilidade 2^-(i+1)
+void gerarSegmento(unsigned char* segmento, int k, uint32_t* semente) {
+    int base = (k * 29) % 256;
+    for (size_t p = 0; p < TAMANHO_SEGMENTO; p++) {
+        *semente = *semente * 1664525u + 1013904223u;
+        uint32_t bits = *semente >> 8;
+        int i = 0;
+        while (i < 9 && (bits & (1u << i))) i++;
+        segmento[p] = (unsigned char)((base + 3 * i) % 256);
+    }
+}
+
+// Função para comparar dois arquivos. Retorna 1 se forem iguais.
+int arquivosIguais(const char* nome_a, const char* nome_b) {
+    FILE* a = fopen(nome_a, "rb");
+    FILE* b = fopen(nome_b, "rb");
+    int iguais = a && b;
+    while (iguais) {
+        int ca = fgetc(a);
+        int cb = fgetc(b);
+        iguais = ca == cb;
+        if (ca == EOF) break;
+    }
+    if (a) fclose(a);
+    if (b) fclose(b);
+    return iguais;
+}
+
+// Função para compactar 'entrada' com o cache 'nomeCache', gravar o cache e
+// descompactar com ele. Retorna 1 se a volta der o arquivo original.
+int idaEVoltaComCache(const char* entrada, const char* nomeCache) {
+    struct CacheTabelas* cache = (struct CacheTabelas*)malloc(sizeof(struct CacheTabelas));
+    int ok = cache && carregarCache(nomeCache, cache, 0) == 0 &&
+             compactarArquivoBlocos(entrada, "teste_cache.huff", 3, FILTRO_AUTOMATICO, 0, NULL, cache, 1) == 0 &&
+             gravarCache(nomeCache, cache) == 0 && carregarCache(nomeCache, cache, 1) == 0;
+    if (ok) {
+        const struct huff_preset* presets[MAXIMO_CACHE];
+        for (int i = 0; i < cache->numEntradas; i++) presets[i] = &cache->entradas[i].preset;
+        ok = descompactarArquivo("teste_cache.huff", "teste_cache.out", presets, cache->numEntradas, 1) == 0 &&
+             arquivosIguais(entrada, "teste_cache.out");
+    }
+    free(cache);
+    return ok;
+}
+
+int main(void) {
+    // Segmentos A, B, A e mais 35 distribuições: o A repetido usa a tabela do
+    // cache, e as 35 seguintes tentam inserir mais entradas do que cabem
+    unsigned char* segmento = (unsigned char*)malloc(TAMANHO_SEGMENTO);
+    FILE* arquivo = fopen("teste_cache.bin", "wb");
+    if (!segmento || !arquivo) {
+        printf("Erro ao preparar o teste.\n");
+        free(segmento);
+        if (arquivo) fclose(arquivo);
+        return 1;
+    }
+    uint32_t semente = 12345;
+    int ordem[NUM_DISTRIBUICOES + 1] = {0, 1, 0};
+    for (int k = 2; k < NUM_DISTRIBUICOES; k++) ordem[k + 1] = k;
+    for (int s = 0; s <= NUM_DISTRIBUICOES; s++) {
+        gerarSegmento(segmento, ordem[s], &semente);
+        fwrite(segmento, 1, TAMANHO_SEGMENTO, arquivo);
+    }
+    fclose(arquivo);
+    free(segmento);
+
+    remove("teste_cache.cache");
+    int falhas = 0;
+    // Primeira execução, com o cache vazio, e a segunda, com o cache cheio
+    for (int execucao = 1; execucao <= 2; execucao++) {
+        int ok = idaEVoltaComCache("teste_cache.bin", "teste_cache.cache");
+        printf("%s execução %d com o cache de tabelas\n", ok ? "OK  " : "FALHA", execucao);
+        falhas += !ok;
+    }
+
+    remove("teste_cache.bin");
+    remove("teste_cache.huff");
+    remove("teste_cache.out");
+    remove("teste_cache.cache");
+    return falhas ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+// Teste dos formatos de arquivo com entradas corrompidas: o descompactador
+// precisa recusar o arquivo (ou, se os bits ainda formarem um fluxo válido,
+// gerar alguma saída) sem nunca ler ou gravar fora dos seus buffers. Rode
+// também com -fsanitize=address. O programa inclui o compressor inteiro, com o
+// main dele renomeado:
+//   gcc -std=c99 -O2 -o test_formatos_corrompidos test_formatos_corrompidos.c -lm
+#define main mainHuffman
+#include "huffman_optimized.c"
+#undef main
+
+static int falhas = 0;
+
+// Procedimento para registrar o resultado de uma verificação
+static void verificar(int condicao, const char* descricao) {
+    printf("%s %s\n", condicao ? "OK   " : "FALHA", descricao);
+    falhas += !condicao;
+}
+
+// Procedimento para gravar 'n' bytes num arquivo
+static void gravarBytes(const char* nome, const unsigned char* dados, size_t n) {
+    FILE* arquivo = fopen(nome, "wb");
+    if (!arquivo) return;
+    fwrite(dados, 1, n, arquivo);
+    fclose(arquivo);
+}
+
+// Função para ler um arquivo inteiro. Retorna NULL em caso de erro.
+static unsigned char* lerBytes(const char* nome, long* tamanho) {
+    FILE* arquivo = fopen(nome, "rb");
+    if (!arquivo) return NULL;
+    unsigned char* dados = lerArquivoInteiro(arquivo, tamanho);
+    fclose(arquivo);
+    return dados;
+}
+
+// Função para descompactar 'n' bytes. Retorna o status de descompactarArquivo.
+static int descompactarBytes(const unsigned char* dados, size_t n) {
+    gravarBytes("teste_corrompido.huff", dados, n);
+    return descompactarArquivo("teste_corrompido.huff", "teste_corrompido.out", NULL, 0, 1);
+}
+
+// Procedimento para compactar a amostra com 'compactar', conferir a ida e
+// volta e depois descompactar cópias cortadas e com bytes trocados
+static void testarFormato(const char* nome, int (*compactar)(const char*, const char*)) {
+    char descricao[128];
+    int ok = compactar("teste_amostra.bin", "teste_amostra.huff") == 0 &&
+             descompactarArquivo("teste_amostra.huff", "teste_amostra.out", NULL, 0, 1) == 0;
+    long tamanho = 0, tamanhoVolta = 0;
+    unsigned char* original = lerBytes("teste_amostra.bin", &tamanho);
+    unsigned char* volta = lerBytes("teste_amostra.out", &tamanhoVolta);
+    ok = ok && original && volta && tamanho == tamanhoVolta && memcmp(original, volta, (size_t)tamanho) == 0;
+    snprintf(descricao, sizeof(descricao), "%s: ida e volta", nome);
+    verificar(ok, descricao);
+    free(original);
+    free(volta);
+
+    unsigned char* compactado = lerBytes("teste_amostra.huff", &tamanho);
+    if (!compactado) return;
+
+    // Sem o fim do fluxo não há arquivo válido
+    int recusados = 0, cortes = 0;
+    for (long corte = 5; corte < tamanho; corte += 1 + tamanho / 16, cortes++) {
+        recusados += descompactarBytes(compactado, (size_t)corte) != 0;
+    }
+    snprintf(descricao, sizeof(descricao), "%s: %d de %d arquivos cortados recusados", nome, recusados, cortes);
+    verificar(recusados == cortes, descricao);
+
+    // Bytes trocados depois do cabeçalho: qualquer status, mas sem acesso inválido
+    uint32_t semente = 12345;
+    for (int tentativa = 0; tentativa < 64; tentativa++) {
+        semente = semente * 1664525u + 1013904223u;
+        long posicao = 5 + (long)((semente >> 8) % (uint32_t)(tamanho - 5));
+        unsigned char antes = compactado[posicao];
+        compactado[posicao] ^= (unsigned char)(1 + (semente & 0x7F));
+        descompactarBytes(compactado, (size_t)tamanho);
+        compactado[posicao] = antes;
+    }
+    free(compactado);
+}
+
+int main(void) {
+    // Amostra: texto com alguns bytes fora do ASCII
+    static const char* texto = "Vamos aprender programação: a árvore de Huffman dá códigos curtos aos bytes comuns.\n";
+    unsigned char* amostra = (unsigned char*)malloc(40000);
+    if (!amostra) return 1;
+    size_t n = 0;
+    for (; n + strlen(texto) <= 40000; n += strlen(texto)) memcpy(amostra + n, texto, strlen(texto));
+    gravarBytes("teste_amostra.bin", amostra, n);
+    free(amostra);
+
+    // Modo adaptativo: símbolo novo com 9 bits fora do alfabeto (0x12C)
+    static const unsigned char simboloInvalido[] = {'H', 'U', 'F', 'A', 0x01, 0x96, 0x00, 0x00};
+    verificar(descompactarBytes(simboloInvalido, sizeof(simboloInvalido)) != 0, "-A: símbolo novo fora do alfabeto");
+    // Símbolo novo repetido: 'a' (0x061), de novo 'a' pelo escape e o fim
+    static const unsigned char simboloRepetido[] = {'H', 'U', 'F', 'A', 0x01, 0x30, 0x8C, 0x28, 0x00};
+    verificar(descompactarBytes(simboloRepetido, sizeof(simboloRepetido)) != 0, "-A: símbolo novo que já tem folha");
+    testarFormato("-A", compactarFluxoAdaptativo);
+
+    // Modo palavras: o primeiro bloco com um byte zero a mais no fim, que
+    // deixa os bits terminarem antes do último byte
+    testarFormato("-W", compactarArquivoPalavras);
+    long tamanho = 0;
+    unsigned char* palavras = lerBytes("teste_amostra.huff", &tamanho);
+    unsigned char* alterado = (unsigned char*)malloc((size_t)tamanho + 16);
+    uint64_t numPalavras = 0, tamanhoBloco = 0;
+    size_t a = palavras && tamanho > 5 ? lerVarint(palavras + 5, (size_t)tamanho - 5, &numPalavras) : 0;
+    size_t b = a ? lerVarint(palavras + 5 + a, (size_t)tamanho - 5 - a, &tamanhoBloco) : 0;
+    if (alterado && b && tamanhoBloco > 0) {
+        size_t inicio = 5 + a + b, fim = inicio + (size_t)tamanhoBloco;
+        memcpy(alterado, palavras, 5 + a);
+        size_t c = 5 + a + (size_t)escreverVarint(alterado + 5 + a, tamanhoBloco + 1);
+        memcpy(alterado + c, palavras + inicio, (size_t)tamanhoBloco);
+        c += (size_t)tamanhoBloco;
+        alterado[c++] = 0;
+        memcpy(alterado + c, palavras + fim, (size_t)tamanho - fim);
+        c += (size_t)tamanho - fim;
+        verificar(descompactarBytes(alterado, c) != 0, "-W: bloco com um byte a mais");
+    } else {
+        verificar(0, "-W: bloco com um byte a mais");
+    }
+    free(palavras);
+    free(alterado);
+
+    remove("teste_amostra.bin");
+    remove("teste_amostra.huff");
+    remove("teste_amostra.out");
+    remove("teste_corrompido.huff");
+    remove("teste_corrompido.out");
+    printf(falhas ? "%d falha(s)\n" : "OK\n", falhas);
+    return falhas ? 1 : 0;
+}
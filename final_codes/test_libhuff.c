@@ -0,0 +1,417 @@
+// Teste da biblioteca em memória (libhuff.h): ida e volta em todos os níveis,
+// contextos reutilizados, fluxos, tabela pré-definida, lotes e entradas
+// corrompidas.
+// Usa só a API pública, ligada ao objeto compilado com -DHUFF_BIBLIOTECA:
+//   gcc -std=c99 -O2 -DHUFF_BIBLIOTECA -c huffman_optimized.c -o libhuff.o
+//   gcc -std=c99 -O2 test_libhuff.c libhuff.o -lm -o test_libhuff
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libhuff.h"
+
+#define NUM_AMOSTRAS 6
+#define TAMANHO_MAXIMO (300 * 1024)
+
+static int falhas = 0;
+
+// Procedimento para registrar o resultado de uma verificação
+static void verificar(int condicao, const char* descricao, const char* amostra, int nivel) {
+    if (!condicao) {
+        printf("FALHA %s (%s, nível %d)\n", descricao, amostra, nivel);
+        falhas++;
+    }
+}
+
+// Função para gerar a amostra 'k' em 'dados'. Retorna o tamanho.
+static size_t gerarAmostra(int k, unsigned char* dados, const char** nome) {
+    static const char* texto = "Vamos aprender programação: a árvore de Huffman dá códigos curtos aos bytes comuns. ";
+    uint32_t semente = 2463534242u;
+    size_t n = 0;
+    switch (k) {
+    case 0:
+        *nome = "vazia";
+        break;
+    case 1:
+        *nome = "um byte";
+        dados[n++] = 'A';
+        break;
+    case 2:
+        *nome = "texto";
+        for (; n + strlen(texto) <= 200000; n += strlen(texto)) memcpy(dados + n, texto, strlen(texto));
+        break;
+    case 3:
+        *nome = "aleatória";
+        for (; n < 100000; n++) {
+            semente ^= semente << 13;
+            semente ^= semente >> 17;
+            semente ^= semente << 5;
+            dados[n] = (unsigned char)semente;
+        }
+        break;
+    case 4:
+        *nome = "zeros";
+        n = 150000;
+        memset(dados, 0, n);
+        break;
+    default:
+        // Metade texto, metade inteiros crescentes de 32 bits: força a divisão em blocos
+        *nome = "mista";
+        for (; n + strlen(texto) <= 100000; n += strlen(texto)) memcpy(dados + n, texto, strlen(texto));
+        for (uint32_t v = 0; n + 4 <= TAMANHO_MAXIMO; v += 3, n += 4) memcpy(dados + n, &v, 4);
+        break;
+    }
+    return n;
+}
+
+// Procedimento para conferir a ida e volta de 'dados' em todos os níveis, com
+// as funções simples e com contextos reutilizados
+static void testarIdaEVolta(const unsigned char* dados, size_t n, const char* nome, unsigned char* compactado,
+                            unsigned char* volta, struct huff_cctx* cctx, struct huff_dctx* dctx) {
+    size_t limite = huff_compress_bound(n);
+    for (int nivel = HUFF_NIVEL_MINIMO; nivel <= HUFF_NIVEL_MAXIMO; nivel++) {
+        long long tamanho = huff_compress_level(dados, n, compactado, limite, nivel);
+        verificar(tamanho > 0, "compactar", nome, nivel);
+        if (tamanho <= 0) continue;
+
+        verificar(huff_decompressed_size(compactado, (size_t)tamanho) == (long long)n, "tamanho original", nome,
+                  nivel);
+        long long original = huff_decompress(compactado, (size_t)tamanho, volta, n);
+        verificar(original == (long long)n && memcmp(dados, volta, n) == 0, "descompactar", nome, nivel);
+
+        // O contexto reutilizado gera exatamente os mesmos bytes
+        long long comContexto = huff_compress_cctx(cctx, dados, n, volta, limite, nivel);
+        verificar(comContexto == tamanho && memcmp(compactado, volta, (size_t)tamanho) == 0, "contexto", nome,
+                  nivel);
+        original = huff_decompress_dctx(dctx, compactado, (size_t)tamanho, volta, n);
+        verificar(original == (long long)n && memcmp(dados, volta, n) == 0, "descompactar com contexto", nome,
+                  nivel);
+
+        // Destino pequeno demais: erro, nunca um resultado truncado
+        if (n > 0) {
+            verificar(huff_decompress(compactado, (size_t)tamanho, volta, n - 1) < 0, "destino pequeno", nome,
+                      nivel);
+        }
+    }
+}
+
+// Procedimento para corromper a saída de 'dados' de vários jeitos: o
+// descompactador precisa recusar (ou, se os bits ainda formarem um arquivo
+// válido, respeitar 'cap'), sem nunca ler ou gravar fora dos buffers
+static void testarCorrupcao(const unsigned char* dados, size_t n, const char* nome, unsigned char* compactado,
+                            unsigned char* volta) {
+    long long tamanho = huff_compress_level(dados, n, compactado, huff_compress_bound(n), HUFF_NIVEL_PADRAO);
+    if (tamanho <= 0) return;
+
+    // Arquivo cortado em vários pontos: sem o bloco final não há arquivo válido
+    for (long long corte = 0; corte < tamanho; corte += 1 + tamanho / 50) {
+        verificar(huff_decompress(compactado, (size_t)corte, volta, n) < 0, "arquivo cortado", nome,
+                  HUFF_NIVEL_PADRAO);
+    }
+
+    // Bytes trocados: qualquer resultado, mas dentro de 'cap'
+    uint32_t semente = 12345;
+    for (int tentativa = 0; tentativa < 200; tentativa++) {
+        semente = semente * 1664525u + 1013904223u;
+        size_t posicao = (semente >> 8) % (size_t)tamanho;
+        unsigned char antes = compactado[posicao];
+        compactado[posicao] ^= (unsigned char)(1 + (semente & 0x7F));
+        long long resultado = huff_decompress(compactado, (size_t)tamanho, volta, n);
+        verificar(resultado <= (long long)n, "byte trocado", nome, HUFF_NIVEL_PADRAO);
+        compactado[posicao] = antes;
+    }
+
+    // Outro formato
+    verificar(huff_decompress("HUFX", 4, volta, n) == HUFF_ERRO_DADOS_INVALIDOS, "número mágico", nome,
+              HUFF_NIVEL_PADRAO);
+}
+
+// Função com o próximo número do gerador xorshift de 'semente'
+static uint32_t aleatorio(uint32_t* semente) {
+    *semente ^= *semente << 13;
+    *semente ^= *semente >> 17;
+    *semente ^= *semente << 5;
+    return *semente;
+}
+
+// Entrada de huff_dstream_create: entrega os dados compactados em pedaços de
+// 1 a 7 bytes, como uma leitura de rede que volta antes de encher o buffer
+struct LeituraCurta {
+    const unsigned char* dados;
+    size_t tamanho;
+    size_t posicao;
+    uint32_t semente;
+};
+
+static long long lerCurto(void* usuario, void* buffer, size_t capacidade) {
+    struct LeituraCurta* leitura = (struct LeituraCurta*)usuario;
+    size_t quantos = 1 + aleatorio(&leitura->semente) % 7;
+    if (quantos > capacidade) quantos = capacidade;
+    if (quantos > leitura->tamanho - leitura->posicao) quantos = leitura->tamanho - leitura->posicao;
+    memcpy(buffer, leitura->dados + leitura->posicao, quantos);
+    leitura->posicao += quantos;
+    return (long long)quantos;
+}
+
+// Função para compactar 'dados' com um huff_cstream, em pedaços de entrada e
+// de saída de tamanho aleatório (a saída às vezes com 'cap' 0). Retorna o
+// tamanho compactado ou -1.
+static long long compactarEmPedacos(struct huff_cstream* fluxo, const unsigned char* dados, size_t n,
+                                    unsigned char* compactado, size_t capacidade, uint32_t* semente) {
+    size_t lidos = 0, escritos = 0;
+    while (lidos < n) {
+        size_t pedaco = 1 + aleatorio(semente) % 10000;
+        if (pedaco > n - lidos) pedaco = n - lidos;
+        size_t cap = aleatorio(semente) % 3000;
+        if (cap > capacidade - escritos) cap = capacidade - escritos;
+        size_t consumidos;
+        long long r = huff_compress_update(fluxo, dados + lidos, pedaco, &consumidos, compactado + escritos, cap);
+        if (r < 0 || consumidos > pedaco) return -1;
+        lidos += consumidos;
+        escritos += (size_t)r;
+    }
+    while (1) {
+        size_t cap = 1 + aleatorio(semente) % 3000;
+        if (cap > capacidade - escritos) cap = capacidade - escritos;
+        if (cap == 0) return -1;
+        long long r = huff_compress_end(fluxo, compactado + escritos, cap);
+        if (r < 0) return -1;
+        if (r == 0) break;
+        escritos += (size_t)r;
+    }
+    return (long long)escritos;
+}
+
+// Função para descompactar com um huff_dstream sobre lerCurto, em pedaços de
+// saída de tamanho aleatório. Retorna o total entregue ou o primeiro erro;
+// 'entregues' recebe o que saiu antes do erro.
+static long long descompactarEmPedacos(const unsigned char* compactado, size_t tamanho, unsigned char* volta,
+                                       size_t capacidade, size_t* entregues, uint32_t* semente) {
+    struct LeituraCurta leitura = {compactado, tamanho, 0, aleatorio(semente)};
+    struct huff_dstream* fluxo = huff_dstream_create(lerCurto, &leitura);
+    if (!fluxo) return HUFF_ERRO_MEMORIA;
+
+    long long resultado = 0;
+    *entregues = 0;
+    while (1) {
+        size_t cap = 1 + aleatorio(semente) % 5000;
+        if (cap > capacidade - *entregues) cap = capacidade - *entregues;
+        long long r = huff_decompress_read(fluxo, volta + *entregues, cap);
+        if (r < 0) {
+            // O erro é definitivo: a chamada seguinte repete o mesmo código
+            resultado = huff_decompress_read(fluxo, volta, capacidade) == r ? r : 0;
+            break;
+        }
+        if (r == 0 || cap == 0) {
+            resultado = (long long)*entregues;
+            break;
+        }
+        *entregues += (size_t)r;
+    }
+    huff_dstream_free(fluxo);
+    return resultado;
+}
+
+// Procedimento para conferir os fluxos (huff_cstream / huff_dstream) com
+// janelas pequenas e a padrão, pedaços aleatórios e leituras curtas
+static void testarFluxos(const unsigned char* dados, size_t n, const char* nome, unsigned char* compactado,
+                         size_t capacidade, unsigned char* volta) {
+    static const size_t janelas[] = {1, 4096, 0};
+    uint32_t semente = 88172645u;
+    for (int j = 0; j < 3; j++) {
+        // Janelas de 1 byte: um bloco por byte, então só o começo da amostra
+        size_t tamanho = janelas[j] == 1 && n > 2000 ? 2000 : n;
+        int nivel = j == 1 ? 4 : HUFF_NIVEL_PADRAO;
+        struct huff_cstream* fluxo = huff_cstream_create(nivel, janelas[j]);
+        verificar(fluxo != NULL, "criar fluxo", nome, nivel);
+        if (!fluxo) continue;
+
+        long long compactados = compactarEmPedacos(fluxo, dados, tamanho, compactado, capacidade, &semente);
+        verificar(compactados > 0, "fluxo de compactação", nome, nivel);
+        size_t consumidos = 0;
+        verificar(huff_compress_update(fluxo, dados, tamanho, &consumidos, volta, 16) == HUFF_ERRO_PARAMETRO &&
+                      consumidos == 0,
+                  "update depois do end", nome, nivel);
+
+        if (compactados > 0) {
+            long long original = huff_decompress(compactado, (size_t)compactados, volta, tamanho);
+            verificar(original == (long long)tamanho && memcmp(dados, volta, tamanho) == 0,
+                      "descompactar a saída do fluxo", nome, nivel);
+            size_t entregues;
+            original = descompactarEmPedacos(compactado, (size_t)compactados, volta, tamanho, &entregues, &semente);
+            verificar(original == (long long)tamanho && memcmp(dados, volta, tamanho) == 0, "fluxo de descompactação",
+                      nome, nivel);
+
+            // Cortado nos últimos blocos: os blocos inteiros saem primeiro e depois vem o erro
+            if (janelas[j] == 4096 && tamanho > 4 * 4096) {
+                size_t corte = (size_t)compactados * 3 / 4;
+                original = descompactarEmPedacos(compactado, corte, volta, tamanho, &entregues, &semente);
+                verificar(original == HUFF_ERRO_DADOS_INVALIDOS && entregues > 0 &&
+                              memcmp(dados, volta, entregues) == 0,
+                          "fluxo cortado", nome, nivel);
+            }
+        }
+
+        // Depois do reset o mesmo fluxo serve para outra entrada
+        huff_cstream_reset(fluxo);
+        compactados = compactarEmPedacos(fluxo, dados, tamanho / 2, compactado, capacidade, &semente);
+        verificar(compactados > 0 && huff_decompress(compactado, (size_t)compactados, volta, tamanho / 2) ==
+                                         (long long)(tamanho / 2),
+                  "fluxo depois do reset", nome, nivel);
+        huff_cstream_free(fluxo);
+    }
+}
+
+// Procedimento para conferir mensagens pequenas com tabela pré-definida
+static void testarTabela(unsigned char* compactado, unsigned char* volta) {
+    static const char* mensagens[] = {
+        "{\"usuario\": 17, \"acao\": \"login\", \"ok\": true}",
+        "{\"usuario\": 4, \"acao\": \"logout\", \"ok\": true}",
+        "{\"usuario\": 230, \"acao\": \"compra\", \"ok\": false}",
+    };
+    const void* amostras[3];
+    size_t tamanhos[3];
+    for (int i = 0; i < 3; i++) {
+        amostras[i] = mensagens[i];
+        tamanhos[i] = strlen(mensagens[i]);
+    }
+
+    struct huff_preset* preset = huff_preset_train(amostras, tamanhos, 3, 7);
+    unsigned char salvo[HUFF_TAMANHO_MAXIMO_PRESET];
+    long long tamanhoSalvo = preset ? huff_preset_save(preset, salvo, sizeof(salvo)) : -1;
+    struct huff_preset* carregado = tamanhoSalvo > 0 ? huff_preset_load(salvo, (size_t)tamanhoSalvo) : NULL;
+    struct huff_cctx* cctx = huff_cctx_create();
+    struct huff_dctx* dctx = huff_dctx_create();
+    verificar(preset && carregado && cctx && dctx && huff_preset_id(carregado) == 7, "tabela pré-definida", "json",
+              HUFF_NIVEL_PADRAO);
+
+    if (preset && carregado && cctx && dctx) {
+        huff_cctx_use_preset(cctx, preset);
+        verificar(huff_dctx_add_preset(dctx, carregado) == 0, "registrar tabela", "json", HUFF_NIVEL_PADRAO);
+        for (int i = 0; i < 3; i++) {
+            long long tamanho = huff_compress_cctx(cctx, mensagens[i], tamanhos[i], compactado, 1024,
+                                                   HUFF_NIVEL_PADRAO);
+            long long original = tamanho > 0 ? huff_decompress_dctx(dctx, compactado, (size_t)tamanho, volta,
+                                                                    tamanhos[i])
+                                             : -1;
+            verificar(original == (long long)tamanhos[i] && memcmp(volta, mensagens[i], tamanhos[i]) == 0,
+                      "mensagem com tabela", "json", HUFF_NIVEL_PADRAO);
+            // Sem a tabela registrada o bloco não abre
+            if (tamanho > 0 && tamanho < (long long)tamanhos[i]) {
+                verificar(huff_decompress(compactado, (size_t)tamanho, volta, tamanhos[i]) < 0, "mensagem sem tabela",
+                          "json", HUFF_NIVEL_PADRAO);
+            }
+        }
+    }
+
+    huff_cctx_free(cctx);
+    huff_dctx_free(dctx);
+    huff_preset_free(preset);
+    huff_preset_free(carregado);
+}
+
+#define ITENS_LOTE 48
+#define TAMANHO_ITEM 256
+#define ITEM_PEQUENO 17                // Item com 'cap' pequeno demais
+
+// Procedimento para conferir huff_compress_batch sem pool e com um pool de
+// várias threads, com e sem tabela pré-definida. Cada item é descompactado
+// sozinho; um deles não cabe no destino e precisa falhar sem afetar os outros.
+static void testarLotes(unsigned char* compactado, unsigned char* volta) {
+    static const char* acoes[] = {"login", "logout", "compra", "busca"};
+    char mensagens[ITENS_LOTE][TAMANHO_ITEM];
+    const void* amostras[ITENS_LOTE];
+    size_t tamanhos[ITENS_LOTE];
+    for (int i = 0; i < ITENS_LOTE; i++) {
+        snprintf(mensagens[i], TAMANHO_ITEM, "{\"usuario\": %d, \"acao\": \"%s\", \"ok\": %s, \"itens\": [%d, %d]}",
+                 i * 37 % 1000, acoes[i % 4], i % 3 ? "true" : "false", i, i * i);
+        amostras[i] = mensagens[i];
+        tamanhos[i] = strlen(mensagens[i]);
+    }
+    struct huff_preset* preset = huff_preset_train(amostras, tamanhos, ITENS_LOTE, 9);
+    struct huff_pool* pool = huff_pool_create(4);
+    struct huff_dctx* dctx = huff_dctx_create();
+    verificar(preset && pool && dctx && huff_pool_threads(pool) >= 1 && huff_pool_threads(pool) <= 4 &&
+                  huff_dctx_add_preset(dctx, preset) == 0,
+              "preparar lotes", "lote", HUFF_NIVEL_PADRAO);
+    if (!preset || !pool || !dctx) {
+        huff_preset_free(preset);
+        huff_pool_free(pool);
+        huff_dctx_free(dctx);
+        return;
+    }
+
+    for (int usarPool = 0; usarPool <= 1; usarPool++) {
+        for (int usarTabela = 0; usarTabela <= 1; usarTabela++) {
+            static const char* nomes[2][2] = {{"lote sem pool", "lote sem pool, com tabela"},
+                                              {"lote com pool", "lote com pool e tabela"}};
+            const char* nome = nomes[usarPool][usarTabela];
+            struct huff_batch_item itens[ITENS_LOTE];
+            size_t deslocamento = 0;
+            for (int i = 0; i < ITENS_LOTE; i++) {
+                itens[i].src = mensagens[i];
+                itens[i].size = tamanhos[i];
+                itens[i].dst = compactado + deslocamento;
+                itens[i].cap = i == ITEM_PEQUENO ? 4 : huff_compress_bound(tamanhos[i]);
+                itens[i].result = 0;
+                deslocamento += itens[i].cap;
+            }
+
+            long long r = huff_compress_batch(usarPool ? pool : NULL, itens, ITENS_LOTE, HUFF_NIVEL_PADRAO,
+                                              usarTabela ? preset : NULL);
+            verificar(r == HUFF_ERRO_DESTINO_PEQUENO && itens[ITEM_PEQUENO].result == HUFF_ERRO_DESTINO_PEQUENO,
+                      "item com destino pequeno", nome, HUFF_NIVEL_PADRAO);
+
+            for (int i = 0; i < ITENS_LOTE; i++) {
+                if (i == ITEM_PEQUENO) continue;
+                long long original = itens[i].result > 0
+                                         ? huff_decompress_dctx(dctx, itens[i].dst, (size_t)itens[i].result, volta,
+                                                                tamanhos[i])
+                                         : -1;
+                verificar(original == (long long)tamanhos[i] && memcmp(volta, mensagens[i], tamanhos[i]) == 0,
+                          "item do lote", nome, HUFF_NIVEL_PADRAO);
+                // Sem tabela cada item é um arquivo comum
+                if (!usarTabela) {
+                    verificar(huff_decompress(itens[i].dst, (size_t)itens[i].result, volta, tamanhos[i]) ==
+                                  (long long)tamanhos[i],
+                              "item do lote sem contexto", nome, HUFF_NIVEL_PADRAO);
+                }
+            }
+        }
+    }
+
+    huff_preset_free(preset);
+    huff_pool_free(pool);
+    huff_dctx_free(dctx);
+}
+
+int main(void) {
+    unsigned char* dados = (unsigned char*)malloc(TAMANHO_MAXIMO);
+    unsigned char* compactado = (unsigned char*)malloc(huff_compress_bound(TAMANHO_MAXIMO));
+    unsigned char* volta = (unsigned char*)malloc(huff_compress_bound(TAMANHO_MAXIMO));
+    struct huff_cctx* cctx = huff_cctx_create();
+    struct huff_dctx* dctx = huff_dctx_create();
+    if (!dados || !compactado || !volta || !cctx || !dctx) {
+        printf("Erro na alocação de memória.\n");
+        return 1;
+    }
+
+    for (int k = 0; k < NUM_AMOSTRAS; k++) {
+        const char* nome;
+        size_t n = gerarAmostra(k, dados, &nome);
+        testarIdaEVolta(dados, n, nome, compactado, volta, cctx, dctx);
+        testarCorrupcao(dados, n, nome, compactado, volta);
+        testarFluxos(dados, n, nome, compactado, huff_compress_bound(TAMANHO_MAXIMO), volta);
+    }
+    testarTabela(compactado, volta);
+    testarLotes(compactado, volta);
+
+    huff_cctx_free(cctx);
+    huff_dctx_free(dctx);
+    free(dados);
+    free(compactado);
+    free(volta);
+
+    printf(falhas ? "%d falha(s)\n" : "OK\n", falhas);
+    return falhas ? 1 : 0;
+}